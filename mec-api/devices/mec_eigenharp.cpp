@@ -1,11 +1,14 @@
 #include "mec_eigenharp.h"
 
 #include "mec_log.h"
+#include "mec_time.h"
+#include "../mec_stats.h"
+#include "../mec_surface.h"
 #include "../mec_surfacemapper.h"
 #include "../mec_voice.h"
 
 
-#include <set>
+#include <picross/pic_time.h>
 
 namespace mec {
 
@@ -15,15 +18,24 @@ public:
     EigenharpHandler(Preferences &p, ICallback &cb)
             : prefs_(p),
               callback_(cb),
+              surfaceCallback_(dynamic_cast<ISurfaceCallback *>(&cb)),
+              surface_(internSurface(p.getString("surface", "eigenharp"))),
+              geometry_(nullptr),
               valid_(true),
               voices_(static_cast<unsigned>(p.getInt("voices", 15)),
                       static_cast<unsigned>(p.getInt("velocity count", 5))),
               pitchbendRange_((float) p.getDouble("pitchbend range", 2.0)),
+              rollRange_((float) p.getDouble("roll range", 1.0)),
               stealVoices_(p.getBool("steal voices", true)),
               throttle_(p.getInt("throttle", 0) == 0
                         ? 0 : 1000000ULL /
                               p.getInt("throttle",
                                        0)) {
+        voices_.setStealPolicy(Voices::stealPolicy(p.getString("steal policy", "oldest")));
+        voices_.setVelocityCurve(static_cast<float>(p.getDouble("velocity scale", 4.0)),
+                                 static_cast<float>(p.getDouble("velocity curve", 1.0)));
+        voices_.setEarlyVelocity(static_cast<unsigned>(p.getInt("velocity early", 0)));
+        positions_.assign(static_cast<unsigned>(p.getInt("voices", 15)), nullptr);
         if (valid_) {
             LOG_0("EigenharpHandler enabling for mecapi");
         }
@@ -51,6 +63,10 @@ public:
         LOG_1(" r: " << rows << " c: " << cols);
         LOG_1(" s: " << ribbons << " p: " << pedals);
 
+        geometry_ = KeyGeometry::find(dk);
+        mapper_.setGeometry(geometry_);
+        if (!surfaceCallback_) LOG_1("EigenharpHandler surface touches not available, callback has no surface");
+
         if (prefs_.exists("mapping")) {
             Preferences map(prefs_.getSubTree("mapping"));
             if (map.exists(dk)) {
@@ -64,10 +80,13 @@ public:
     virtual void key(const char *dev, unsigned long long t, unsigned course, unsigned key, bool a, unsigned p, int r,
                      int y) {
         Voices::Voice *voice = voices_.voiceId(key);
+        const KeyPosition *pos = surfaceCallback_ && geometry_ ? geometry_->position(course, key) : nullptr;
         float mx = bipolar(r);
         float my = bipolar(y);
         float mz = unipolar(p);
         float mn = note(key, mx);
+        unsigned long long ts = timestamp(t);
+        MEC_STAT_SINCE(Stats::S_DEVICE_DECODE, ts);
         if (a) {
 
             LOG_3("EigenharpHandler key device d: " << dev << " a: " << a);
@@ -76,7 +95,7 @@ public:
             LOG_3(" mn: " << mn << " mx: " << mx << " my: " << my << " mz: " << mz);
 
             if (!voice) {
-                if (stolenKeys_.find(key) != stolenKeys_.end()) {
+                if (voices_.isStolen(key)) {
                     // this key has been stolen, must be released to reactivate it
                     return;
                 }
@@ -86,10 +105,16 @@ public:
                 if (!voice && stealVoices_) {
                     LOG_2("voice steal required for " << key);
                     // no available voices, steal?
-                    Voices::Voice *stolen = voices_.oldestActiveVoice();
-                    callback_.touchOff(stolen->i_, stolen->note_, stolen->x_, stolen->y_, 0.0f);
-                    stolenKeys_.insert((unsigned) stolen->id_);
-                    voices_.stopVoice(stolen);
+                    Voices::Voice *stolen = voices_.voiceToSteal(mn);
+                    MEC_STAT_COUNT(Stats::C_VOICE_STEAL);
+                    // a pending voice has not sent its touch on
+                    if (stolen->state_ == Voices::Voice::ACTIVE) {
+                        callback_.touchOff(ts, stolen->i_, stolen->note_, stolen->x_, stolen->y_, 0.0f);
+                        // position the stolen touch started at, as it may be on another course
+                        const KeyPosition *spos = positions_[stolen->i_];
+                        if (spos) surfaceCallback_->touchOff(touch(stolen->i_, spos, stolen->x_, stolen->y_, 0.0f));
+                    }
+                    voices_.stealVoice(stolen);
                     voice = voices_.startVoice(key);
                     // if(voice) { LOG_1("voice steal found for " << key  "stolen from " << stolen->id_)); }
                 }
@@ -97,17 +122,20 @@ public:
 
             if (voice) {
                 if (voice->state_ == Voices::Voice::PENDING) {
+                    positions_[voice->i_] = pos;
                     voices_.addPressure(voice, mz);
                     if (voice->state_ == Voices::Voice::ACTIVE) {
                         LOG_2("start voice for " << key << " ch " << voice->i_);
-                        callback_.touchOn(voice->i_, mn, mx, my, voice->v_); //v_ = calculated velocity
+                        callback_.touchOn(ts, voice->i_, mn, mx, my, voice->v_); //v_ = calculated velocity
+                        if (pos) surfaceCallback_->touchOn(touch(voice->i_, pos, mx, my, voice->v_));
                         voice->t_ = t;
                     }
                     // dont send to callbacks until we have the minimum pressures for velocity
                 } else {
                     if (throttle_ == 0 || (t - voice->t_) >= throttle_) {
                         LOG_2("continue voice for " << key << " ch " << voice->i_);
-                        callback_.touchContinue(voice->i_, mn, mx, my, mz);
+                        callback_.touchContinue(ts, voice->i_, mn, mx, my, mz);
+                        if (pos) surfaceCallback_->touchContinue(touch(voice->i_, pos, mx, my, mz));
                         voice->t_ = t;
                     }
                 }
@@ -123,32 +151,49 @@ public:
 
             if (voice) {
                 LOG_2("stop voice for " << key << " ch " << voice->i_);
-                callback_.touchOff(voice->i_, mn, mx, my, mz);
+                callback_.touchOff(ts, voice->i_, mn, mx, my, mz);
+                if (pos) surfaceCallback_->touchOff(touch(voice->i_, pos, mx, my, mz));
+                positions_[voice->i_] = nullptr;
                 voices_.stopVoice(voice);
             }
-            stolenKeys_.erase(key);
+            voices_.clearStolen(key);
         }
     }
 
     virtual void breath(const char *dev, unsigned long long t, unsigned val) {
-        callback_.control(0, unipolar(val));
+        callback_.control(timestamp(t), 0, unipolar(val));
     }
 
     virtual void strip(const char *dev, unsigned long long t, unsigned strip, unsigned val) {
-        callback_.control(0x10 + strip, unipolar(val));
+        callback_.control(timestamp(t), 0x10 + strip, unipolar(val));
     }
 
     virtual void pedal(const char *dev, unsigned long long t, unsigned pedal, unsigned val) {
-        callback_.control(0x20 + pedal, unipolar(val));
+        callback_.control(timestamp(t), 0x20 + pedal, unipolar(val));
     }
 
 private:
+    // device time is pic_microtime(), convert to mec::microtime() keeping the age of the event
+    unsigned long long timestamp(unsigned long long t) {
+        unsigned long long now = pic_microtime();
+        unsigned long long age = now > t ? now - t : 0;
+        return microtime() - age;
+    }
+
     inline float clamp(float v, float mn, float mx) { return (std::max(std::min(v, mx), mn)); }
 
     float unipolar(int val) { return std::min(float(val) / 4096.0f, 1.0f); }
 
     float bipolar(int val) { return clamp(float(val) / 4096.0f, -1.0f, 1.0f); }
 
+    // key centred on its row/column, roll/yaw move within the key
+    // roll also glides the column (pitch along the string), same curve as note(), up to roll range columns
+    Touch touch(int id, const KeyPosition *pos, float mx, float my, float mz) {
+        float glide = (mx > 0.0f ? mx * mx : -mx * mx) * rollRange_;
+        return Touch(id, surface_, pos->column_ + (mx * 0.5f), pos->row_ + (my * 0.5f), mz,
+                     pos->row_, pos->column_ + glide);
+    }
+
     //float   note(unsigned key, float mx) { return mapper_.noteFromKey(key) + (mx  * pitchbendRange_) ; }
     float note(unsigned key, float mx) {
         return mapper_.noteFromKey(key) + ((mx > 0.0 ? mx * mx : -mx * mx) * pitchbendRange_);
@@ -156,13 +201,17 @@ private:
 
     Preferences prefs_;
     ICallback &callback_;
+    ISurfaceCallback *surfaceCallback_; // null if callback is not surface aware
+    SurfaceID surface_;
+    const KeyGeometry *geometry_;
     SurfaceMapper mapper_;
     Voices voices_;
+    std::vector<const KeyPosition *> positions_; // by voice, key position at touch on
     bool valid_;
     float pitchbendRange_;
+    float rollRange_; // surface touches, columns
     bool stealVoices_;
     unsigned long long throttle_;
-    std::set<unsigned> stolenKeys_;
 };
 
 
@@ -223,6 +272,9 @@ bool Eigenharp::isActive() {
     return active_;
 }
 
+// surface touches, for the scaler and musical outputs
+MEC_REGISTER_SURFACE_DEVICE("eigenharp", Eigenharp, 0x2139, 0, mec::DeviceFactory::O_DEFAULT)
+
 }
 
 
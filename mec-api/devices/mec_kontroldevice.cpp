@@ -72,7 +72,7 @@ bool KontrolDevice::init(void *arg) {
 
     if (listenPort_ > 0) {
         auto p = std::make_shared<Kontrol::OSCReceiver>(model_);
-        if (p->listen(listenPort_)) {
+        if (p->listen(listenPort_, static_cast<unsigned>(prefs.getInt("listen threads", 1)))) {
             osc_receiver_ = p;
             LOG_0("kontrol device : listening on " << listenPort_);
         }
@@ -178,6 +178,14 @@ bool KontrolDevice::isActive() {
     return active_;
 }
 
+// note: preferences are in Kontrol
+static std::shared_ptr<Device> mec_create_KontrolDevice(ICallback &cb) {
+    return std::make_shared<KontrolDevice>(cb);
+}
+
+// first, other devices (e.g. push2) use the kontrol model
+MEC_REGISTER_DEVICE_CREATOR("kontrol", "Kontrol", mec_create_KontrolDevice, 0, 0, mec::DeviceFactory::O_FIRST)
+
 }
 
 
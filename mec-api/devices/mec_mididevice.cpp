@@ -1,6 +1,8 @@
 #include "mec_mididevice.h"
 
 #include "mec_log.h"
+#include "mec_time.h"
+#include "../mec_stats.h"
 #include "../mec_voice.h"
 
 namespace mec {
@@ -33,6 +35,10 @@ bool MidiDevice::init(void *arg) {
         deinit();
     }
     active_ = false;
+    // touch ids are midi channels
+    queue_.setCapacity(static_cast<unsigned>(prefs.getInt("queue size", MsgQueue::DEFAULT_SIZE)),
+                       16);
+    queue_.setCoalesce(prefs.getBool("coalesce", false));
 
     bool found = false;
 
@@ -147,6 +153,10 @@ bool MidiDevice::isActive() {
     return active_;
 }
 
+void MidiDevice::setSignal(MsgSignal *signal) {
+    queue_.setSignal(signal);
+}
+
 bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
     int status = 0, data1 = 0, data2 = 0; //data3 = 0;
     unsigned int n = message->size();
@@ -162,6 +172,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
     int type = status & 0xF0;
     VoiceData &touch = touches_[ch];
     MecMsg msg;
+    unsigned long long t = microtime();
     switch (type) {
         case 0x90: {
             // note on (+note off if vel =0)
@@ -178,6 +189,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                     msg.data_.touch_.x_ = touch.x_;
                     msg.data_.touch_.y_ = touch.y_;
                     msg.data_.touch_.z_ = touch.z_;
+                    msg.data_.touch_.t_ = t;
                     queue_.addToQueue(msg);
 
                     touch.startNote_ = 0.0f;
@@ -196,6 +208,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                     msg.data_.touch_.x_ = touch.x_;
                     msg.data_.touch_.y_ = touch.y_;
                     msg.data_.touch_.z_ = touch.z_;
+                    msg.data_.touch_.t_ = t;
                     queue_.addToQueue(msg);
                 }
             } else {
@@ -213,6 +226,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                 msg.data_.touch_.x_ = touch.x_;
                 msg.data_.touch_.y_ = touch.y_;
                 msg.data_.touch_.z_ = touch.z_;
+                msg.data_.touch_.t_ = t;
                 queue_.addToQueue(msg);
             }
             break;
@@ -233,6 +247,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                 msg.data_.touch_.x_ = touch.x_;
                 msg.data_.touch_.y_ = touch.y_;
                 msg.data_.touch_.z_ = touch.z_;
+                msg.data_.touch_.t_ = t;
                 queue_.addToQueue(msg);
 
                 touch.startNote_ = 0.0f;
@@ -249,6 +264,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                 msg.data_.touch_.x_ = touch.x_;
                 msg.data_.touch_.y_ = touch.y_;
                 msg.data_.touch_.z_ = touch.z_;
+                msg.data_.touch_.t_ = t;
                 queue_.addToQueue(msg);
 
                 touch.startNote_ = 0.0f;
@@ -268,12 +284,14 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                     msg.data_.touch_.x_ = touch.x_;
                     msg.data_.touch_.y_ = touch.y_;
                     msg.data_.touch_.z_ = touch.z_;
+                    msg.data_.touch_.t_ = t;
                     queue_.addToQueue(msg);
                 }
             } else {
                 msg.type_ = MecMsg::CONTROL;
                 msg.data_.control_.controlId_ = data1;
                 msg.data_.control_.value_ = v;
+                msg.data_.control_.t_ = t;
                 queue_.addToQueue(msg);
             }
             break;
@@ -291,12 +309,14 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                     msg.data_.touch_.x_ = touch.x_;
                     msg.data_.touch_.y_ = touch.y_;
                     msg.data_.touch_.z_ = touch.z_;
+                    msg.data_.touch_.t_ = t;
                     queue_.addToQueue(msg);
                 }
             } else {
                 msg.type_ = MecMsg::CONTROL;
                 msg.data_.control_.controlId_ = type;
                 msg.data_.control_.value_ = v;
+                msg.data_.control_.t_ = t;
                 queue_.addToQueue(msg);
             }
             break;
@@ -316,12 +336,14 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
                     msg.data_.touch_.x_ = touch.x_;
                     msg.data_.touch_.y_ = touch.y_;
                     msg.data_.touch_.z_ = touch.z_;
+                    msg.data_.touch_.t_ = t;
                     queue_.addToQueue(msg);
                 }
             } else {
                 msg.type_ = MecMsg::CONTROL;
                 msg.data_.control_.controlId_ = type;
                 msg.data_.control_.value_ = v;
+                msg.data_.control_.t_ = t;
                 queue_.addToQueue(msg);
             }
             break;
@@ -333,6 +355,7 @@ bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
         }
     } //switch
 
+    MEC_STAT_SINCE(Stats::S_DEVICE_DECODE, t);
     return true;
 }
 
@@ -353,6 +376,7 @@ bool MidiDevice::send(const MidiMsg &m) {
     return true;
 }
 
+MEC_REGISTER_DEVICE("midi", MidiDevice, 0, 0, mec::DeviceFactory::O_DEFAULT)
 
 } //namespace
 
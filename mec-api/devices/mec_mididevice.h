@@ -21,6 +21,7 @@ public:
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual void setSignal(MsgSignal*);
 
     virtual bool midiCallback(double deltatime, std::vector<unsigned char> *message);
 
@@ -4,64 +4,120 @@
 #include <osc/OscOutboundPacketStream.h>
 #include <osc/OscReceivedElements.h>
 #include <osc/OscPacketListener.h>
-#include <ip/UdpSocket.h>
+#include <ip/IpEndpointName.h>
 
 #include <algorithm>
 
 #include "mec_log.h"
+#include "mec_oscmatch.h"
+#include "mec_time.h"
+#include "mec_udpreceiver.h"
+#include "../mec_stats.h"
 #include "../mec_voice.h"
 
 ////////////////////////////////////////////////
-// TODO
+// frames
+// touches following /t3d/frm are held, and applied together when the frame ends
+// (end of bundle, or next frame), senders without frames have touches applied as received.
+// touches missing from "reap frames" consecutive frames, or not updated for "reap timeout" mS
+// (e.g. sender stopped) are ended, so a lost release does not leave a voice sounding.
+// frames missing from the sequence are counted as Stats::C_FRAME_DROPPED
 ////////////////////////////////////////////////
 
 namespace mec {
 
-class OscT3DHandler : public osc::OscPacketListener {
+class OscT3DHandler : public osc::OscPacketListener, public UdpReceiver::Listener {
 public:
+    static const unsigned MAX_FRAME_TOUCHES = 64;
+
     OscT3DHandler(Preferences &p, MsgQueue &q)
         : prefs_(p),
           queue_(q),
           valid_(true),
-          socket_(nullptr) {
+          frameOpen_(false),
+          framed_(false),
+          frameId_(0),
+          frameCount_(0),
+          frameT_(0),
+          frameTouches_(0) {
         if (valid_) {
             LOG_0("OscT3DHandler enabling for mecapi");
         }
-        for (int i = 0; i < sizeof(activeTouches_); i++) {
-            activeTouches_[i] = false;
-        }
-        stealVoices_ = false;
+        reapFrames_ = static_cast<unsigned>(p.getInt("reap frames", 8));
+        reapTimeout_ = static_cast<unsigned long long>(p.getInt("reap timeout", 1000)) * 1000;
+        matcher_.add("/t3d/tch", A_TOUCH, true);
+        matcher_.add("/t3d/frm", A_FRM);
+        matcher_.add("/t3d/command", A_COMMAND);
+        stealVoices_ = p.getBool("steal voices", false);
+        voices_.setStealPolicy(Voices::stealPolicy(p.getString("steal policy", "oldest")));
+        voices_.setVelocityCurve(static_cast<float>(p.getDouble("velocity scale", 4.0)),
+                                 static_cast<float>(p.getDouble("velocity curve", 1.0)));
+        voices_.setEarlyVelocity(static_cast<unsigned>(p.getInt("velocity early", 0)));
+        lastFrame_.assign(voices_.voiceCount(), 0);
     }
 
     bool isValid() { return valid_; }
 
-    void setSocket(UdpListeningReceiveSocket *pS) {
-        socket_ = pS;
+    // period to check for stale touches, 0 = none
+    int timerPeriod() const {
+        unsigned long long ms = reapTimeout_ / 4000;
+        return reapTimeout_ == 0 ? 0 : static_cast<int>(ms < 10 ? 10 : ms);
+    }
+
+    virtual void ProcessPacket(const char *data, int size,
+                               const IpEndpointName &remoteEndpoint) {
+        osc::OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+        // a bundle is a complete frame
+        if (frameOpen_ && size > 0 && data[0] == '#') endFrame();
+    }
+
+    virtual void receive(UdpReceiver::Packet *p) {
+        ProcessPacket(p->data_, static_cast<int>(p->size_), IpEndpointName(p->address_, static_cast<int>(p->port_)));
+        p->release();
+    }
+
+    virtual void timer(unsigned) {
+        unsigned long long t = microtime();
+        // unbundled sender stopped mid frame
+        if (frameOpen_ && t - frameT_ > reapTimeout_) endFrame();
+        Voices::Voice *voice = voices_.oldestActiveVoice();
+        while (voice) {
+            Voices::Voice *next = voices_.nextVoice(voice);
+            if (t > voice->t_ && t - voice->t_ > reapTimeout_) reap(t, voice);
+            voice = next;
+        }
     }
 
     virtual void ProcessMessage(const osc::ReceivedMessage &m,
                                 const IpEndpointName &remoteEndpoint) {
         (void) remoteEndpoint; // suppress unused parameter warning
+        unsigned long long t = microtime();
 
         try {
-            // example of parsing single messages. osc::OsckPacketListener
-            // handles the bundle traversal.
-            static const std::string A_COMMAND = "/t3d/command";
-            static const std::string A_TOUCH = "/t3d/tch";
-            static const std::string A_FRM = "/t3d/frm";
-
-
+            // osc::OscPacketListener handles the bundle traversal.
+            // matched in place, as this is called for every touch update
+            unsigned tId = 0;
+            int addr = matcher_.match(m.AddressPattern(), tId);
             osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-            std::string addr = m.AddressPattern();
-            if (addr.length() > 8 && addr.find(A_TOUCH) == 0) {
-                std::string touch = addr.substr(8);
-                unsigned tId = static_cast<unsigned>(std::stoi(touch));
+            if (addr == A_TOUCH) {
                 float x = 0.0f, y = 0.0f, z = 0.0f, note = 0.0f;
                 args >> x >> y >> z >> note >> osc::EndMessage;
-                queue_touch(tId, note, x, (y * 2.0f) - 1.0f, z);
+                if (frameOpen_ && frameTouches_ < MAX_FRAME_TOUCHES) {
+                    FrameTouch &ft = frame_[frameTouches_++];
+                    ft.tId_ = tId;
+                    ft.note_ = note;
+                    ft.x_ = x;
+                    ft.y_ = (y * 2.0f) - 1.0f;
+                    ft.z_ = z;
+                } else {
+                    queue_touch(t, tId, note, x, (y * 2.0f) - 1.0f, z);
+                    MEC_STAT_SINCE(Stats::S_DEVICE_DECODE, t);
+                }
             } else if (addr == A_FRM) {
                 osc::int32 d1, d2;
                 args >> d1 >> d2 >> osc::EndMessage;
+                if (frameOpen_) endFrame();
+                startFrame(t, static_cast<unsigned>(d1));
             } else if (addr == A_COMMAND) {
                 const char *cmd;
                 args >> cmd >> osc::EndMessage;
@@ -82,25 +138,81 @@ public:
         }
     }
 
-    virtual void queue_touch(unsigned tId, float mn, float mx, float my, float mz) {
+    void startFrame(unsigned long long t, unsigned id) {
+        // ids going backwards (sender restarted) are not counted
+        if (framed_ && id > frameId_ + 1) {
+            MEC_STAT_ADD(Stats::C_FRAME_DROPPED, id - frameId_ - 1);
+        }
+        framed_ = true;
+        frameOpen_ = true;
+        frameId_ = id;
+        frameT_ = t;
+        frameTouches_ = 0;
+    }
+
+    void endFrame() {
+        unsigned long long t = microtime();
+        frameOpen_ = false;
+        frameCount_++;
+        for (unsigned i = 0; i < frameTouches_; i++) {
+            const FrameTouch &ft = frame_[i];
+            queue_touch(t, ft.tId_, ft.note_, ft.x_, ft.y_, ft.z_);
+        }
+        if (frameTouches_ > 0) MEC_STAT_SINCE(Stats::S_DEVICE_DECODE, frameT_);
+        frameTouches_ = 0;
+
+        if (reapFrames_ == 0) return;
+        Voices::Voice *voice = voices_.oldestActiveVoice();
+        while (voice) {
+            Voices::Voice *next = voices_.nextVoice(voice);
+            if (frameCount_ - lastFrame_[voice->i_] >= reapFrames_) reap(t, voice);
+            voice = next;
+        }
+    }
+
+    void reap(unsigned long long t, Voices::Voice *voice) {
+        if (voice->state_ == Voices::Voice::ACTIVE) {
+            MecMsg msg;
+            msg.data_.touch_.touchId_ = voice->i_;
+            msg.data_.touch_.note_ = voice->note_;
+            msg.data_.touch_.x_ = voice->x_;
+            msg.data_.touch_.y_ = voice->y_;
+            msg.data_.touch_.z_ = 0.0f;
+            msg.data_.touch_.t_ = t;
+            msg.type_ = MecMsg::TOUCH_OFF;
+            queue_.addToQueue(msg);
+        }
+        MEC_STAT_COUNT(Stats::C_TOUCH_REAPED);
+        voices_.stopVoice(voice);
+    }
+
+    virtual void queue_touch(unsigned long long t, unsigned tId, float mn, float mx, float my, float mz) {
         Voices::Voice *voice = voices_.voiceId(tId);
         if (mz > 0.0) {
             if (!voice) {
+                // this touch has been stolen, must be released to reactivate it
+                if (voices_.isStolen(tId)) return;
+
                 voice = voices_.startVoice(tId);
                 // LOG_1("start voice for " << tId << " ch " << voice->i_);
 
                 if (!voice && stealVoices_) {
                     // no available voices, steal?
-                    Voices::Voice *stolen = voices_.oldestActiveVoice();
-                    MecMsg msg;
-                    msg.data_.touch_.touchId_ = stolen->i_;
-                    msg.data_.touch_.note_ = stolen->note_;
-                    msg.data_.touch_.x_ = stolen->x_;
-                    msg.data_.touch_.y_ = stolen->y_;
-                    msg.data_.touch_.z_ = 0.0f;
-                    msg.type_ = MecMsg::TOUCH_OFF;
-                    queue_.addToQueue(msg);
-                    voices_.stopVoice(stolen);
+                    Voices::Voice *stolen = voices_.voiceToSteal(mn);
+                    MEC_STAT_COUNT(Stats::C_VOICE_STEAL);
+                    // a pending voice has not sent its touch on
+                    if (stolen->state_ == Voices::Voice::ACTIVE) {
+                        MecMsg msg;
+                        msg.data_.touch_.touchId_ = stolen->i_;
+                        msg.data_.touch_.note_ = stolen->note_;
+                        msg.data_.touch_.x_ = stolen->x_;
+                        msg.data_.touch_.y_ = stolen->y_;
+                        msg.data_.touch_.z_ = 0.0f;
+                        msg.data_.touch_.t_ = t;
+                        msg.type_ = MecMsg::TOUCH_OFF;
+                        queue_.addToQueue(msg);
+                    }
+                    voices_.stealVoice(stolen);
                     voice = voices_.startVoice(tId);
                 }
             }
@@ -116,6 +228,7 @@ public:
                         msg.data_.touch_.x_ = mx;
                         msg.data_.touch_.y_ = my;
                         msg.data_.touch_.z_ = voice->v_;
+                        msg.data_.touch_.t_ = t;
                         msg.type_ = MecMsg::TOUCH_ON;
                         queue_.addToQueue(msg);
                     }
@@ -127,6 +240,7 @@ public:
                     msg.data_.touch_.x_ = mx;
                     msg.data_.touch_.y_ = my;
                     msg.data_.touch_.z_ = mz;
+                    msg.data_.touch_.t_ = t;
                     msg.type_ = MecMsg::TOUCH_CONTINUE;
                     queue_.addToQueue(msg);
                 }
@@ -134,7 +248,8 @@ public:
                 voice->x_ = mx;
                 voice->y_ = my;
                 voice->z_ = mz;
-                voice->t_ = 0;
+                voice->t_ = t;
+                lastFrame_[voice->i_] = frameCount_;
             }
             // else no voice available
 
@@ -148,26 +263,49 @@ public:
                 msg.data_.touch_.x_ = mx;
                 msg.data_.touch_.y_ = my;
                 msg.data_.touch_.z_ = mz;
+                msg.data_.touch_.t_ = t;
                 msg.type_ = MecMsg::TOUCH_OFF;
                 queue_.addToQueue(msg);
                 voices_.stopVoice(voice);
             }
+            voices_.clearStolen(tId);
         }
     }
 
 private:
+    enum Address {
+        A_TOUCH,
+        A_FRM,
+        A_COMMAND
+    };
+
     inline float clamp(float v, float mn, float mx) { return (std::max(std::min(v, mx), mn)); }
 
     float note(float n) { return n; }
 
+    struct FrameTouch {
+        unsigned tId_;
+        float note_, x_, y_, z_;
+    };
+
     Preferences prefs_;
     MsgQueue &queue_;
+    OscAddressMatcher matcher_;
     bool valid_;
-    bool activeTouches_[16];
-    UdpListeningReceiveSocket *socket_;
     bool stealVoices_;
     Voices voices_;
 
+    bool frameOpen_;
+    bool framed_;        // sender uses frames
+    unsigned frameId_;   // senders frame id
+    unsigned frameCount_;
+    unsigned long long frameT_;
+    FrameTouch frame_[MAX_FRAME_TOUCHES];
+    unsigned frameTouches_;
+    std::vector<unsigned> lastFrame_; // by voice
+    unsigned reapFrames_;
+    unsigned long long reapTimeout_;
+
 };
 
 
@@ -181,15 +319,6 @@ OscT3D::~OscT3D() {
 }
 
 
-void OscT3DListen(OscT3D *self) {
-    self->listenProc();
-}
-
-void OscT3D::listenProc() {
-    LOG_1("T3D socket listening on : " << port_);
-    socket_->Run();
-}
-
 bool OscT3D::init(void *arg) {
     Preferences prefs(arg);
 
@@ -197,29 +326,30 @@ bool OscT3D::init(void *arg) {
         deinit();
     }
     active_ = false;
-    OscT3DHandler *pCb = new OscT3DHandler(prefs, queue_);
+    queue_.setCapacity(static_cast<unsigned>(prefs.getInt("queue size", MsgQueue::DEFAULT_SIZE)));
+    queue_.setCoalesce(prefs.getBool("coalesce", false));
+    handler_.reset(new OscT3DHandler(prefs, queue_));
 
     port_ = (unsigned) prefs.getInt("port", 9000);
 
-    if (pCb->isValid()) {
-        active_ = true;
-    } else {
-        delete pCb;
+    if (!handler_->isValid()) {
+        handler_.reset();
+        return false;
     }
 
     LOG_1("T3D socket on port : " << port_);
 
-    socket_.reset(
-        new UdpListeningReceiveSocket(
-            IpEndpointName(IpEndpointName::ANY_ADDRESS, port_),
-            pCb)
-    );
-
-    pCb->setSocket(socket_.get());
-
-    listenThread_ = std::thread(OscT3DListen, this);
-
+    // single thread, as touch state is not shared, timer for stale touch check
+    receiver_.reset(new UdpReceiver());
+    receiver_->setTimer(static_cast<unsigned>(handler_->timerPeriod()));
+    if (!receiver_->start(port_, handler_.get())) {
+        LOG_0("T3D unable to listen on port : " << port_);
+        receiver_.reset();
+        handler_.reset();
+        return false;
+    }
 
+    active_ = true;
     return active_;
 }
 
@@ -230,9 +360,9 @@ bool OscT3D::process() {
 void OscT3D::deinit() {
     LOG_0("OscT3D::deinit");
     if (active_) {
-        socket_->AsynchronousBreak();
-        listenThread_.join();
-        socket_.reset();
+        receiver_->stop();
+        receiver_.reset();
+        handler_.reset();
         LOG_0("OscT3D::deinit done");
     }
     active_ = false;
@@ -242,6 +372,11 @@ bool OscT3D::isActive() {
     return active_;
 }
 
+void OscT3D::setSignal(MsgSignal *signal) {
+    queue_.setSignal(signal);
+}
+
+MEC_REGISTER_DEVICE("osct3d", OscT3D, 0, 0, mec::DeviceFactory::O_DEFAULT)
 
 }
 
@@ -7,12 +7,12 @@
 
 
 #include <memory>
-#include <thread>
-
-class UdpListeningReceiveSocket;
 
 namespace mec {
 
+class OscT3DHandler;
+class UdpReceiver;
+
 class OscT3D : public Device {
 
 public:
@@ -22,15 +22,14 @@ public:
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
-
-    void listenProc();
+    virtual void setSignal(MsgSignal*);
 
 private:
     ICallback &callback_;
     bool active_;
     MsgQueue queue_;
-    std::unique_ptr<UdpListeningReceiveSocket> socket_;
-    std::thread listenThread_;
+    std::unique_ptr<OscT3DHandler> handler_;
+    std::unique_ptr<UdpReceiver> receiver_;
 
     unsigned int port_;
 };
@@ -1,6 +1,7 @@
 #include "mec_push2.h"
 
 #include "mec_log.h"
+#include "mec_time.h"
 #include "../mec_voice.h"
 #include "push2/mec_push2_param.h"
 #include "push2/mec_push2_device.h"
@@ -169,6 +170,7 @@ bool Push2::processMidi(const MidiMsg &midimsg) {
             msg.data_.touch_.x_ = 0;
             msg.data_.touch_.y_ = 0;
             msg.data_.touch_.z_ = float(midimsg.data[2]) / 127.0f;
+            msg.data_.touch_.t_ = microtime();
             addTouchMsg(msg);
         }
         case 0xB0: { // CC
@@ -271,6 +273,15 @@ void Push2::resource(Kontrol::ChangeSource source, const Kontrol::Rack &rack,
     if (currentPadMode()) currentPadMode()->resource(source, rack, resType, resValue);
 }
 
+// push2 is also a kontrol callback
+static std::shared_ptr<Device> mec_create_Push2(ICallback &cb) {
+    std::shared_ptr<Push2> device = std::make_shared<Push2>(cb);
+    Kontrol::KontrolModel::model()->addCallback("push2", device);
+    return device;
+}
+
+// after kontrol, as it uses the kontrol model
+MEC_REGISTER_DEVICE_CREATOR("push2", "push2", mec_create_Push2, 0x2982, 0x1967, mec::DeviceFactory::O_LAST)
 
 } // namespace
 
@@ -5,6 +5,8 @@
 
 
 #include "mec_log.h"
+#include "mec_time.h"
+#include "../mec_stats.h"
 #include "../mec_voice.h"
 
 
@@ -23,6 +25,7 @@ public:
               valid_(true),
               voices_(static_cast<unsigned>(p.getInt("voices", 15))),
               stealVoices_(p.getBool("steal voices", true)) {
+        voices_.setStealPolicy(Voices::stealPolicy(p.getString("steal policy", "oldest")));
         if (valid_) {
             LOG_0("SoundplaneHandler enabling for mecapi");
         }
@@ -37,6 +40,8 @@ public:
 
     virtual void touch(const char *dev, unsigned long long t, bool a, int itouch, float n, float x, float y, float z) {
         static const unsigned int NOTE_CH_OFFSET = 1;
+        // soundplane time is not monotonic, so stamp on arrival
+        unsigned long long ts = microtime();
 
         unsigned touch = (unsigned) itouch;
         Voices::Voice *voice = voices_.voiceId(touch);
@@ -53,6 +58,7 @@ public:
         msg.data_.touch_.x_ = mx;
         msg.data_.touch_.y_ = my;
         msg.data_.touch_.z_ = mz;
+        msg.data_.touch_.t_ = ts;
         if (a) {
             // LOG_1("SoundplaneHandler  touch device d: "   << dev      << " a: "   << a)
             // LOG_1(" touch: " <<  touch);
@@ -60,7 +66,7 @@ public:
             // LOG_1(" x: " << x      << " y: "   << y    << " z: "   << z);
             // LOG_1(" mx: " << mx    << " my: "  << my   << " mz: "  << mz);
             if (!voice) {
-                if (stolenTouches_.find(touch) != stolenTouches_.end()) {
+                if (voices_.isStolen(touch)) {
                     // this key has been stolen, must be released to reactivate it
                     return;
                 }
@@ -70,18 +76,22 @@ public:
 
                 if (!voice && stealVoices_) {
                     // no available voices, steal?
-                    Voices::Voice *stolen = voices_.oldestActiveVoice();
-
-                    MecMsg stolenMsg;
-                    stolenMsg.type_ = MecMsg::TOUCH_OFF;
-                    stolenMsg.data_.touch_.touchId_ = stolen->i_;
-                    stolenMsg.data_.touch_.note_ = stolen->note_;
-                    stolenMsg.data_.touch_.x_ = stolen->x_;
-                    stolenMsg.data_.touch_.y_ = stolen->y_;
-                    stolenMsg.data_.touch_.z_ = 0.0f;
-                    stolenTouches_.insert((unsigned) stolen->id_);
-                    queue_.addToQueue(stolenMsg);
-                    voices_.stopVoice(stolen);
+                    Voices::Voice *stolen = voices_.voiceToSteal(mn);
+                    MEC_STAT_COUNT(Stats::C_VOICE_STEAL);
+
+                    // a pending voice has not sent its touch on
+                    if (stolen->state_ == Voices::Voice::ACTIVE) {
+                        MecMsg stolenMsg;
+                        stolenMsg.type_ = MecMsg::TOUCH_OFF;
+                        stolenMsg.data_.touch_.touchId_ = stolen->i_;
+                        stolenMsg.data_.touch_.note_ = stolen->note_;
+                        stolenMsg.data_.touch_.x_ = stolen->x_;
+                        stolenMsg.data_.touch_.y_ = stolen->y_;
+                        stolenMsg.data_.touch_.z_ = 0.0f;
+                        stolenMsg.data_.touch_.t_ = ts;
+                        queue_.addToQueue(stolenMsg);
+                    }
+                    voices_.stealVoice(stolen);
 
                     voice = voices_.startVoice(touch);
                 }
@@ -116,8 +126,9 @@ public:
                 queue_.addToQueue(msg);
                 voices_.stopVoice(voice);
             }
-            stolenTouches_.erase(touch);
+            voices_.clearStolen(touch);
         }
+        MEC_STAT_SINCE(Stats::S_DEVICE_DECODE, ts);
     }
 
     virtual void control(const char *dev, unsigned long long t, int id, float val) {
@@ -125,6 +136,7 @@ public:
         msg.type_ = MecMsg::CONTROL;
         msg.data_.control_.controlId_ = id;
         msg.data_.control_.value_ = clamp(val, -1.0f, 1.0f);
+        msg.data_.control_.t_ = microtime();
         queue_.addToQueue(msg);
     }
 
@@ -138,7 +150,6 @@ private:
     Voices voices_;
     bool valid_;
     bool stealVoices_;
-    std::set<unsigned> stolenTouches_;
 };
 
 
@@ -158,6 +169,9 @@ bool Soundplane::init(void *arg) {
         deinit();
     }
     active_ = false;
+    queue_.setCapacity(static_cast<unsigned>(prefs.getInt("queue size", MsgQueue::DEFAULT_SIZE)),
+                       static_cast<unsigned>(prefs.getInt("voices", 15)));
+    queue_.setCoalesce(prefs.getBool("coalesce", false));
     model_.reset(new SoundplaneModel());
     std::string appDir = prefs.getString("app state dir", ".");
 
@@ -175,6 +189,8 @@ bool Soundplane::init(void *arg) {
     if (pCb->isValid()) {
         model_->mecOutput().connect(pCb);
         LOG_0("Soundplane::init - model init");
+        // one unit of several, same selection as hotplug uses
+        model_->setUsbSelector(prefs.getString("usb serial", ""), prefs.getString("usb port", ""));
         model_->initialize();
         active_ = true;
         LOG_0("Soundplane::init - complete");
@@ -202,6 +218,12 @@ bool Soundplane::isActive() {
     return active_;
 }
 
+void Soundplane::setSignal(MsgSignal *signal) {
+    queue_.setSignal(signal);
+}
+
+MEC_REGISTER_DEVICE("soundplane", Soundplane, kSoundplaneUSBVendor, kSoundplaneUSBProduct,
+                    mec::DeviceFactory::O_DEFAULT)
 
 }
 
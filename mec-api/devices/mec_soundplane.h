@@ -23,6 +23,7 @@ public:
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual void setSignal(MsgSignal*);
 
 private:
     ICallback &callback_;
@@ -1,6 +1,7 @@
 #include "mec_push2_play.h"
 
 #include <mec_log.h>
+#include <mec_time.h>
 
 #define PAD_NOTE_ON_CLR (int8_t) 127
 #define PAD_NOTE_OFF_CLR (int8_t) 0
@@ -132,6 +133,7 @@ void P2_PlayMode::processNoteOn(unsigned n, unsigned v) {
         msg.data_.touch_.x_ = 0;
         msg.data_.touch_.y_ = 0;
         msg.data_.touch_.z_ = float(v) / 127.0f;
+        msg.data_.touch_.t_ = microtime();
         parent_.addTouchMsg(msg);
 
         parent_.sendNoteOn(0, n, PAD_NOTE_ON_CLR);
@@ -152,6 +154,7 @@ void P2_PlayMode::processNoteOff(unsigned n, unsigned v) {
         msg.data_.touch_.x_ = 0;
         msg.data_.touch_.y_ = 0;
         msg.data_.touch_.z_ = float(v) / 127.0f;
+        msg.data_.touch_.t_ = microtime();
         parent_.addTouchMsg(msg);
 
 
@@ -120,8 +120,12 @@ public:
 	 * platform.
 	 *
 	 * listener may be nullptr.
+	 *
+	 * serial and port select one unit, when several are attached. port is
+	 * the usb bus and port path e.g. "1-2.3". Empty matches any.
 	 */
-	static std::unique_ptr<SoundplaneDriver> create(SoundplaneDriverListener *listener);
+	static std::unique_ptr<SoundplaneDriver> create(SoundplaneDriverListener *listener,
+		const std::string &serial = "", const std::string &port = "");
 
 	static float carrierToFrequency(int carrier);
 };
@@ -50,6 +50,8 @@ public:
 
 
 	void initialize();
+	// select one unit by usb serial and/or port path, before initialize
+	void setUsbSelector(const std::string &serial, const std::string &port);
 	void clearTouchData();
 	void sendTouchDataToZones();
     void sendMessageToListeners();
@@ -151,6 +153,8 @@ private:
 	 * then the pointer would point to an object that's being destroyed.)
 	 */
 	std::unique_ptr<SoundplaneDriver> mpDriver;
+	std::string mUsbSerial;
+	std::string mUsbPort;
 	int mSerialNumber;
 
     SoundplaneDataMessage mMessage;
@@ -87,18 +87,22 @@ bool libusbTransferStatusIsFatal(libusb_transfer_status error)
 
 }
 
-std::unique_ptr<SoundplaneDriver> SoundplaneDriver::create(SoundplaneDriverListener *listener)
+std::unique_ptr<SoundplaneDriver> SoundplaneDriver::create(SoundplaneDriverListener *listener,
+	const std::string &serial, const std::string &port)
 {
-	auto *driver = new LibusbSoundplaneDriver(listener);
+	auto *driver = new LibusbSoundplaneDriver(listener, serial, port);
 	driver->init();
 	return std::unique_ptr<LibusbSoundplaneDriver>(driver);
 }
 
 
-LibusbSoundplaneDriver::LibusbSoundplaneDriver(SoundplaneDriverListener* listener) :
+LibusbSoundplaneDriver::LibusbSoundplaneDriver(SoundplaneDriverListener* listener,
+	const std::string &serial, const std::string &port) :
 	mState(kNoDevice),
 	mQuitting(false),
 	mListener(listener),
+	mSelectSerial(serial),
+	mSelectPort(port),
 	mSetCarriersRequest(nullptr),
 	mEnableCarriersRequest(nullptr)
 {
@@ -229,8 +233,7 @@ bool LibusbSoundplaneDriver::processThreadOpenDevice(LibusbClaimedDevice &outDev
 {
 	for (;;)
 	{
-		libusb_device_handle* handle = libusb_open_device_with_vid_pid(
-			mLibusbContext, kSoundplaneUSBVendor, kSoundplaneUSBProduct);
+		libusb_device_handle* handle = processThreadOpenSelected();
 		LibusbClaimedDevice result(LibusbDevice(handle), kInterfaceNumber);
 		if (result)
 		{
@@ -244,6 +247,55 @@ bool LibusbSoundplaneDriver::processThreadOpenDevice(LibusbClaimedDevice &outDev
 	}
 }
 
+libusb_device_handle *LibusbSoundplaneDriver::processThreadOpenSelected() const
+{
+	if (mSelectSerial.empty() && mSelectPort.empty())
+	{
+		return libusb_open_device_with_vid_pid(
+			mLibusbContext, kSoundplaneUSBVendor, kSoundplaneUSBProduct);
+	}
+
+	libusb_device **list = nullptr;
+	libusb_device_handle *result = nullptr;
+	ssize_t n = libusb_get_device_list(mLibusbContext, &list);
+	for (ssize_t i = 0; i < n && !result; i++)
+	{
+		libusb_device_descriptor desc;
+		if (libusb_get_device_descriptor(list[i], &desc) < 0 ||
+			desc.idVendor != kSoundplaneUSBVendor || desc.idProduct != kSoundplaneUSBProduct)
+		{
+			continue;
+		}
+		if (!mSelectPort.empty())
+		{
+			// bus-port.port...
+			uint8_t ports[8];
+			int np = libusb_get_port_numbers(list[i], ports, sizeof(ports));
+			std::string path = std::to_string(libusb_get_bus_number(list[i]));
+			for (int p = 0; p < np; p++)
+			{
+				path += (p == 0 ? "-" : ".") + std::to_string(ports[p]);
+			}
+			if (path != mSelectPort) continue;
+		}
+		libusb_device_handle *handle = nullptr;
+		if (libusb_open(list[i], &handle) < 0) continue;
+		if (!mSelectSerial.empty())
+		{
+			unsigned char serial[64];
+			int len = libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, serial, sizeof(serial) - 1);
+			if (len < 0 || mSelectSerial != std::string(reinterpret_cast<char *>(serial), len))
+			{
+				libusb_close(handle);
+				continue;
+			}
+		}
+		result = handle;
+	}
+	if (list) libusb_free_device_list(list, 1);
+	return result;
+}
+
 bool LibusbSoundplaneDriver::processThreadGetDeviceInfo(libusb_device_handle *device)
 {
 	libusb_device_descriptor descriptor;
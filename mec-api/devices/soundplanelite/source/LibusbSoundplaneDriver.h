@@ -10,6 +10,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <string>
 #include <thread>
 
 #include <libusb-1.0/libusb.h>
@@ -21,7 +22,8 @@
 class LibusbSoundplaneDriver : public SoundplaneDriver
 {
 public:
-	LibusbSoundplaneDriver(SoundplaneDriverListener* listener);
+	LibusbSoundplaneDriver(SoundplaneDriverListener* listener,
+		const std::string &serial = "", const std::string &port = "");
 	~LibusbSoundplaneDriver() noexcept(true);
 
 	void init();
@@ -235,6 +237,11 @@ private:
 	 * Returns false if the process thread should quit.
 	 */
 	bool processThreadOpenDevice(LibusbClaimedDevice &outDevice) const;
+	/**
+	 * Opens the first soundplane matching mSelectSerial and mSelectPort,
+	 * returns nullptr if none is attached.
+	 */
+	libusb_device_handle *processThreadOpenSelected() const;
 	/**
 	 * Sets mFirmwareVersion and mSerialNumber as a side effect, but only
 	 * if the whole operation succeeds.
@@ -320,6 +327,11 @@ private:
 	 * from any thread.
 	 */
 	SoundplaneDriverListener	* const mListener;
+	/**
+	 * Unit selection, written on object initialization and then never modified.
+	 */
+	const std::string			mSelectSerial;
+	const std::string			mSelectPort;
 
 	std::thread					mProcessThread;
 
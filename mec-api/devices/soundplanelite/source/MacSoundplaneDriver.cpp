@@ -79,8 +79,13 @@ void show_kern_err(const char *msg, kern_return_t kr)
 // -------------------------------------------------------------------------------
 #pragma mark MacSoundplaneDriver
 
-std::unique_ptr<SoundplaneDriver> SoundplaneDriver::create(SoundplaneDriverListener *listener)
+std::unique_ptr<SoundplaneDriver> SoundplaneDriver::create(SoundplaneDriverListener *listener,
+	const std::string &serial, const std::string &port)
 {
+	if (!serial.empty() || !port.empty())
+	{
+		printf("MacSoundplaneDriver: unit selection not supported, using first soundplane\n");
+	}
 	auto *driver = new MacSoundplaneDriver(listener);
 	driver->init();
 	return std::unique_ptr<MacSoundplaneDriver>(driver);
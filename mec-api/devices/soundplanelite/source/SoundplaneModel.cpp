@@ -375,11 +375,17 @@ void SoundplaneModel::setAllPropertiesToDefaults()
 }
 
 
+void SoundplaneModel::setUsbSelector(const std::string &serial, const std::string &port)
+{
+	mUsbSerial = serial;
+	mUsbPort = port;
+}
+
 void SoundplaneModel::initialize()
 {
     addListener(&mOSCOutput);
     addListener(&mMECOutput);
-	mpDriver = SoundplaneDriver::create(this);
+	mpDriver = SoundplaneDriver::create(this, mUsbSerial, mUsbPort);
 
 	// TODO mem err handling
 	if (!mCalibrateData.setDims(kSoundplaneWidth, kSoundplaneHeight, kSoundplaneCalibrateSize))
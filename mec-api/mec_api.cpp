@@ -4,26 +4,27 @@
 #include "mec_prefs.h"
 #include "mec_device.h"
 #include "mec_log.h"
-
-#if !DISABLE_EIGENHARP
-#   include "devices/mec_eigenharp.h"
-#endif
-#if !DISABLE_SOUNDPLANELITE
-#   include "devices/mec_soundplane.h"
-#endif
-#if !DISABLE_PUSH2
-#   include "devices/mec_push2.h"
-#endif
-
-
-#include "devices/mec_mididevice.h"
-#include "devices/mec_osct3d.h"
-#include "devices/mec_kontroldevice.h"
+#include "mec_time.h"
+#include "mec_thread.h"
+#include "mec_stats.h"
+#include "mec_surface.h"
+#include "mec_scaler.h"
+
+#include "mec_deviceworker.h"
+#include "mec_msg_queue.h"
+#include "mec_usbhotplug.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace mec {
 
 /////////////////////////////////////////////////////////
-class MecApi_Impl : public ICallback, public ISurfaceCallback, public IMusicalCallback {
+class MecApi_Impl : public ICallback, public ISurfaceCallback, public IMusicalCallback, public UsbHotplugListener {
 public:
     MecApi_Impl(void *prefs);
     MecApi_Impl(const std::string &configFile);
@@ -32,9 +33,15 @@ public:
     void init();
     void process();  // periodically call to process messages
 
+    bool start();
+    void stop();
+    void dispatchRun();
+
     void subscribe(ICallback *);
     void unsubscribe(ICallback *);
 
+    void subscribe(ITouchFrameCallback *);
+    void unsubscribe(ITouchFrameCallback *);
 
     void subscribe(ISurfaceCallback *);
     void unsubscribe(ISurfaceCallback *);
@@ -49,6 +56,12 @@ public:
     virtual void touchOff(int touchId, float note, float x, float y, float z);
     virtual void control(int ctrlId, float v);
     virtual void mec_control(int cmd, void *other);
+    virtual void flush();
+
+    virtual void touchOn(unsigned long long t, int touchId, float note, float x, float y, float z);
+    virtual void touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z);
+    virtual void touchOff(unsigned long long t, int touchId, float note, float x, float y, float z);
+    virtual void control(unsigned long long t, int ctrlId, float v);
 
     virtual void touchOn(const Touch &);
     virtual void touchContinue(const Touch &);
@@ -58,15 +71,65 @@ public:
     virtual void touchContinue(const MusicalTouch &);
     virtual void touchOff(const MusicalTouch &);
 
+    // hotplug, called on watcher thread
+    virtual void usbChanged();
+    virtual void usbIdle();
+
 private:
-    void initDevices();
+    // a configured device, either a registered name in mec prefs (e.g. soundplane),
+    // or a named instance in "devices", with "type" giving the registered name
+    struct DeviceInstance {
+        DeviceInstance(const std::string &name, const DeviceFactory::Entry *entry, void *prefs)
+                : name_(name), entry_(entry), prefs_(prefs) {
+            // selects one unit, when several of the same type are attached
+            Preferences p(prefs);
+            usbSerial_ = p.getString("usb serial", "");
+            usbPort_ = p.getString("usb port", "");
+        }
+
+        std::string name_;
+        const DeviceFactory::Entry *entry_;
+        void *prefs_;
+        std::string usbSerial_;
+        std::string usbPort_;
+    };
 
+    void initDevices();
+    std::shared_ptr<Device> initDevice(const DeviceInstance &instance);
+    void updateDevices();
+    void deinitRemoved();
+    void frameEnd();
+    void surfaceTouchOn(const Touch &);
+    void surfaceTouchContinue(const Touch &);
+    void surfaceTouchOff(const Touch &);
+
+    std::vector<DeviceInstance> instances_;
     std::vector<std::shared_ptr<Device>> devices_;
     std::unique_ptr<Preferences> fileprefs_; // top level prefs on file
     std::unique_ptr<Preferences> prefs_;     // api prefs
     std::vector<ICallback *> callbacks_;
+    std::vector<ITouchFrameCallback *> frameCallbacks_;
+    TouchFrame frame_;
     std::vector<ISurfaceCallback *> surfaces_;
+    SurfaceManager surfaceManager_; // compiled surface mappings, from "surfaces"
+    Scaler scaler_;                 // surface touch to musical touch, from "scaler"
     std::vector<IMusicalCallback *> musicalsurfaces_;
+
+    MsgSignal signal_;
+    std::atomic<bool> dispatching_;
+    std::chrono::microseconds pollTime_;
+    std::thread dispatchThread_;
+
+    // device changes from hotplug are applied by process(), so devices_ is only used by one thread
+    std::mutex devicesMtx_;
+    std::atomic<bool> devicesChanged_;
+    std::vector<std::shared_ptr<Device>> addDevices_;
+    std::vector<std::shared_ptr<Device>> removeDevices_;
+    std::vector<std::shared_ptr<Device>> removedDevices_; // to deinit, on watcher thread
+    std::map<std::string, std::shared_ptr<Device>> usbDevices_; // by name, owned by watcher thread
+#if !DISABLE_LIBUSB
+    std::unique_ptr<UsbHotplug> hotplug_;
+#endif
 };
 
 
@@ -95,6 +158,14 @@ void MecApi::process() {
     impl_->process();
 }
 
+bool MecApi::start() {
+    return impl_->start();
+}
+
+void MecApi::stop() {
+    impl_->stop();
+}
+
 void MecApi::subscribe(ICallback *p) {
     impl_->subscribe(p);
 
@@ -104,6 +175,15 @@ void MecApi::unsubscribe(ICallback *p) {
     impl_->unsubscribe(p);
 }
 
+void MecApi::subscribe(ITouchFrameCallback *p) {
+    impl_->subscribe(p);
+
+}
+
+void MecApi::unsubscribe(ITouchFrameCallback *p) {
+    impl_->unsubscribe(p);
+}
+
 void MecApi::subscribe(ISurfaceCallback *p) {
     impl_->subscribe(p);
 
@@ -125,23 +205,30 @@ void MecApi::unsubscribe(IMusicalCallback *p) {
 
 /////////////////////////////////////////////////////////
 //MecApi_Impl
-MecApi_Impl::MecApi_Impl(void *prefs) {
+MecApi_Impl::MecApi_Impl(void *prefs) : dispatching_(false), pollTime_(1000), devicesChanged_(false) {
     fileprefs_.reset(new Preferences(prefs));
     prefs_.reset(new Preferences(fileprefs_->getSubTree("mec")));
 }
 
-MecApi_Impl::MecApi_Impl(const std::string &configFile) {
+MecApi_Impl::MecApi_Impl(const std::string &configFile) : dispatching_(false), pollTime_(1000), devicesChanged_(false) {
     fileprefs_.reset(new Preferences(configFile));
     prefs_.reset(new Preferences(fileprefs_->getSubTree("mec")));
 }
 
 MecApi_Impl::~MecApi_Impl() {
     LOG_1("MecApi_Impl::~MecApi_Impl");
+    stop();
+#if !DISABLE_LIBUSB
+    hotplug_.reset();
+#endif
+    updateDevices();
+    deinitRemoved();
     for (std::vector<std::shared_ptr<Device>>::iterator it = devices_.begin(); it != devices_.end(); ++it) {
         LOG_1("device deinit ");
         (*it)->deinit();
     }
     devices_.clear();
+    usbDevices_.clear();
     LOG_1("devices cleared");
     prefs_.reset();
     fileprefs_.reset();
@@ -149,12 +236,99 @@ MecApi_Impl::~MecApi_Impl() {
 
 void MecApi_Impl::init() {
     LOG_1("MecApi_Impl::init");
+    if (prefs_ && prefs_->exists("surfaces")) {
+        surfaceManager_.init(Preferences(prefs_->getSubTree("surfaces")));
+    }
+    if (prefs_ && prefs_->exists("scales")) {
+        Scales::init(Preferences(prefs_->getSubTree("scales")));
+    }
+    if (prefs_ && prefs_->exists("scaler")) {
+        scaler_.load(Preferences(prefs_->getSubTree("scaler")));
+    }
     initDevices();
+
+#if !DISABLE_LIBUSB
+    if (prefs_ && prefs_->getBool("hotplug", false)) {
+        hotplug_.reset(new UsbHotplug(static_cast<unsigned>(prefs_->getInt("hotplug settle time", 500))));
+        if (!hotplug_->start(this)) hotplug_.reset();
+    }
+#endif
 }
 
 void MecApi_Impl::process() {
+    if (devicesChanged_.load(std::memory_order_acquire)) updateDevices();
     for (std::vector<std::shared_ptr<Device>>::iterator it = devices_.begin(); it != devices_.end(); ++it) {
+        frame_.clear();
         (*it)->process();
+        frameEnd();
+    }
+    flush();
+    // touches are only mapped on this thread, so superseded scaler tables can now be freed
+    scaler_.endCycle();
+}
+
+void MecApi_Impl::flush() {
+    for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
+        (*it)->flush();
+    }
+    for (std::vector<ISurfaceCallback *>::iterator it = surfaces_.begin(); it != surfaces_.end(); ++it) {
+        (*it)->flush();
+    }
+    for (std::vector<IMusicalCallback *>::iterator it = musicalsurfaces_.begin(); it != musicalsurfaces_.end(); ++it) {
+        (*it)->flush();
+    }
+}
+
+void MecApi_Impl::frameEnd() {
+    if (frame_.empty()) return;
+    for (std::vector<ITouchFrameCallback *>::iterator it = frameCallbacks_.begin(); it != frameCallbacks_.end(); ++it) {
+        (*it)->frame(frame_);
+    }
+    frame_.clear();
+}
+
+void mecapi_dispatch_func(MecApi_Impl *pThis) {
+    pThis->dispatchRun();
+}
+
+bool MecApi_Impl::start() {
+    if (dispatching_) return true;
+
+    // poll time, is the longest we wait for queued devices, polled devices (eigenharp) are processed at this rate
+    Preferences dprefs(prefs_ ? prefs_->getSubTree("dispatch") : nullptr);
+    pollTime_ = std::chrono::microseconds(dprefs.getInt("poll time", 1000));
+    int priority = dprefs.getInt("priority", 0);
+    int cpu = dprefs.getInt("cpu", -1);
+
+    for (std::vector<std::shared_ptr<Device>>::iterator it = devices_.begin(); it != devices_.end(); ++it) {
+        (*it)->setSignal(&signal_);
+    }
+
+    dispatching_ = true;
+    dispatchThread_ = std::thread(mecapi_dispatch_func, this);
+
+    setThreadPriority(dispatchThread_, priority, cpu, "MecApi_Impl::start");
+    LOG_1("MecApi_Impl::start - dispatch thread started");
+    return true;
+}
+
+void MecApi_Impl::stop() {
+    if (!dispatching_) return;
+    dispatching_ = false;
+    signal_.notify();
+    if (dispatchThread_.joinable()) {
+        dispatchThread_.join();
+    }
+    for (std::vector<std::shared_ptr<Device>>::iterator it = devices_.begin(); it != devices_.end(); ++it) {
+        (*it)->setSignal(nullptr);
+    }
+    LOG_1("MecApi_Impl::stop - dispatch thread stopped");
+}
+
+void MecApi_Impl::dispatchRun() {
+    while (dispatching_) {
+        signal_.wait(pollTime_);
+        process();
     }
 }
 
@@ -171,6 +345,19 @@ void MecApi_Impl::unsubscribe(ICallback *p) {
     }
 }
 
+void MecApi_Impl::subscribe(ITouchFrameCallback *p) {
+    frameCallbacks_.push_back(p);
+}
+
+void MecApi_Impl::unsubscribe(ITouchFrameCallback *p) {
+    for (std::vector<ITouchFrameCallback *>::iterator it = frameCallbacks_.begin(); it != frameCallbacks_.end(); ++it) {
+        if (p == (*it)) {
+            frameCallbacks_.erase(it);
+            return;
+        }
+    }
+}
+
 void MecApi_Impl::subscribe(ISurfaceCallback *p) {
     surfaces_.push_back(p);
 }
@@ -199,27 +386,70 @@ void MecApi_Impl::unsubscribe(IMusicalCallback *p) {
 
 
 void MecApi_Impl::touchOn(int touchId, float note, float x, float y, float z) {
+    touchOn(microtime(), touchId, note, x, y, z);
+}
+
+void MecApi_Impl::touchOn(unsigned long long t, int touchId, float note, float x, float y, float z) {
+    if (!frameCallbacks_.empty()) {
+        // frame full, so send what we have so far
+        if (frame_.touchFull()) frameEnd();
+        frame_.addTouch(t, TouchFrame::T_ON, touchId, note, x, y, z);
+    }
+    MEC_STAT_START(st);
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
-        (*it)->touchOn(touchId, note, x, y, z);
+        (*it)->touchOn(t, touchId, note, x, y, z);
     }
+    MEC_STAT_SINCE(Stats::S_DISPATCH, st);
 }
 
 void MecApi_Impl::touchContinue(int touchId, float note, float x, float y, float z) {
+    touchContinue(microtime(), touchId, note, x, y, z);
+}
+
+void MecApi_Impl::touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z) {
+    if (!frameCallbacks_.empty()) {
+        // frame full, so send what we have so far
+        if (frame_.touchFull()) frameEnd();
+        frame_.addTouch(t, TouchFrame::T_CONTINUE, touchId, note, x, y, z);
+    }
+    MEC_STAT_START(st);
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
-        (*it)->touchContinue(touchId, note, x, y, z);
+        (*it)->touchContinue(t, touchId, note, x, y, z);
     }
+    MEC_STAT_SINCE(Stats::S_DISPATCH, st);
 }
 
 void MecApi_Impl::touchOff(int touchId, float note, float x, float y, float z) {
+    touchOff(microtime(), touchId, note, x, y, z);
+}
+
+void MecApi_Impl::touchOff(unsigned long long t, int touchId, float note, float x, float y, float z) {
+    if (!frameCallbacks_.empty()) {
+        // frame full, so send what we have so far
+        if (frame_.touchFull()) frameEnd();
+        frame_.addTouch(t, TouchFrame::T_OFF, touchId, note, x, y, z);
+    }
+    MEC_STAT_START(st);
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
-        (*it)->touchOff(touchId, note, x, y, z);
+        (*it)->touchOff(t, touchId, note, x, y, z);
     }
+    MEC_STAT_SINCE(Stats::S_DISPATCH, st);
 }
 
 void MecApi_Impl::control(int ctrlId, float v) {
+    control(microtime(), ctrlId, v);
+}
+
+void MecApi_Impl::control(unsigned long long t, int ctrlId, float v) {
+    if (!frameCallbacks_.empty()) {
+        if (frame_.controlFull()) frameEnd();
+        frame_.addControl(t, ctrlId, v);
+    }
+    MEC_STAT_START(st);
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
-        (*it)->control(ctrlId, v);
+        (*it)->control(t, ctrlId, v);
     }
+    MEC_STAT_SINCE(Stats::S_DISPATCH, st);
 }
 
 void MecApi_Impl::mec_control(int cmd, void *other) {
@@ -229,22 +459,53 @@ void MecApi_Impl::mec_control(int cmd, void *other) {
 }
 
 
+// device surface touches are mapped thru the surface graph, before being passed on
 void MecApi_Impl::touchOn(const Touch &t) {
+    if (!surfaceManager_.mapped(t)) {
+        surfaceTouchOn(t);
+        return;
+    }
+    Touch out;
+    if (surfaceManager_.touchOn(t, out)) surfaceTouchOn(out);
+}
+
+void MecApi_Impl::touchContinue(const Touch &t) {
+    if (!surfaceManager_.mapped(t)) {
+        surfaceTouchContinue(t);
+        return;
+    }
+    Touch out;
+    if (surfaceManager_.touchContinue(t, out)) surfaceTouchContinue(out);
+}
+
+void MecApi_Impl::touchOff(const Touch &t) {
+    if (!surfaceManager_.mapped(t)) {
+        surfaceTouchOff(t);
+        return;
+    }
+    Touch out;
+    if (surfaceManager_.touchOff(t, out)) surfaceTouchOff(out);
+}
+
+void MecApi_Impl::surfaceTouchOn(const Touch &t) {
     for (std::vector<ISurfaceCallback *>::iterator it = surfaces_.begin(); it != surfaces_.end(); ++it) {
         (*it)->touchOn(t);
     }
+    if (!musicalsurfaces_.empty()) touchOn(scaler_.map(t));
 }
 
-void MecApi_Impl::touchContinue(const Touch &t) {
+void MecApi_Impl::surfaceTouchContinue(const Touch &t) {
     for (std::vector<ISurfaceCallback *>::iterator it = surfaces_.begin(); it != surfaces_.end(); ++it) {
         (*it)->touchContinue(t);
     }
+    if (!musicalsurfaces_.empty()) touchContinue(scaler_.map(t));
 }
 
-void MecApi_Impl::touchOff(const Touch &t) {
+void MecApi_Impl::surfaceTouchOff(const Touch &t) {
     for (std::vector<ISurfaceCallback *>::iterator it = surfaces_.begin(); it != surfaces_.end(); ++it) {
         (*it)->touchOff(t);
     }
+    if (!musicalsurfaces_.empty()) touchOff(scaler_.map(t));
 }
 
 void MecApi_Impl::touchOn(const MusicalTouch &t) {
@@ -278,111 +539,154 @@ void MecApi_Impl::initDevices() {
         return;
     }
 
-#if !DISABLE_EIGENHARP
-    if (prefs_->exists("eigenharp")) {
-        LOG_1("eigenharp initialise ");
-        std::shared_ptr<Device> device = std::make_shared<Eigenharp>(*this);
-        if (device->init(prefs_->getSubTree("eigenharp"))) {
-            if (device->isActive()) {
-                devices_.push_back(device);
-            } else {
-                LOG_1("eigenharp init inactive ");
-                device->deinit();
-            }
-        } else {
-            LOG_1("eigenharp init failed ");
-            device->deinit();
+    instances_.clear();
+    const std::vector<DeviceFactory::Entry> &entries = DeviceFactory::entries();
+    for (std::vector<DeviceFactory::Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (prefs_->exists(it->name_)) {
+            instances_.push_back(DeviceInstance(it->name_, &(*it), prefs_->getSubTree(it->prefs_)));
         }
     }
-#endif
 
-#if !DISABLE_SOUNDPLANELITE
-    if (prefs_->exists("soundplane")) {
-        LOG_1("soundplane initialise");
-        std::shared_ptr<Device> device = std::make_shared<Soundplane>(*this);
-        if (device->init(prefs_->getSubTree("soundplane"))) {
-            if (device->isActive()) {
-                devices_.push_back(device);
-                LOG_1("soundplane init active ");
-            } else {
-                LOG_1("soundplane init inactive ");
-                device->deinit();
+    if (prefs_->exists("devices")) {
+        Preferences devprefs(prefs_->getSubTree("devices"));
+        std::vector<std::string> names = devprefs.getKeys();
+        for (std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it) {
+            Preferences instprefs(devprefs.getSubTree(*it));
+            std::string type = instprefs.getString("type");
+            const DeviceFactory::Entry *entry = DeviceFactory::find(type);
+            if (entry == nullptr) {
+                LOG_0("MecApi_Impl : unknown device type " << type << " for " << *it);
+                continue;
             }
-        } else {
-            LOG_1("soundplane init failed ");
-            device->deinit();
+            instances_.push_back(DeviceInstance(*it, entry, devprefs.getSubTree(*it)));
         }
     }
-#endif
 
-#if !DISABLE_PUSH2
-    if (prefs_->exists("push2")) {
-        LOG_1("push2 initialise ");
-        std::shared_ptr<Push2> device = std::make_shared<Push2>(*this);
-        Kontrol::KontrolModel::model()->addCallback("push2", device);
-        if (device->init(prefs_->getSubTree("push2"))) {
-            if (device->isActive()) {
-                devices_.push_back(device);
-            } else {
-                LOG_1("push2 init inactive ");
-                device->deinit();
-            }
-        } else {
-            LOG_1("push2 init failed ");
-            device->deinit();
+    // created in factory order, not registration or preference order, stable so instances of a type keep theirs
+    std::stable_sort(instances_.begin(), instances_.end(), [](const DeviceInstance &a, const DeviceInstance &b) {
+        return a.entry_->order_ < b.entry_->order_;
+    });
+
+    // musical outputs only play surface touches, which only some devices send
+    if (!musicalsurfaces_.empty()) {
+        bool surfaceTouches = false;
+        for (std::vector<DeviceInstance>::iterator it = instances_.begin(); it != instances_.end(); ++it) {
+            if (it->entry_->surfaceTouches_) surfaceTouches = true;
+        }
+        if (!surfaceTouches) {
+            LOG_0("MecApi_Impl : musical output, but no configured device sends surface touches (e.g. eigenharp)");
         }
     }
-#endif
 
-    if (prefs_->exists("midi")) {
-        LOG_1("midi initialise ");
-        std::shared_ptr<Device> device = std::make_shared<MidiDevice>(*this);
-        if (device->init(prefs_->getSubTree("midi"))) {
-            if (device->isActive()) {
-                devices_.push_back(device);
-            } else {
-                LOG_1("midi init inactive ");
-                device->deinit();
+    // usb instances of the same type can only be told apart by serial or port
+    for (std::vector<DeviceInstance>::iterator it = instances_.begin(); it != instances_.end(); ++it) {
+        if (it->entry_->usbVendor_ == 0) continue;
+        for (std::vector<DeviceInstance>::iterator oit = it + 1; oit != instances_.end(); ++oit) {
+            if (oit->entry_ == it->entry_ && oit->usbSerial_ == it->usbSerial_ && oit->usbPort_ == it->usbPort_) {
+                LOG_0("MecApi_Impl : " << it->name_ << " and " << oit->name_
+                                       << " need a distinct \"usb serial\" or \"usb port\"");
             }
-        } else {
-            LOG_1("midi init failed ");
-            device->deinit();
         }
     }
 
+    for (std::vector<DeviceInstance>::iterator it = instances_.begin(); it != instances_.end(); ++it) {
+        std::shared_ptr<Device> device = initDevice(*it);
+        if (device) {
+            devices_.push_back(device);
+            if (it->entry_->usbVendor_ != 0) usbDevices_[it->name_] = device;
+        }
+    }
+}
+
+std::shared_ptr<Device> MecApi_Impl::initDevice(const DeviceInstance &instance) {
+    LOG_1(instance.name_ << " initialise ");
+    Preferences prefs(instance.prefs_);
+    std::shared_ptr<Device> device;
+    if (prefs.getBool("worker thread", false)) {
+        device = std::make_shared<DeviceWorker>(instance.name_, instance.entry_->creator_, *this,
+                                                static_cast<ISurfaceCallback *>(this));
+    } else {
+        device = instance.entry_->creator_(*this);
+    }
+
+    if (device->init(instance.prefs_)) {
+        if (device->isActive()) {
+            LOG_1(instance.name_ << " init active ");
+            return device;
+        }
+        LOG_1(instance.name_ << " init inactive ");
+    } else {
+        LOG_1(instance.name_ << " init failed ");
+    }
+    device->deinit();
+    return nullptr;
+}
 
-    if (prefs_->exists("osct3d")) {
-        LOG_1("osct3d initialise ");
-        std::shared_ptr<Device> device = std::make_shared<OscT3D>(*this);
-        if (device->init(prefs_->getSubTree("osct3d"))) {
-            if (device->isActive()) {
-                devices_.push_back(device);
-            } else {
-                LOG_1("osct3d init inactive ");
-                device->deinit();
+void MecApi_Impl::updateDevices() {
+    std::lock_guard<std::mutex> lock(devicesMtx_);
+    for (std::vector<std::shared_ptr<Device>>::iterator it = addDevices_.begin(); it != addDevices_.end(); ++it) {
+        if (dispatching_) (*it)->setSignal(&signal_);
+        devices_.push_back(*it);
+    }
+    for (std::vector<std::shared_ptr<Device>>::iterator it = removeDevices_.begin(); it != removeDevices_.end(); ++it) {
+        for (std::vector<std::shared_ptr<Device>>::iterator dit = devices_.begin(); dit != devices_.end(); ++dit) {
+            if (*dit == *it) {
+                devices_.erase(dit);
+                break;
             }
-        } else {
-            LOG_1("osct3d init failed ");
-            device->deinit();
         }
+        (*it)->setSignal(nullptr);
+        removedDevices_.push_back(*it);
     }
+    addDevices_.clear();
+    removeDevices_.clear();
+    devicesChanged_ = false;
+}
 
-    if (prefs_->exists("kontrol")) {
-        LOG_1("KontrolDevice initialise ");
-        std::shared_ptr<Device> device = std::make_shared<KontrolDevice>(*this);
-        if (device->init(prefs_->getSubTree("Kontrol"))) {
-            if (device->isActive()) {
-                devices_.push_back(device);
-            } else {
-                LOG_1("KontrolDevice init inactive ");
-                device->deinit();
+void MecApi_Impl::deinitRemoved() {
+    std::vector<std::shared_ptr<Device>> removed;
+    {
+        std::lock_guard<std::mutex> lock(devicesMtx_);
+        removed.swap(removedDevices_);
+    }
+    for (std::vector<std::shared_ptr<Device>>::iterator it = removed.begin(); it != removed.end(); ++it) {
+        LOG_1("device deinit (removed)");
+        (*it)->deinit();
+    }
+}
+
+void MecApi_Impl::usbChanged() {
+#if !DISABLE_LIBUSB
+    for (std::vector<DeviceInstance>::iterator it = instances_.begin(); it != instances_.end(); ++it) {
+        const DeviceFactory::Entry *entry = it->entry_;
+        if (entry->usbVendor_ == 0) continue;
+
+        bool attached = hotplug_->isAttached(entry->usbVendor_, entry->usbProduct_, it->usbSerial_, it->usbPort_);
+        std::map<std::string, std::shared_ptr<Device>>::iterator dit = usbDevices_.find(it->name_);
+        if (attached && dit == usbDevices_.end()) {
+            LOG_0("MecApi_Impl : usb device attached " << it->name_);
+            // may take some time, e.g. firmware upload, but we are not on the dispatch thread
+            std::shared_ptr<Device> device = initDevice(*it);
+            if (device) {
+                usbDevices_[it->name_] = device;
+                std::lock_guard<std::mutex> lock(devicesMtx_);
+                addDevices_.push_back(device);
+                devicesChanged_ = true;
             }
-        } else {
-            LOG_1("KontrolDevice init failed ");
-            device->deinit();
+        } else if (!attached && dit != usbDevices_.end()) {
+            LOG_0("MecApi_Impl : usb device detached " << it->name_);
+            std::lock_guard<std::mutex> lock(devicesMtx_);
+            removeDevices_.push_back(dit->second);
+            devicesChanged_ = true;
+            usbDevices_.erase(dit);
         }
     }
+    signal_.notify();
+#endif
+}
 
+void MecApi_Impl::usbIdle() {
+    deinitRemoved();
 }
 
 }
@@ -20,6 +20,27 @@ public:
     virtual void touchOff(int touchId, float note, float x, float y, float z) = 0;
     virtual void control(int ctrlId, float v) = 0;
     virtual void mec_control(int cmd, void* other) = 0;
+
+    // timestamped variants, t is mec::microtime() (uS, monotonic) when the device produced the event
+    // by default these call the untimestamped versions
+    virtual void touchOn(unsigned long long t, int touchId, float note, float x, float y, float z) {
+        touchOn(touchId, note, x, y, z);
+    }
+
+    virtual void touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z) {
+        touchContinue(touchId, note, x, y, z);
+    }
+
+    virtual void touchOff(unsigned long long t, int touchId, float note, float x, float y, float z) {
+        touchOff(touchId, note, x, y, z);
+    }
+
+    virtual void control(unsigned long long t, int ctrlId, float v) {
+        control(ctrlId, v);
+    }
+
+    // end of a dispatch cycle (each MecApi::process()), buffered outputs should send now
+    virtual void flush() { ; }
 };
 
 class Callback : public ICallback {
@@ -32,13 +53,80 @@ public:
     virtual void mec_control(int cmd, void* other) override  {};
 };
 
+// all touch and control updates from a single device frame (one device process cycle)
+// stored as structure of arrays, so batch consumers can emit a frame in one go
+struct TouchFrame {
+    static const unsigned MAX_TOUCHES = 64;
+    static const unsigned MAX_CONTROLS = 32;
+
+    enum TouchState {
+        T_ON,
+        T_CONTINUE,
+        T_OFF
+    };
+
+    TouchFrame() : t_(0), touchCount_(0), controlCount_(0) {
+        ;
+    }
+
+    void clear() {
+        touchCount_ = 0;
+        controlCount_ = 0;
+    }
+
+    bool empty() const { return touchCount_ == 0 && controlCount_ == 0; }
+
+    bool touchFull() const { return touchCount_ == MAX_TOUCHES; }
+
+    bool controlFull() const { return controlCount_ == MAX_CONTROLS; }
+
+    void addTouch(unsigned long long t, TouchState state, int touchId, float note, float x, float y, float z) {
+        if (empty()) t_ = t;
+        unsigned i = touchCount_++;
+        state_[i] = static_cast<unsigned char>(state);
+        id_[i] = touchId;
+        note_[i] = note;
+        x_[i] = x;
+        y_[i] = y;
+        z_[i] = z;
+    }
+
+    void addControl(unsigned long long t, int ctrlId, float v) {
+        if (empty()) t_ = t;
+        unsigned i = controlCount_++;
+        controlId_[i] = ctrlId;
+        controlValue_[i] = v;
+    }
+
+    unsigned long long t_; // frame time, time of first event in frame, uS (see mec::microtime())
+
+    unsigned touchCount_;
+    unsigned char state_[MAX_TOUCHES];
+    int id_[MAX_TOUCHES];
+    float note_[MAX_TOUCHES];
+    float x_[MAX_TOUCHES];
+    float y_[MAX_TOUCHES];
+    float z_[MAX_TOUCHES];
+
+    unsigned controlCount_;
+    int controlId_[MAX_CONTROLS];
+    float controlValue_[MAX_CONTROLS];
+};
+
+class ITouchFrameCallback {
+public:
+    virtual void frame(const TouchFrame &) = 0;
+    virtual ~ITouchFrameCallback() {};
+};
+
 //////////////////////////////////////////
 // new experimental surface api
 //////////////////////////////////////////
 
 
 
-typedef std::string SurfaceID;
+// interned surface name, see internSurface() in mec_surface.h
+typedef unsigned SurfaceID;
 
 
 // represents a single touch on a surface
@@ -79,6 +167,7 @@ public:
     virtual void touchOn(const Touch&) = 0;
     virtual void touchContinue(const Touch&) = 0;
     virtual void touchOff(const Touch&) = 0;
+    virtual void flush() { ; } // end of dispatch cycle
     virtual ~ISurfaceCallback() {};
 };
 
@@ -95,7 +184,14 @@ struct MusicalTouch : public Touch {
         ;
     }
 
+    // position relative to the key (a key is 1 wide, centred on c_, r_), -1 to 1
+    float keyX() const { return keyRelative(x_ - c_); }
+    float keyY() const { return keyRelative(y_ - r_); }
+
     float note_;
+
+private:
+    static float keyRelative(float d) { return d < -0.5f ? -1.0f : (d > 0.5f ? 1.0f : d * 2.0f); }
 };
 
 class IMusicalCallback {
@@ -103,6 +199,7 @@ public:
     virtual void touchOn(const MusicalTouch&) = 0;
     virtual void touchContinue(const MusicalTouch&) = 0;
     virtual void touchOff(const MusicalTouch&) = 0;
+    virtual void flush() { ; } // end of dispatch cycle
     virtual ~IMusicalCallback() {};
 };
 
@@ -115,9 +212,17 @@ public:
     void init();
     void process();  // periodically call to process messages
 
+    // alternative to process(), callbacks are made from a dispatch thread as soon as devices have data
+    // configured with "dispatch" : { "priority", "cpu", "poll time" }, subscribe before starting
+    bool start();
+    void stop();
+
     void subscribe(ICallback*);
     void unsubscribe(ICallback*);
 
+    void subscribe(ITouchFrameCallback*);
+    void unsubscribe(ITouchFrameCallback*);
+
     void subscribe(ISurfaceCallback*);
     void unsubscribe(ISurfaceCallback*);
 
@@ -0,0 +1,45 @@
+#include "mec_device.h"
+
+#include "mec_log.h"
+
+namespace mec {
+
+// function static, as devices register during static initialisation
+static std::vector<DeviceFactory::Entry> &registry() {
+    static std::vector<DeviceFactory::Entry> entries;
+    return entries;
+}
+
+bool DeviceFactory::add(const Entry &entry) {
+    if (find(entry.name_) != nullptr) {
+        LOG_0("DeviceFactory : device already registered " << entry.name_);
+        return false;
+    }
+    registry().push_back(entry);
+    return true;
+}
+
+const std::vector<DeviceFactory::Entry> &DeviceFactory::entries() {
+    return registry();
+}
+
+const DeviceFactory::Entry *DeviceFactory::find(const std::string &name) {
+    std::vector<Entry> &entries = registry();
+    for (std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->name_ == name) return &(*it);
+    }
+    return nullptr;
+}
+
+const DeviceFactory::Entry *DeviceFactory::findUsb(unsigned vendor, unsigned product) {
+    std::vector<Entry> &entries = registry();
+    for (std::vector<Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->usbVendor_ != 0 && it->usbVendor_ == vendor
+            && (it->usbProduct_ == 0 || it->usbProduct_ == product)) {
+            return &(*it);
+        }
+    }
+    return nullptr;
+}
+
+}
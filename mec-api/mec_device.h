@@ -3,8 +3,15 @@
 
 #include "mec_prefs.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace mec {
 
+class MsgSignal;
+class ICallback;
+
 class Device {
 public:
     virtual ~Device() {};
@@ -12,8 +19,68 @@ public:
     virtual bool process() = 0 ;
     virtual void deinit() = 0;
     virtual bool isActive() = 0;
+    // devices with a message queue, signal when messages are added
+    virtual void setSignal(MsgSignal*) {};
+};
+
+// devices register themselves with MEC_REGISTER_DEVICE,
+// MecApi creates those which have an entry (name) in the mec preferences
+// usb devices give their vendor/product id (product 0 = any), so they can be created on hotplug
+// devices are created in order (lowest first), rather than registration (link) order,
+// so a device can rely on another, e.g. push2 uses the kontrol model
+class DeviceFactory {
+public:
+    typedef std::shared_ptr<Device> (*Creator)(ICallback &);
+
+    enum Order {
+        O_FIRST = 0,
+        O_DEFAULT = 50,
+        O_LAST = 100
+    };
+
+    struct Entry {
+        Entry(const char *name, const char *prefs, Creator creator, unsigned usbVendor, unsigned usbProduct,
+              int order, bool surfaceTouches = false)
+                : name_(name), prefs_(prefs), creator_(creator), usbVendor_(usbVendor), usbProduct_(usbProduct),
+                  order_(order), surfaceTouches_(surfaceTouches) { ; }
+
+        std::string name_;  // checked for in preferences
+        std::string prefs_; // preferences subtree passed to init
+        Creator creator_;
+        unsigned usbVendor_;
+        unsigned usbProduct_;
+        int order_;
+        bool surfaceTouches_; // also sends surface touches (ISurfaceCallback), needed for musical outputs
+    };
+
+    static bool add(const Entry &entry);
+    static const std::vector<Entry> &entries();
+    static const Entry *find(const std::string &name);
+    static const Entry *findUsb(unsigned vendor, unsigned product);
 };
 
 }
 
+// order is a DeviceFactory::Order, or any int between
+#define MEC_REGISTER_DEVICE_ENTRY(name, prefs, creator, usbVendor, usbProduct, order, surfaceTouches) \
+    static bool mec_registered_##creator = mec::DeviceFactory::add( \
+        mec::DeviceFactory::Entry(name, prefs, creator, usbVendor, usbProduct, order, surfaceTouches));
+
+#define MEC_REGISTER_DEVICE_CREATOR(name, prefs, creator, usbVendor, usbProduct, order) \
+    MEC_REGISTER_DEVICE_ENTRY(name, prefs, creator, usbVendor, usbProduct, order, false)
+
+#define MEC_DEVICE_CREATE_FN(cls) \
+    static std::shared_ptr<mec::Device> mec_create_##cls(mec::ICallback &cb) { \
+        return std::make_shared<cls>(cb); \
+    }
+
+#define MEC_REGISTER_DEVICE(name, cls, usbVendor, usbProduct, order) \
+    MEC_DEVICE_CREATE_FN(cls) \
+    MEC_REGISTER_DEVICE_ENTRY(name, name, mec_create_##cls, usbVendor, usbProduct, order, false)
+
+// a device which also sends surface touches
+#define MEC_REGISTER_SURFACE_DEVICE(name, cls, usbVendor, usbProduct, order) \
+    MEC_DEVICE_CREATE_FN(cls) \
+    MEC_REGISTER_DEVICE_ENTRY(name, name, mec_create_##cls, usbVendor, usbProduct, order, true)
+
 #endif //MEC_DEVICE
\ No newline at end of file
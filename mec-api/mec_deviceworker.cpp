@@ -0,0 +1,166 @@
+#include "mec_deviceworker.h"
+
+#include "mec_log.h"
+#include "mec_thread.h"
+#include "mec_time.h"
+
+namespace mec {
+
+DeviceWorker::DeviceWorker(const std::string &name, DeviceFactory::Creator creator, ICallback &cb,
+                           ISurfaceCallback *surfaceCb)
+        : name_(name), creator_(creator), callback_(cb), surfaceCallback_(surfaceCb),
+          running_(false), pollTime_(1000) {
+}
+
+DeviceWorker::~DeviceWorker() {
+    deinit();
+}
+
+static void deviceworker_thread_func(DeviceWorker *pThis) {
+    pThis->run();
+}
+
+bool DeviceWorker::init(void *arg) {
+    Preferences prefs(arg);
+    if (running_) deinit();
+
+    queue_.setCapacity(static_cast<unsigned>(prefs.getInt("queue size", MsgQueue::DEFAULT_SIZE)),
+                       static_cast<unsigned>(prefs.getInt("voices", MsgQueue::DEFAULT_TOUCHES)));
+    pollTime_ = std::chrono::microseconds(prefs.getInt("poll time", 1000));
+
+    device_ = creator_(*this);
+    if (!device_->init(arg) || !device_->isActive()) {
+        LOG_0("DeviceWorker init failed for " << name_);
+        return false;
+    }
+    device_->setSignal(&signal_);
+
+    running_ = true;
+    thread_ = std::thread(deviceworker_thread_func, this);
+    std::string tname = "DeviceWorker " + name_;
+    setThreadPriority(thread_, prefs.getInt("priority", 0), prefs.getInt("cpu", -1), tname.c_str());
+    LOG_1("DeviceWorker started for " << name_);
+    return true;
+}
+
+void DeviceWorker::run() {
+    while (running_) {
+        signal_.wait(pollTime_);
+        device_->process();
+        // continues held while the queue was full, if the device has gone quiet
+        queue_.flush();
+    }
+}
+
+bool DeviceWorker::process() {
+    return queue_.process(callback_, surfaceCallback_);
+}
+
+void DeviceWorker::deinit() {
+    if (running_) {
+        running_ = false;
+        signal_.notify();
+        if (thread_.joinable()) thread_.join();
+        LOG_1("DeviceWorker stopped for " << name_);
+    }
+    if (device_) {
+        device_->setSignal(nullptr);
+        device_->deinit();
+        device_.reset();
+    }
+}
+
+bool DeviceWorker::isActive() {
+    return running_ && device_ && device_->isActive();
+}
+
+void DeviceWorker::setSignal(MsgSignal *signal) {
+    queue_.setSignal(signal);
+}
+
+void DeviceWorker::queueTouch(MecMsg::type type, unsigned long long t, int touchId, float note, float x, float y,
+                              float z) {
+    MecMsg msg;
+    msg.type_ = type;
+    msg.data_.touch_.touchId_ = touchId;
+    msg.data_.touch_.note_ = note;
+    msg.data_.touch_.x_ = x;
+    msg.data_.touch_.y_ = y;
+    msg.data_.touch_.z_ = z;
+    msg.data_.touch_.t_ = t;
+    queue_.addToQueue(msg);
+}
+
+void DeviceWorker::touchOn(int touchId, float note, float x, float y, float z) {
+    queueTouch(MecMsg::TOUCH_ON, microtime(), touchId, note, x, y, z);
+}
+
+void DeviceWorker::touchContinue(int touchId, float note, float x, float y, float z) {
+    queueTouch(MecMsg::TOUCH_CONTINUE, microtime(), touchId, note, x, y, z);
+}
+
+void DeviceWorker::touchOff(int touchId, float note, float x, float y, float z) {
+    queueTouch(MecMsg::TOUCH_OFF, microtime(), touchId, note, x, y, z);
+}
+
+void DeviceWorker::control(int ctrlId, float v) {
+    control(microtime(), ctrlId, v);
+}
+
+void DeviceWorker::touchOn(unsigned long long t, int touchId, float note, float x, float y, float z) {
+    queueTouch(MecMsg::TOUCH_ON, t, touchId, note, x, y, z);
+}
+
+void DeviceWorker::touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z) {
+    queueTouch(MecMsg::TOUCH_CONTINUE, t, touchId, note, x, y, z);
+}
+
+void DeviceWorker::touchOff(unsigned long long t, int touchId, float note, float x, float y, float z) {
+    queueTouch(MecMsg::TOUCH_OFF, t, touchId, note, x, y, z);
+}
+
+void DeviceWorker::control(unsigned long long t, int ctrlId, float v) {
+    MecMsg msg;
+    msg.type_ = MecMsg::CONTROL;
+    msg.data_.control_.controlId_ = ctrlId;
+    msg.data_.control_.value_ = v;
+    msg.data_.control_.t_ = t;
+    queue_.addToQueue(msg);
+}
+
+void DeviceWorker::queueSurfaceTouch(MecMsg::type type, const Touch &touch) {
+    MecMsg msg;
+    msg.type_ = type;
+    msg.data_.surface_.touchId_ = touch.id_;
+    msg.data_.surface_.surface_ = touch.surface_;
+    msg.data_.surface_.x_ = touch.x_;
+    msg.data_.surface_.y_ = touch.y_;
+    msg.data_.surface_.z_ = touch.z_;
+    msg.data_.surface_.r_ = touch.r_;
+    msg.data_.surface_.c_ = touch.c_;
+    msg.data_.surface_.t_ = microtime();
+    queue_.addToQueue(msg);
+}
+
+void DeviceWorker::touchOn(const Touch &touch) {
+    queueSurfaceTouch(MecMsg::SURFACE_ON, touch);
+}
+
+void DeviceWorker::touchContinue(const Touch &touch) {
+    queueSurfaceTouch(MecMsg::SURFACE_CONTINUE, touch);
+}
+
+void DeviceWorker::touchOff(const Touch &touch) {
+    queueSurfaceTouch(MecMsg::SURFACE_OFF, touch);
+}
+
+void DeviceWorker::mec_control(int cmd, void *) {
+    if (cmd == ICallback::SHUTDOWN) {
+        MecMsg msg;
+        msg.type_ = MecMsg::MEC_CONTROL;
+        msg.data_.mec_control_.cmd_ = MecMsg::SHUTDOWN;
+        queue_.addToQueue(msg);
+    }
+}
+
+}
@@ -0,0 +1,70 @@
+#ifndef MEC_DEVICEWORKER_H
+#define MEC_DEVICEWORKER_H
+
+#include "mec_api.h"
+#include "mec_device.h"
+#include "mec_msg_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace mec {
+
+// runs a device on its own worker thread, so a slow device (e.g. eigenharp poll) cannot stall others
+// the device calls back to the worker (on the worker thread), which queues the messages,
+// process() (on the dispatch thread) then delivers them to the real callback
+// surface touches are queued too, and delivered to the surface callback (if any)
+// prefs (device) : "worker thread" : true, "poll time" uS, "priority", "cpu"
+class DeviceWorker : public Device, public ICallback, public ISurfaceCallback {
+public:
+    DeviceWorker(const std::string &name, DeviceFactory::Creator creator, ICallback &cb,
+                 ISurfaceCallback *surfaceCb = nullptr);
+    virtual ~DeviceWorker();
+
+    virtual bool init(void *);
+    virtual bool process();
+    virtual void deinit();
+    virtual bool isActive();
+    virtual void setSignal(MsgSignal *);
+
+    void run();
+
+    // ICallback, from device on worker thread
+    virtual void touchOn(int touchId, float note, float x, float y, float z);
+    virtual void touchContinue(int touchId, float note, float x, float y, float z);
+    virtual void touchOff(int touchId, float note, float x, float y, float z);
+    virtual void control(int ctrlId, float v);
+    virtual void mec_control(int cmd, void *other);
+
+    virtual void touchOn(unsigned long long t, int touchId, float note, float x, float y, float z);
+    virtual void touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z);
+    virtual void touchOff(unsigned long long t, int touchId, float note, float x, float y, float z);
+    virtual void control(unsigned long long t, int ctrlId, float v);
+
+    // ISurfaceCallback, from device on worker thread
+    virtual void touchOn(const Touch &touch);
+    virtual void touchContinue(const Touch &touch);
+    virtual void touchOff(const Touch &touch);
+
+private:
+    void queueTouch(MecMsg::type type, unsigned long long t, int touchId, float note, float x, float y, float z);
+    void queueSurfaceTouch(MecMsg::type type, const Touch &touch);
+
+    std::string name_;
+    DeviceFactory::Creator creator_;
+    ICallback &callback_;
+    ISurfaceCallback *surfaceCallback_;
+    std::shared_ptr<Device> device_;
+    MsgQueue queue_;
+    MsgSignal signal_; // wakes worker, when device has data
+    std::atomic<bool> running_;
+    std::chrono::microseconds pollTime_;
+    std::thread thread_;
+};
+
+}
+
+#endif //MEC_DEVICEWORKER_H
@@ -0,0 +1,131 @@
+#ifndef MEC_KEYGEOMETRY_H
+#define MEC_KEYGEOMETRY_H
+
+#include <string>
+
+//
+// key geometry, the physical layout of keys on a device model
+// gives course, row and column for each key, using Touch conventions:
+// row is the 'string', column the position along it (so an eigenharp column of keys is a row)
+// keys are numbered along each string in turn, as the devices report them.
+// tables are generated at compile time, so a key lookup is a single index.
+//
+
+namespace mec {
+
+struct KeyPosition {
+    unsigned char course_;
+    unsigned char row_;
+    unsigned char column_;
+};
+
+namespace keygeometry {
+
+// index sequence (c++11 has no std::index_sequence)
+template<unsigned... I> struct Seq {};
+template<unsigned N, unsigned... I> struct MakeSeq : MakeSeq<N - 1, N - 1, I...> {};
+template<unsigned... I> struct MakeSeq<0, I...> { typedef Seq<I...> type; };
+
+constexpr unsigned sum() { return 0; }
+template<typename... T> constexpr unsigned sum(unsigned len, T... rest) { return len + sum(rest...); }
+
+constexpr unsigned maxOf() { return 0; }
+template<typename... T> constexpr unsigned maxOf(unsigned len, T... rest) {
+    return len > maxOf(rest...) ? len : maxOf(rest...);
+}
+
+// string the key is on, keys past the end stay on the last string
+constexpr unsigned rowOf(unsigned, unsigned row) { return row; }
+template<typename... T> constexpr unsigned rowOf(unsigned key, unsigned row, unsigned len, T... rest) {
+    return (sizeof...(rest) == 0 || key < len) ? row : rowOf(key - len, row + 1, rest...);
+}
+
+constexpr unsigned columnOf(unsigned key) { return key; }
+template<typename... T> constexpr unsigned columnOf(unsigned key, unsigned len, T... rest) {
+    return (sizeof...(rest) == 0 || key < len) ? key : columnOf(key - len, rest...);
+}
+
+// a course of keys, with the length of each string
+template<unsigned Course, unsigned... Lengths>
+struct Layout {
+    static constexpr unsigned KEYS = sum(Lengths...);
+    static constexpr unsigned ROWS = sizeof...(Lengths);
+    static constexpr unsigned COLUMNS = maxOf(Lengths...);
+
+    static constexpr KeyPosition position(unsigned key) {
+        return KeyPosition{static_cast<unsigned char>(Course),
+                           static_cast<unsigned char>(rowOf(key, 0, Lengths...)),
+                           static_cast<unsigned char>(columnOf(key, Lengths...))};
+    }
+};
+
+template<class L, class S> struct Table;
+
+template<class L, unsigned... I>
+struct Table<L, Seq<I...> > {
+    static constexpr KeyPosition keys_[L::KEYS] = {L::position(I)...};
+};
+
+template<class L, unsigned... I>
+constexpr KeyPosition Table<L, Seq<I...> >::keys_[L::KEYS];
+
+template<class L>
+constexpr const KeyPosition *table() {
+    return Table<L, typename MakeSeq<L::KEYS>::type>::keys_;
+}
+
+// device models
+typedef Layout<0, 9, 9> PicoKeys;
+typedef Layout<1, 4> PicoModeKeys;
+typedef Layout<0, 16, 16, 20, 20, 12> TauKeys;       // last string is percussion
+typedef Layout<0, 24, 24, 24, 24, 24> AlphaKeys;
+typedef Layout<1, 12> AlphaPercussionKeys;
+typedef Layout<0, 30, 30, 30, 30, 30> SoundplaneKeys;  // 5 rows of 30
+
+} // keygeometry
+
+
+struct KeyGeometry {
+    struct Course {
+        unsigned keys_;
+        const KeyPosition *positions_;
+    };
+    static const unsigned MAX_COURSES = 2;
+
+    const char *name_;
+    unsigned rows_;     // main course
+    unsigned columns_;  // longest string, main course
+    Course courses_[MAX_COURSES];
+
+    unsigned keys(unsigned course = 0) const {
+        return course < MAX_COURSES ? courses_[course].keys_ : 0;
+    }
+
+    // null if no such key
+    const KeyPosition *position(unsigned course, unsigned key) const {
+        return course < MAX_COURSES && key < courses_[course].keys_ ? &courses_[course].positions_[key] : nullptr;
+    }
+
+    // pico, tau, alpha, soundplane; null if unknown
+    static const KeyGeometry *find(const std::string &name) {
+        using namespace keygeometry;
+        static const KeyGeometry models[] = {
+                {"pico", PicoKeys::ROWS, PicoKeys::COLUMNS,
+                        {{PicoKeys::KEYS, table<PicoKeys>()}, {PicoModeKeys::KEYS, table<PicoModeKeys>()}}},
+                {"tau", TauKeys::ROWS, TauKeys::COLUMNS,
+                        {{TauKeys::KEYS, table<TauKeys>()}, {0, nullptr}}},
+                {"alpha", AlphaKeys::ROWS, AlphaKeys::COLUMNS,
+                        {{AlphaKeys::KEYS, table<AlphaKeys>()}, {AlphaPercussionKeys::KEYS, table<AlphaPercussionKeys>()}}},
+                {"soundplane", SoundplaneKeys::ROWS, SoundplaneKeys::COLUMNS,
+                        {{SoundplaneKeys::KEYS, table<SoundplaneKeys>()}, {0, nullptr}}},
+        };
+        for (unsigned i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+            if (name == models[i].name_) return &models[i];
+        }
+        return nullptr;
+    }
+};
+
+}
+
+#endif //MEC_KEYGEOMETRY_H
@@ -2,45 +2,127 @@
 
 #include "mec_api.h"
 #include "mec_log.h"
+#include "mec_stats.h"
 
 namespace mec {
 
-const int RING_BUFFER_SIZE = 30;
+static const unsigned MIN_QUEUE_SIZE = 8;
+static const unsigned CACHE_LINE_SIZE = 64;
 
 
 class MsgQueue_impl {
 public:
-    MsgQueue_impl();
+    MsgQueue_impl(unsigned size, unsigned touches);
     ~MsgQueue_impl();
 
+    unsigned capacity();
+    unsigned touches();
     bool addToQueue(MecMsg &);
+    void flush();
     bool nextMsg(MecMsg &);
     bool isEmpty();
     bool isFull();
     int available();
     int pending();
+    bool process(ICallback &, ISurfaceCallback *);
+
+    bool coalesce_;
+    std::atomic<MsgSignal *> signal_;
 
 private:
-    MecMsg queue_[RING_BUFFER_SIZE];
-    // unsigned readPtr_;
-    // unsigned writePtr_;
-    volatile unsigned readPtr_;
-    volatile unsigned writePtr_;
+    void dispatch(ICallback &, ISurfaceCallback *, const MecMsg &msg);
+    void consume(ICallback &, ISurfaceCallback *, const MecMsg &msg);
+
+    bool push(const MecMsg &msg, unsigned limit);
+    bool hold(const MecMsg &msg);
+    void unhold(unsigned id);
+    void flushHeld();
+
+    // fixed after construction
+    std::unique_ptr<MecMsg[]> queue_;
+    unsigned capacity_;
+    unsigned mask_;
+    unsigned continueLimit_; // continues cannot use the last slots, these are kept for on/off
+    unsigned touches_;
+
+    // indexes are free running, and masked on access
+    // producer and consumer are kept on separate cache lines
+    char pad0_[CACHE_LINE_SIZE];
+    std::atomic<unsigned> writePtr_;
+    unsigned readCache_;
+    char pad1_[CACHE_LINE_SIZE];
+    std::atomic<unsigned> readPtr_;
+    char pad2_[CACHE_LINE_SIZE];
+
+    // consumer only, latest continue for each touch within a process() call
+    std::unique_ptr<MecMsg[]> latest_;
+    std::unique_ptr<bool[]> dirty_;
+    std::unique_ptr<unsigned[]> dirtyIds_;
+    unsigned dirtyCount_;
+
+    // producer only, latest continue for touches that did not fit, in the order they were held
+    // these are queued by the producer on its next add (or flush), so the consumer never touches them
+    unsigned heldCount_;
+    std::unique_ptr<MecMsg[]> held_;
+    std::unique_ptr<bool[]> isHeld_;
+    std::unique_ptr<unsigned[]> heldIds_;
 };
 
 
+/////////// MsgSignal
+MsgSignal::MsgSignal() : pending_(false) {
+}
+
+void MsgSignal::notify() {
+    if (!pending_.exchange(true, std::memory_order_acq_rel)) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        cond_.notify_one();
+    }
+}
+
+bool MsgSignal::wait(std::chrono::microseconds timeout) {
+    if (!pending_.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cond_.wait_for(lock, timeout, [this] { return pending_.load(std::memory_order_acquire); });
+    }
+    return pending_.exchange(false, std::memory_order_acq_rel);
+}
+
+
 /////////// Public Interface
-MsgQueue::MsgQueue() {
-    impl_.reset(new MsgQueue_impl());
+MsgQueue::MsgQueue(unsigned size, unsigned touches) {
+    impl_.reset(new MsgQueue_impl(size, touches));
 }
 
 MsgQueue::~MsgQueue() {
 }
 
+void MsgQueue::setCapacity(unsigned size, unsigned touches) {
+    if (size != impl_->capacity() || touches != impl_->touches()) {
+        bool coalesce = impl_->coalesce_;
+        MsgSignal *signal = impl_->signal_.load();
+        impl_.reset(new MsgQueue_impl(size, touches));
+        impl_->coalesce_ = coalesce;
+        impl_->signal_.store(signal);
+    }
+}
+
+unsigned MsgQueue::capacity() {
+    return impl_->capacity();
+}
+
+unsigned MsgQueue::touches() {
+    return impl_->touches();
+}
+
 bool MsgQueue::addToQueue(MecMsg &msg) {
     return impl_->addToQueue(msg);
 }
 
+void MsgQueue::flush() {
+    impl_->flush();
+}
+
 bool MsgQueue::nextMsg(MecMsg &msg) {
     return impl_->nextMsg(msg);
 }
@@ -61,39 +143,157 @@ int MsgQueue::pending() {
     return impl_->pending();
 }
 
+void MsgQueue::setCoalesce(bool coalesce) {
+    impl_->coalesce_ = coalesce;
+}
+
+void MsgQueue::setSignal(MsgSignal *signal) {
+    impl_->signal_.store(signal);
+}
+
+bool MsgQueue::process(ICallback &c, ISurfaceCallback *surface) {
+    return impl_->process(c, surface);
+}
+
 
 /////////// Implementation
-MsgQueue_impl::MsgQueue_impl() {
-    writePtr_ = readPtr_ = 0;
+MsgQueue_impl::MsgQueue_impl(unsigned size, unsigned touches) {
+    capacity_ = MIN_QUEUE_SIZE;
+    while (capacity_ < size) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    continueLimit_ = capacity_ - (capacity_ / 4);
+    queue_.reset(new MecMsg[capacity_]);
+
+    touches_ = touches > 0 ? touches : 1;
+    latest_.reset(new MecMsg[touches_]);
+    dirty_.reset(new bool[touches_]());
+    dirtyIds_.reset(new unsigned[touches_]);
+    dirtyCount_ = 0;
+    heldCount_ = 0;
+    held_.reset(new MecMsg[touches_]);
+    isHeld_.reset(new bool[touches_]());
+    heldIds_.reset(new unsigned[touches_]);
+
+    writePtr_.store(0);
+    readPtr_.store(0);
+    readCache_ = 0;
+    coalesce_ = false;
+    signal_.store(nullptr);
 }
 
 MsgQueue_impl::~MsgQueue_impl() {
 
 }
 
-bool MsgQueue_impl::addToQueue(MecMsg &msg) {
-    unsigned next = (writePtr_ + 1) % RING_BUFFER_SIZE;
+unsigned MsgQueue_impl::capacity() {
+    return capacity_;
+}
 
-    if (next == readPtr_) {
-        LOG_0("MsgQueue_impl : ring buffer overflow");
+unsigned MsgQueue_impl::touches() {
+    return touches_;
+}
+
+bool MsgQueue_impl::push(const MecMsg &msg, unsigned limit) {
+    unsigned w = writePtr_.load(std::memory_order_relaxed);
+    if (w - readCache_ >= limit) {
+        readCache_ = readPtr_.load(std::memory_order_acquire);
+        // high water is taken here, from the refreshed cache, so the producer only reads the consumer's index
+        // when it is already near the limit (lower levels are not recorded)
+        MEC_STAT_HIGH_WATER(Stats::C_QUEUE_HIGH_WATER, static_cast<unsigned long long>(w - readCache_));
+        if (w - readCache_ >= limit) return false;
+    }
+    queue_[w & mask_] = msg;
+    writePtr_.store(w + 1, std::memory_order_release);
+    return true;
+}
+
+// hold, unhold and flushHeld are only called by the producer
+bool MsgQueue_impl::hold(const MecMsg &msg) {
+    unsigned id = static_cast<unsigned>(msg.data_.touch_.touchId_);
+    if (id >= touches_) {
+        LOG_0("MsgQueue_impl : ring buffer overflow, continue dropped, touch id " << id << " >= touches " << touches_);
+        MEC_STAT_COUNT(Stats::C_QUEUE_OVERFLOW);
         return false;
     }
-    queue_[writePtr_] = msg;
-    writePtr_ = next;
+    held_[id] = msg;
+    if (!isHeld_[id]) {
+        isHeld_[id] = true;
+        heldIds_[heldCount_++] = id;
+    }
+    MEC_STAT_COUNT(Stats::C_QUEUE_HELD);
     return true;
 }
 
-bool MsgQueue_impl::nextMsg(MecMsg &msg) {
-    if (readPtr_ != writePtr_) {
-        msg = queue_[readPtr_];
-        readPtr_ = (readPtr_ + 1) % RING_BUFFER_SIZE;
-        return true;
+void MsgQueue_impl::unhold(unsigned id) {
+    if (id >= touches_ || !isHeld_[id]) return;
+    isHeld_[id] = false;
+    unsigned j = 0;
+    for (unsigned i = 0; i < heldCount_; i++) {
+        if (heldIds_[i] != id) heldIds_[j++] = heldIds_[i];
     }
-    return false;
+    heldCount_ = j;
+}
+
+void MsgQueue_impl::flushHeld() {
+    unsigned i = 0;
+    for (; i < heldCount_; i++) {
+        unsigned id = heldIds_[i];
+        if (!push(held_[id], continueLimit_)) break;
+        isHeld_[id] = false;
+    }
+    if (i == 0) return;
+    for (unsigned j = i; j < heldCount_; j++) heldIds_[j - i] = heldIds_[j];
+    heldCount_ -= i;
+}
+
+void MsgQueue_impl::flush() {
+    if (heldCount_ == 0) return;
+    flushHeld();
+    MsgSignal *signal = signal_.load(std::memory_order_acquire);
+    if (signal) signal->notify();
+}
+
+bool MsgQueue_impl::addToQueue(MecMsg &msg) {
+    bool ret;
+    if (heldCount_ > 0) {
+        if (msg.type_ == MecMsg::TOUCH_ON || msg.type_ == MecMsg::TOUCH_OFF) {
+            // this message has the latest state for the touch, so its held continue is stale
+            unhold(static_cast<unsigned>(msg.data_.touch_.touchId_));
+        }
+        flushHeld();
+    }
+    if (msg.type_ == MecMsg::TOUCH_CONTINUE) {
+        // if there are still held continues, we must hold this too, to keep touch ordering
+        ret = (heldCount_ == 0 && push(msg, continueLimit_)) || hold(msg);
+    } else {
+        if (msg.type_ == MecMsg::SURFACE_CONTINUE) {
+            // surface continues are not coalesced, but must leave room for on/off
+            ret = push(msg, continueLimit_);
+            if (!ret) MEC_STAT_COUNT(Stats::C_QUEUE_OVERFLOW);
+        } else {
+            ret = push(msg, capacity_);
+            if (!ret) {
+                LOG_0("MsgQueue_impl : ring buffer overflow");
+                MEC_STAT_COUNT(Stats::C_QUEUE_OVERFLOW);
+            }
+        }
+    }
+
+    MsgSignal *signal = signal_.load(std::memory_order_acquire);
+    if (signal) signal->notify();
+    return ret;
+}
+
+bool MsgQueue_impl::nextMsg(MecMsg &msg) {
+    unsigned r = readPtr_.load(std::memory_order_relaxed);
+    if (r == writePtr_.load(std::memory_order_acquire)) return false;
+    msg = queue_[r & mask_];
+    readPtr_.store(r + 1, std::memory_order_release);
+    return true;
 }
 
 bool MsgQueue_impl::isEmpty() {
-    return readPtr_ == writePtr_;
+    return pending() == 0;
 }
 
 bool MsgQueue_impl::isFull() {
@@ -101,63 +301,141 @@ bool MsgQueue_impl::isFull() {
 }
 
 int MsgQueue_impl::available() {
-    return RING_BUFFER_SIZE - pending();
-
+    return capacity_ - pending();
 }
 
 int MsgQueue_impl::pending() {
-    if (writePtr_ >= readPtr_) {
-        return writePtr_ - readPtr_;
-    }
+    unsigned r = readPtr_.load(std::memory_order_acquire);
+    unsigned w = writePtr_.load(std::memory_order_acquire);
+    return static_cast<int>(w - r);
+}
 
-    return writePtr_ + RING_BUFFER_SIZE - readPtr_;
+static inline unsigned long long msgTime(const MecMsg &msg) {
+    switch (msg.type_) {
+        case MecMsg::CONTROL:
+            return msg.data_.control_.t_;
+        case MecMsg::SURFACE_ON:
+        case MecMsg::SURFACE_CONTINUE:
+        case MecMsg::SURFACE_OFF:
+            return msg.data_.surface_.t_;
+        default:
+            return msg.data_.touch_.t_;
+    }
 }
 
-bool MsgQueue::process(ICallback &c) {
-    MecMsg msg;
-    while (nextMsg(msg)) {
+void MsgQueue_impl::consume(ICallback &c, ISurfaceCallback *surface, const MecMsg &msg) {
+    if (coalesce_) {
+        // only the latest continue for a touch is delivered, on/off ordering is preserved
+        unsigned id = static_cast<unsigned>(msg.data_.touch_.touchId_);
         switch (msg.type_) {
-            case MecMsg::TOUCH_ON:
-                c.touchOn(
-                        msg.data_.touch_.touchId_,
-                        msg.data_.touch_.note_,
-                        msg.data_.touch_.x_,
-                        msg.data_.touch_.y_,
-                        msg.data_.touch_.z_);
-                break;
             case MecMsg::TOUCH_CONTINUE:
-                c.touchContinue(
-                        msg.data_.touch_.touchId_,
-                        msg.data_.touch_.note_,
-                        msg.data_.touch_.x_,
-                        msg.data_.touch_.y_,
-                        msg.data_.touch_.z_);
+                if (id < touches_) {
+                    latest_[id] = msg;
+                    if (!dirty_[id]) {
+                        dirty_[id] = true;
+                        dirtyIds_[dirtyCount_++] = id;
+                    }
+                    return;
+                }
                 break;
+            case MecMsg::TOUCH_ON:
             case MecMsg::TOUCH_OFF:
-                c.touchOff(
-                        msg.data_.touch_.touchId_,
-                        msg.data_.touch_.note_,
-                        msg.data_.touch_.x_,
-                        msg.data_.touch_.y_,
-                        msg.data_.touch_.z_);
-                break;
-            case MecMsg::CONTROL :
-                c.control(
-                        msg.data_.control_.controlId_,
-                        msg.data_.control_.value_);
-                break;
-
-            case MecMsg::MEC_CONTROL :
-                if (msg.data_.mec_control_.cmd_ == MecMsg::SHUTDOWN) {
-                    LOG_1("posting shutdown request");
-                    c.mec_control(ICallback::SHUTDOWN, nullptr);
+                if (id < touches_ && dirty_[id]) {
+                    dirty_[id] = false;
+                    unsigned j = 0;
+                    for (unsigned i = 0; i < dirtyCount_; i++) {
+                        if (dirtyIds_[i] != id) dirtyIds_[j++] = dirtyIds_[i];
+                    }
+                    dirtyCount_ = j;
+                    dispatch(c, surface, latest_[id]);
                 }
+                break;
             default:
-                LOG_0("MsgQueue::process unhandled message type");
+                break;
         }
     }
+    dispatch(c, surface, msg);
+}
+
+bool MsgQueue_impl::process(ICallback &c, ISurfaceCallback *surface) {
+    // only process what is already queued, so a busy producer cannot keep us here
+    int n = pending();
+    MecMsg msg;
+    while (n-- > 0 && nextMsg(msg)) {
+        if (msg.type_ != MecMsg::MEC_CONTROL) MEC_STAT_SINCE(Stats::S_QUEUE_RESIDENCY, msgTime(msg));
+        consume(c, surface, msg);
+    }
+
+    for (unsigned i = 0; i < dirtyCount_; i++) {
+        unsigned id = dirtyIds_[i];
+        dirty_[id] = false;
+        dispatch(c, surface, latest_[id]);
+    }
+    dirtyCount_ = 0;
     return true;
 }
 
+static inline Touch surfaceTouch(const MecMsg &msg) {
+    return Touch(msg.data_.surface_.touchId_, msg.data_.surface_.surface_,
+                 msg.data_.surface_.x_, msg.data_.surface_.y_, msg.data_.surface_.z_,
+                 msg.data_.surface_.r_, msg.data_.surface_.c_);
+}
+
+void MsgQueue_impl::dispatch(ICallback &c, ISurfaceCallback *surface, const MecMsg &msg) {
+    switch (msg.type_) {
+        case MecMsg::TOUCH_ON:
+            c.touchOn(
+                    msg.data_.touch_.t_,
+                    msg.data_.touch_.touchId_,
+                    msg.data_.touch_.note_,
+                    msg.data_.touch_.x_,
+                    msg.data_.touch_.y_,
+                    msg.data_.touch_.z_);
+            break;
+        case MecMsg::TOUCH_CONTINUE:
+            c.touchContinue(
+                    msg.data_.touch_.t_,
+                    msg.data_.touch_.touchId_,
+                    msg.data_.touch_.note_,
+                    msg.data_.touch_.x_,
+                    msg.data_.touch_.y_,
+                    msg.data_.touch_.z_);
+            break;
+        case MecMsg::TOUCH_OFF:
+            c.touchOff(
+                    msg.data_.touch_.t_,
+                    msg.data_.touch_.touchId_,
+                    msg.data_.touch_.note_,
+                    msg.data_.touch_.x_,
+                    msg.data_.touch_.y_,
+                    msg.data_.touch_.z_);
+            break;
+        case MecMsg::CONTROL :
+            c.control(
+                    msg.data_.control_.t_,
+                    msg.data_.control_.controlId_,
+                    msg.data_.control_.value_);
+            break;
+
+        case MecMsg::MEC_CONTROL :
+            if (msg.data_.mec_control_.cmd_ == MecMsg::SHUTDOWN) {
+                LOG_1("posting shutdown request");
+                c.mec_control(ICallback::SHUTDOWN, nullptr);
+            }
+            break;
+        case MecMsg::SURFACE_ON :
+            if (surface) surface->touchOn(surfaceTouch(msg));
+            break;
+        case MecMsg::SURFACE_CONTINUE :
+            if (surface) surface->touchContinue(surfaceTouch(msg));
+            break;
+        case MecMsg::SURFACE_OFF :
+            if (surface) surface->touchOff(surfaceTouch(msg));
+            break;
+        default:
+            LOG_0("MsgQueue::process unhandled message type");
+    }
+}
+
 
 }
\ No newline at end of file
@@ -2,10 +2,15 @@
 #define MECMSGQUEUE_H
 
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 namespace mec {
 
 class ICallback;
+class ISurfaceCallback;
 
 struct MecMsg {
     enum type {
@@ -13,7 +18,10 @@ struct MecMsg {
         TOUCH_CONTINUE,
         TOUCH_OFF,
         CONTROL,
-        MEC_CONTROL
+        MEC_CONTROL,
+        SURFACE_ON,        // surface touches, queued for ISurfaceCallback (device worker)
+        SURFACE_CONTINUE,
+        SURFACE_OFF
     } type_;
 
     enum mec_cmd {
@@ -25,30 +33,72 @@ struct MecMsg {
         struct {
             int     touchId_;
             float   note_, x_, y_, z_;
+            unsigned long long t_; // mec::microtime()
         } touch_;
         struct {
             int     controlId_;
             float   value_;
+            unsigned long long t_; // mec::microtime()
         } control_;
         struct {
             mec_cmd cmd_;
         } mec_control_;
+        struct {
+            int     touchId_;
+            unsigned surface_; // SurfaceID
+            float   x_, y_, z_, r_, c_;
+            unsigned long long t_; // mec::microtime(), when queued
+        } surface_;
     } data_;
 };
 
+// wakes a consumer waiting on one or more queues
+// notify() only takes the lock on the first message since the last wait()
+class MsgSignal {
+public:
+    MsgSignal();
+    void notify();
+    // returns true if notified, false on timeout
+    bool wait(std::chrono::microseconds timeout);
+
+private:
+    std::atomic<bool> pending_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+};
+
 class MsgQueue_impl;
 
+// single producer (device thread) / single consumer (process()) queue
+// capacity is always a power of 2
+// when the queue is nearly full, TOUCH_CONTINUE messages are coalesced per touch
+// (latest wins) so there is always room left for TOUCH_ON/TOUCH_OFF
+// held continues stay with the producer, and are queued by its next add (or flush), so process() never waits on it
+// touches is the number of touch ids (0..touches-1) the device uses, continues for others are dropped when full
+// in coalesce mode, process() delivers at most one TOUCH_CONTINUE per touch per call
 class MsgQueue {
 public:
-    MsgQueue();
+    static const unsigned DEFAULT_SIZE = 128;
+    static const unsigned DEFAULT_TOUCHES = 64;
+
+    MsgQueue(unsigned size = DEFAULT_SIZE, unsigned touches = DEFAULT_TOUCHES);
     ~MsgQueue();
+    // not thread safe, only call before the producer/consumer are started
+    void setCapacity(unsigned size, unsigned touches = DEFAULT_TOUCHES);
+    unsigned capacity();
+    unsigned touches();
+    void setCoalesce(bool);
+    void setSignal(MsgSignal *);
     bool addToQueue(MecMsg&);
+    // producer only, queue held continues if there is now room (e.g. from an idle producer loop)
+    void flush();
     bool nextMsg(MecMsg&);
     bool isEmpty();
     bool isFull();
     int  available();
     int  pending();
-    bool process(ICallback&);
+    // surface messages are delivered to surface, or dropped if null
+    bool process(ICallback&, ISurfaceCallback* surface = nullptr);
 
 private:
     std::unique_ptr<MsgQueue_impl> impl_;
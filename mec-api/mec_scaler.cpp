@@ -1,5 +1,9 @@
 #include "mec_scaler.h"
 
+#include "mec_log.h"
+
+#include <math.h>
+
 namespace mec {
 
 
@@ -39,90 +43,212 @@ bool Scales::init(const Preferences &p) {
 }
 
 const ScaleArray &Scales::getScale(const std::string &name) {
-    return scaleManager.scales_[name];
+    static const ScaleArray empty;
+    std::map<std::string, ScaleArray>::const_iterator it = scaleManager.scales_.find(name);
+    return it != scaleManager.scales_.end() ? it->second : empty;
 }
 
 
-Scaler::Scaler() :
-        scale_(Scales::getScale("chromatic")),
-        tonic_(0.0f),
-        rowOffset_(0.0f), columnOffset_(0.0f) {
-    ;
-}
+////////////////////////////// ScaleTable ////////////////////////////////////////
 
-Scaler::~Scaler() {
-    ;
+static const ScaleArray &defaultScale() {
+    static const ScaleArray chromatic({0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f});
+    return chromatic;
 }
 
-bool Scaler::load(const Preferences &prefs) {
-    if (!prefs.valid()) return false;
-
-    scale_ = Scales::getScale(prefs.getString("scale", "major"));
-    tonic_ = (float) prefs.getDouble("tonic", 0.0f);
-    rowOffset_ = (float) prefs.getDouble("row offset", 0.0f);
-    columnOffset_ = (float) prefs.getDouble("column offset", 0.0f);
-
-    return true;
+ScaleTable::ScaleTable(const ScaleArray &scale, float tonic, float rowOffset, float columnOffset,
+                       const std::shared_ptr<const Tuning> &tuning) :
+        scale_(scale.size() > 1 ? scale : defaultScale()),
+        tonic_(tonic),
+        rowOffset_(rowOffset), columnOffset_(columnOffset) {
+    // untuned keys
+    for (unsigned i = 0; i <= COLUMNS; i++) {
+        notes_[i] = noteAny(0.0f, (float) i);
+    }
+    tuning_ = tuning;
 }
 
-MusicalTouch Scaler::map(const Touch &t) const {
+float ScaleTable::noteAny(float r, float c) const {
     // see notes above, important 12 note scale has 13 entries!
     // think , row = string , column = fret
-    int ix = (int) t.c_;
+    float fl = floorf(c);
+    int ix = (int) fl;
     int sz = (int) scale_.size() - 1;
+    int octave = ix / sz;
     int n = ix % sz;
+    if (n < 0) {
+        n += sz;
+        octave--;
+    }
 
-    float fx = t.c_ - ix;
+    float fx = c - fl;
 
     float sn0 = scale_[n];
     float sn1 = scale_[n + 1];
 
     float sn = sn0 + ((sn1 - sn0) * fx);
 
-    float note = ((ix / sz) * scale_[sz]) + sn;
+    float note = (octave * scale_[sz]) + sn;
+
+    float key = columnOffset_ + (r * rowOffset_) + tonic_ + note;
+    return tuning_ ? tuning_->pitch(key) : key;
+}
+
 
-    note = columnOffset_ + (t.r_ * rowOffset_) + tonic_ + note;
+////////////////////////////// Scaler ////////////////////////////////////////
 
+Scaler::Scaler() : table_(nullptr), epoch_(0) {
+    update(Scales::getScale("chromatic"), 0.0f, 0.0f, 0.0f, nullptr);
+}
+
+Scaler::~Scaler() {
+    ;
+}
+
+void Scaler::update(const ScaleArray &scale, float tonic, float rowOffset, float columnOffset,
+                    const std::shared_ptr<const Tuning> &tuning) {
+    // caller holds updateMtx_ (or is the constructor)
+    const ScaleTable *t = new ScaleTable(scale, tonic, rowOffset, columnOffset, tuning);
+    std::unique_ptr<const ScaleTable> old(current_.release());
+    current_.reset(t);
+    table_.store(t);
+
+    // a mapper may have loaded a table in the cycle that was current when it was replaced,
+    // once a later cycle has ended, it cannot still be using it
+    unsigned long long epoch = epoch_.load();
+    std::vector<Retired>::iterator it = retired_.begin();
+    while (it != retired_.end()) {
+        if (it->epoch_ < epoch) it = retired_.erase(it);
+        else ++it;
+    }
+    if (old) {
+        Retired r;
+        r.epoch_ = epoch;
+        r.table_ = std::move(old);
+        retired_.push_back(std::move(r));
+    }
+}
+
+unsigned Scaler::retired() const {
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    return static_cast<unsigned>(retired_.size());
+}
+
+bool Scaler::load(const Preferences &prefs) {
+    if (!prefs.valid()) return false;
+
+    std::shared_ptr<Tuning> tuning;
+    std::string scl = prefs.getString("tuning", "");
+    if (scl.size() > 0) {
+        tuning.reset(new Tuning());
+        if (!tuning->loadScl(scl)) {
+            tuning.reset();
+        } else {
+            std::string kbm = prefs.getString("keyboard map", "");
+            if (kbm.size() > 0) tuning->loadKbm(kbm);
+            LOG_1("Scaler: tuning " << tuning->description());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    update(Scales::getScale(prefs.getString("scale", "major")),
+           (float) prefs.getDouble("tonic", 0.0f),
+           (float) prefs.getDouble("row offset", 0.0f),
+           (float) prefs.getDouble("column offset", 0.0f),
+           tuning);
+
+    return true;
+}
+
+MusicalTouch Scaler::map(const Touch &t) const {
+    const ScaleTable *table = this->table();
+    float note = (t.c_ >= 0.0f && t.c_ < ScaleTable::COLUMNS) ? table->note(t.r_, t.c_) : table->noteAny(t.r_, t.c_);
     return MusicalTouch(t, note);
 }
 
+void Scaler::map(const Touch *in, MusicalTouch *out, unsigned count) const {
+    const ScaleTable *table = this->table();
+    for (unsigned i = 0; i < count; i++) {
+        const Touch &t = in[i];
+        float note = (t.c_ >= 0.0f && t.c_ < ScaleTable::COLUMNS) ? table->note(t.r_, t.c_) : table->noteAny(t.r_, t.c_);
+        out[i] = MusicalTouch(t, note);
+    }
+}
+
+void Scaler::notes(const float *r, const float *c, float *note, unsigned count) const {
+    const ScaleTable *table = this->table();
+    const float maxc = (float) ScaleTable::COLUMNS - 0.001f;
+    // clamped, so no branches in the table lookup
+    for (unsigned i = 0; i < count; i++) {
+        float cc = c[i] < 0.0f ? 0.0f : (c[i] > maxc ? maxc : c[i]);
+        note[i] = table->note(r[i], cc);
+    }
+    // then fix up (rare) out of range columns
+    for (unsigned i = 0; i < count; i++) {
+        if (c[i] < 0.0f || c[i] >= ScaleTable::COLUMNS) note[i] = table->noteAny(r[i], c[i]);
+    }
+}
+
 float Scaler::getTonic() const {
-    return tonic_;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    return table()->tonic_;
 }
 
 float Scaler::getRowOffset() const {
-    return rowOffset_;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    return table()->rowOffset_;
 }
 
 float Scaler::getColumnOffset() const {
-    return columnOffset_;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    return table()->columnOffset_;
 }
 
-const ScaleArray &Scaler::getScale() const {
-    return scale_;
+ScaleArray Scaler::getScale() const {
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    return table()->scale_;
 }
 
 void Scaler::setTonic(float f) {
-    tonic_ = f;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    const ScaleTable *t = table();
+    update(t->scale_, f, t->rowOffset_, t->columnOffset_, t->tuning_);
 }
 
 
 void Scaler::setRowOffset(float f) {
-    rowOffset_ = f;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    const ScaleTable *t = table();
+    update(t->scale_, t->tonic_, f, t->columnOffset_, t->tuning_);
 }
 
 
 void Scaler::setColumnOffset(float f) {
-    columnOffset_ = f;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    const ScaleTable *t = table();
+    update(t->scale_, t->tonic_, t->rowOffset_, f, t->tuning_);
 }
 
 
 void Scaler::setScale(const ScaleArray &scale) {
-    scale_ = scale;
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    const ScaleTable *t = table();
+    update(scale, t->tonic_, t->rowOffset_, t->columnOffset_, t->tuning_);
 }
 
 void Scaler::setScale(const std::string &name) {
-    scale_ = Scales::getScale(name);
+    setScale(Scales::getScale(name));
+}
+
+void Scaler::setTuning(const std::shared_ptr<const Tuning> &tuning) {
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    const ScaleTable *t = table();
+    update(t->scale_, t->tonic_, t->rowOffset_, t->columnOffset_, tuning);
+}
+
+std::shared_ptr<const Tuning> Scaler::getTuning() const {
+    std::lock_guard<std::mutex> lock(updateMtx_);
+    return table()->tuning_;
 }
 
 
@@ -3,12 +3,15 @@
 
 #include "mec_prefs.h"
 #include "mec_api.h"
+#include "mec_tuning.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <map>
 
-// NOT USED YET INTERFACE EXPERIMENT ONLY
-// 
+//
 // Scaler is used to map a surface to a musical output .. notes
 // e.g. r/c  to note
 
@@ -26,6 +29,15 @@
 // a 12 note scales has 13 entries, we need this for the last interval, and also octave size.
 // we dont care what the last number is, it just has to be same tone as 0.0, but an octave higher
 // we use linear interp beween notes in scale
+//
+// each scale/tonic/offset combination is compiled into a ScaleTable, a dense table of notes per column
+// so map() is a lookup and lerp. setters build a new table and swap it in atomically, so they can be called
+// (e.g. from kontrol) while another thread is mapping touches, without blocking it.
+// the mapping thread calls endCycle() between batches (MecApi does, per dispatch cycle),
+// superseded tables are freed by a later setter, once a cycle has ended since they were replaced.
+//
+// the resulting note is a key number, which is then retuned if a tuning (scala .scl/.kbm) is given,
+// e.g. "tuning" : "just.scl", "keyboard map" : "just.kbm", with the chromatic scale.
 
 
 
@@ -48,6 +60,32 @@ private:
 };
 
 
+// compiled scaler settings, immutable once built
+struct ScaleTable {
+    static const unsigned COLUMNS = 256;
+
+    ScaleTable(const ScaleArray &scale, float tonic, float rowOffset, float columnOffset,
+               const std::shared_ptr<const Tuning> &tuning);
+
+    // branch free for 0 <= c < COLUMNS (apart from tuning)
+    inline float note(float r, float c) const {
+        int ix = (int) c;
+        float n0 = notes_[ix];
+        float key = n0 + ((notes_[ix + 1] - n0) * (c - ix)) + (r * rowOffset_);
+        return tuning_ ? tuning_->pitch(key) : key;
+    }
+
+    // any column, including negative
+    float noteAny(float r, float c) const;
+
+    ScaleArray scale_;
+    float tonic_;
+    float rowOffset_;
+    float columnOffset_;
+    std::shared_ptr<const Tuning> tuning_;
+    float notes_[COLUMNS + 1]; // note at each whole column, incl. tonic and column offset
+};
+
 class Scaler {
 public:
     Scaler();
@@ -55,11 +93,15 @@ public:
     bool load(const Preferences &prefs);
 
     virtual MusicalTouch map(const Touch &t) const;
+    // batch mapping, all touches use the same table
+    void map(const Touch *in, MusicalTouch *out, unsigned count) const;
+    // r/c arrays to notes, the main loop is branch free (vectorisable)
+    void notes(const float *r, const float *c, float *note, unsigned count) const;
 
     float getTonic() const;
     float getRowOffset() const;
     float getColumnOffset() const;
-    const ScaleArray &getScale() const;
+    ScaleArray getScale() const;
 
     void setTonic(float);
     void setRowOffset(float);
@@ -68,12 +110,39 @@ public:
     void setScale(const ScaleArray &scale);
     void setScale(const std::string &name);
 
-private:
-    float tonic_;
-    float rowOffset_;
-    float columnOffset_;
+    // null for 12 tone equal temperament
+    void setTuning(const std::shared_ptr<const Tuning> &tuning);
+    std::shared_ptr<const Tuning> getTuning() const;
 
-    ScaleArray scale_;
+    // mapping thread, no table from before this call is still in use
+    void endCycle() { epoch_.fetch_add(1); }
+
+    // superseded tables not yet freed
+    unsigned retired() const;
+
+private:
+    Scaler(const Scaler &) = delete;
+    Scaler &operator=(const Scaler &) = delete;
+
+    // seq_cst, paired with the epoch, so a setter either sees the cycle end or the mapper sees the new table
+    const ScaleTable *table() const {
+        return table_.load();
+    }
+
+    void update(const ScaleArray &scale, float tonic, float rowOffset, float columnOffset,
+                const std::shared_ptr<const Tuning> &tuning);
+
+    struct Retired {
+        unsigned long long epoch_; // epoch when replaced
+        std::unique_ptr<const ScaleTable> table_;
+    };
+
+    std::atomic<const ScaleTable *> table_;
+    std::atomic<unsigned long long> epoch_; // mapping cycles ended
+    // setters (and getters, as setters free tables) are serialised
+    mutable std::mutex updateMtx_;
+    std::unique_ptr<const ScaleTable> current_;
+    std::vector<Retired> retired_;
 };
 
 }
@@ -0,0 +1,159 @@
+#include "mec_stats.h"
+
+#include <atomic>
+
+namespace mec {
+
+#ifndef DISABLE_STATS
+
+// relaxed ordering throughout, stats are only ever approximate snapshots
+struct StageStats {
+    std::atomic<unsigned long long> count_;
+    std::atomic<unsigned long long> sum_;
+    std::atomic<unsigned long long> max_;
+    std::atomic<unsigned long long> buckets_[Stats::BUCKETS];
+    // keep stages on separate cache lines, they are written from different threads
+    char pad_[64];
+};
+
+static StageStats stages_[Stats::S_MAX];
+static std::atomic<unsigned long long> counters_[Stats::C_MAX];
+
+static inline unsigned bucket(unsigned long long uS) {
+    unsigned b = 0;
+    while (uS > 0 && b < Stats::BUCKETS - 1) {
+        uS >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static inline void atomicMax(std::atomic<unsigned long long> &a, unsigned long long v) {
+    unsigned long long cur = a.load(std::memory_order_relaxed);
+    while (v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) { ; }
+}
+
+bool Stats::enabled() {
+    return true;
+}
+
+void Stats::record(Stage stage, unsigned long long uS) {
+    StageStats &s = stages_[stage];
+    s.count_.fetch_add(1, std::memory_order_relaxed);
+    s.sum_.fetch_add(uS, std::memory_order_relaxed);
+    s.buckets_[bucket(uS)].fetch_add(1, std::memory_order_relaxed);
+    atomicMax(s.max_, uS);
+}
+
+void Stats::count(Counter counter, unsigned long long n) {
+    counters_[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void Stats::highWater(Counter counter, unsigned long long v) {
+    atomicMax(counters_[counter], v);
+}
+
+void Stats::histogram(Stage stage, Histogram &h) {
+    StageStats &s = stages_[stage];
+    h.count_ = s.count_.load(std::memory_order_relaxed);
+    h.sum_ = s.sum_.load(std::memory_order_relaxed);
+    h.max_ = s.max_.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        h.buckets_[i] = s.buckets_[i].load(std::memory_order_relaxed);
+    }
+}
+
+unsigned long long Stats::counter(Counter counter) {
+    return counters_[counter].load(std::memory_order_relaxed);
+}
+
+void Stats::reset() {
+    for (unsigned i = 0; i < S_MAX; i++) {
+        StageStats &s = stages_[i];
+        s.count_.store(0, std::memory_order_relaxed);
+        s.sum_.store(0, std::memory_order_relaxed);
+        s.max_.store(0, std::memory_order_relaxed);
+        for (unsigned b = 0; b < BUCKETS; b++) {
+            s.buckets_[b].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (unsigned i = 0; i < C_MAX; i++) {
+        counters_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+bool Stats::enabled() {
+    return false;
+}
+
+void Stats::record(Stage, unsigned long long) { ; }
+
+void Stats::count(Counter, unsigned long long) { ; }
+
+void Stats::highWater(Counter, unsigned long long) { ; }
+
+void Stats::histogram(Stage, Histogram &h) {
+    h.count_ = 0;
+    h.sum_ = 0;
+    h.max_ = 0;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        h.buckets_[i] = 0;
+    }
+}
+
+unsigned long long Stats::counter(Counter) {
+    return 0;
+}
+
+void Stats::reset() { ; }
+
+#endif
+
+unsigned long long Stats::Histogram::percentile(float p) const {
+    if (count_ == 0) return 0;
+    unsigned long long target = static_cast<unsigned long long>(p * count_);
+    unsigned long long n = 0;
+    for (unsigned i = 0; i < BUCKETS - 1; i++) {
+        n += buckets_[i];
+        if (n > target) return 1ULL << i;
+    }
+    return max_;
+}
+
+const char *Stats::stageName(Stage stage) {
+    switch (stage) {
+        case S_DEVICE_DECODE:
+            return "device decode";
+        case S_QUEUE_RESIDENCY:
+            return "queue residency";
+        case S_DISPATCH:
+            return "dispatch";
+        case S_PROCESSOR:
+            return "processor";
+        default:
+            return "unknown";
+    }
+}
+
+const char *Stats::counterName(Counter counter) {
+    switch (counter) {
+        case C_QUEUE_HIGH_WATER:
+            return "queue high water";
+        case C_QUEUE_OVERFLOW:
+            return "queue overflow";
+        case C_QUEUE_HELD:
+            return "queue held";
+        case C_VOICE_STEAL:
+            return "voice steal";
+        case C_FRAME_DROPPED:
+            return "frame dropped";
+        case C_TOUCH_REAPED:
+            return "touch reaped";
+        default:
+            return "unknown";
+    }
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+//////////////
+// latency and throughput instrumentation
+// stages record elapsed time (uS) into lock-free log2 histograms, counters are simple atomics
+// all recording is via the MEC_STAT_ macros, building with DISABLE_STATS removes them entirely
+// the query api is always available (returns zeros when disabled)
+
+#include "mec_time.h"
+
+namespace mec {
+
+class Stats {
+public:
+    enum Stage {
+        S_DEVICE_DECODE,    // device event to message queued/delivered
+        S_QUEUE_RESIDENCY,  // device event to consumer (MsgQueue::process)
+        S_DISPATCH,         // MecApi callback fan out
+        S_PROCESSOR,        // Midi_Processor::process (midi output)
+        S_MAX
+    };
+
+    enum Counter {
+        C_QUEUE_HIGH_WATER, // max messages pending on any queue, once near full
+        C_QUEUE_OVERFLOW,   // messages dropped, queue full
+        C_QUEUE_HELD,       // continues held back as queue near full
+        C_VOICE_STEAL,
+        C_FRAME_DROPPED,    // t3d frames missing from the sequence
+        C_TOUCH_REAPED,     // touches ended without a release, stale
+        C_MAX
+    };
+
+    // bucket n holds times < 2^n uS, last bucket is everything above
+    static const unsigned BUCKETS = 20;
+
+    struct Histogram {
+        unsigned long long count_;
+        unsigned long long sum_;
+        unsigned long long max_;
+        unsigned long long buckets_[BUCKETS];
+
+        unsigned long long mean() const { return count_ > 0 ? sum_ / count_ : 0; }
+        // upper bound of bucket containing percentile p (0..1)
+        unsigned long long percentile(float p) const;
+    };
+
+    static bool enabled();
+
+    static void record(Stage stage, unsigned long long uS);
+    static void count(Counter counter, unsigned long long n = 1);
+    static void highWater(Counter counter, unsigned long long v);
+
+    static void histogram(Stage stage, Histogram &h);
+    static unsigned long long counter(Counter counter);
+    static void reset();
+
+    static const char *stageName(Stage stage);
+    static const char *counterName(Counter counter);
+};
+
+}
+
+#ifndef DISABLE_STATS
+#define MEC_STAT_START(var) unsigned long long var = mec::microtime()
+#define MEC_STAT_SINCE(stage, var) mec::Stats::record(stage, mec::microtime() - (var))
+#define MEC_STAT_COUNT(counter) mec::Stats::count(counter)
+#define MEC_STAT_ADD(counter, n) mec::Stats::count(counter, n)
+#define MEC_STAT_HIGH_WATER(counter, v) mec::Stats::highWater(counter, v)
+#else
+#define MEC_STAT_START(var)
+#define MEC_STAT_SINCE(stage, var)
+#define MEC_STAT_COUNT(counter)
+#define MEC_STAT_ADD(counter, n)
+#define MEC_STAT_HIGH_WATER(counter, v)
+#endif
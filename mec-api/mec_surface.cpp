@@ -1,7 +1,6 @@
 #include "mec_surface.h"
 
 
-// NOT USED YET INTERFACE EXPERIMENT ONLY
 //
 // mapping between surfaces
 //
@@ -9,9 +8,98 @@
 #include "mec_log.h"
 
 #include <algorithm>
+#include <limits>
+#include <mutex>
 
 namespace mec {
 
+////////////////////////////// surface ids ////////////////////////////////////////
+
+// only used at load time, so a simple locked table is fine
+static std::mutex internMtx_;
+static std::vector<std::string> surfaceNames_(1, std::string());
+static std::map<std::string, SurfaceID> surfaceIds_;
+
+SurfaceID internSurface(const std::string &name) {
+    if (name.size() == 0) return 0;
+    std::lock_guard<std::mutex> lock(internMtx_);
+    std::map<std::string, SurfaceID>::iterator it = surfaceIds_.find(name);
+    if (it != surfaceIds_.end()) return it->second;
+    SurfaceID id = static_cast<SurfaceID>(surfaceNames_.size());
+    surfaceNames_.push_back(name);
+    surfaceIds_[name] = id;
+    return id;
+}
+
+const std::string &surfaceName(SurfaceID id) {
+    std::lock_guard<std::mutex> lock(internMtx_);
+    if (id >= surfaceNames_.size()) return surfaceNames_[0];
+    return surfaceNames_[id];
+}
+
+static unsigned surfaceCount() {
+    std::lock_guard<std::mutex> lock(internMtx_);
+    return static_cast<unsigned>(surfaceNames_.size());
+}
+
+
+////////////////////////////// transforms ////////////////////////////////////////
+
+static const float UNBOUNDED = std::numeric_limits<float>::infinity();
+
+static void identity(SurfaceManager::Transform &t, SurfaceID surface) {
+    for (unsigned i = 0; i < SurfaceManager::A_MAX; i++) {
+        t.lo_[i] = -UNBOUNDED;
+        t.hi_[i] = UNBOUNDED;
+        t.axis_[i] = i;
+        t.scale_[i] = 1.0f;
+        t.offset_[i] = 0.0f;
+    }
+    t.surface_ = surface;
+}
+
+// out axis a becomes (axis b of t) * s + o
+static void remap(const SurfaceManager::Transform &t, unsigned a, unsigned b, float s, float o,
+                  SurfaceManager::Transform &out) {
+    out.axis_[a] = t.axis_[b];
+    out.scale_[a] = t.scale_[b] * s;
+    out.offset_[a] = t.offset_[b] * s + o;
+}
+
+// restrict t to lo <= axis a < hi, on the current coordinates, returns false if region is empty
+static bool restrict(SurfaceManager::Transform &t, unsigned a, float lo, float hi) {
+    unsigned k = t.axis_[a];
+    float s = t.scale_[a];
+    float o = t.offset_[a];
+    if (s == 0.0f) return o >= lo && o < hi;
+    float l = (lo - o) / s;
+    float h = (hi - o) / s;
+    if (s < 0.0f) std::swap(l, h);
+    t.lo_[k] = std::max(t.lo_[k], l);
+    t.hi_[k] = std::min(t.hi_[k], h);
+    return t.lo_[k] < t.hi_[k];
+}
+
+static inline float axisValue(const Touch &t, unsigned a) {
+    switch (a) {
+        case SurfaceManager::A_X : return t.x_;
+        case SurfaceManager::A_Y : return t.y_;
+        case SurfaceManager::A_Z : return t.z_;
+        case SurfaceManager::A_R : return t.r_;
+        default: return t.c_;
+    }
+}
+
+static inline void setAxisValue(Touch &t, unsigned a, float v) {
+    switch (a) {
+        case SurfaceManager::A_X : t.x_ = v; break;
+        case SurfaceManager::A_Y : t.y_ = v; break;
+        case SurfaceManager::A_Z : t.z_ = v; break;
+        case SurfaceManager::A_R : t.r_ = v; break;
+        default: t.c_ = v; break;
+    }
+}
+
 
 ////////////////////////////// SurfaceManager ////////////////////////////////////////
 
@@ -32,31 +120,163 @@ bool SurfaceManager::init(const Preferences &prefs) {
         Preferences p(prefs.getSubTree(k));
         if (p.valid()) {
             std::shared_ptr<Surface> pS;
+            SurfaceID id = internSurface(k);
             std::string type = p.getString("type", "");
             if (type.size() == 0) { // plain
-                pS.reset(new Surface(k));
+                pS.reset(new Surface(id));
             } else if (type == "join") {
-                pS.reset(new JoinedSurface(k));
+                pS.reset(new JoinedSurface(id));
             } else if (type == "split") {
-                pS.reset(new SplitSurface(k));
+                pS.reset(new SplitSurface(id));
+            } else if (type == "rotate") {
+                pS.reset(new RotatedSurface(id));
             } else {
                 pS.reset();
                 LOG_0("SurfaceManager: surface def missing type");
             }
             if (pS) {
                 if (pS->load(p)) {
-                    surfaces_[k] = pS;
+                    surfaces_[id] = pS;
                 } else {
                     pS.reset();
                 }
             }
         }
     }
+    compile();
     return true;
 }
 
 std::shared_ptr<Surface> SurfaceManager::getSurface(SurfaceID id) {
-    return surfaces_[id];
+    std::map<SurfaceID, std::shared_ptr<Surface>>::iterator it = surfaces_.find(id);
+    if (it == surfaces_.end()) return nullptr;
+    return it->second;
+}
+
+std::shared_ptr<Surface> SurfaceManager::getSurface(const std::string &name) {
+    return getSurface(internSurface(name));
+}
+
+std::shared_ptr<Surface> SurfaceManager::consumer(SurfaceID id) const {
+    for (std::map<SurfaceID, std::shared_ptr<Surface>>::const_iterator it = surfaces_.begin(); it != surfaces_.end(); ++it) {
+        if (it->second->consumes(id)) return it->second;
+    }
+    return nullptr;
+}
+
+void SurfaceManager::compile() {
+    unsigned count = surfaceCount();
+    transforms_.clear();
+    first_.assign(count, 0);
+    count_.assign(count, 0);
+    voices_.assign(count, 0);
+    ActiveTouch inactive;
+    inactive.transform_ = -1;
+    inactive.voice_ = 0;
+    active_.assign(count * MAX_TOUCH_IDS, inactive);
+
+    for (SurfaceID source = 1; source < count; source++) {
+        if (!consumer(source)) continue;
+        Transform t;
+        identity(t, source);
+        first_[source] = static_cast<unsigned>(transforms_.size());
+        compileSource(source, source, t, 0);
+        count_[source] = static_cast<unsigned>(transforms_.size()) - first_[source];
+        LOG_1("SurfaceManager: " << surfaceName(source) << " transforms " << count_[source]);
+    }
+}
+
+void SurfaceManager::compileSource(SurfaceID source, SurfaceID current, const Transform &t, unsigned depth) {
+    std::shared_ptr<Surface> c = consumer(current);
+    if (!c || depth >= MAX_DEPTH) {
+        if (depth >= MAX_DEPTH) LOG_0("SurfaceManager: surface chain too long (loop?) from " << surfaceName(source));
+        transforms_.push_back(t);
+        transforms_.back().surface_ = current;
+        return;
+    }
+    std::vector<Transform> next;
+    c->compile(current, t, next);
+    for (std::vector<Transform>::iterator it = next.begin(); it != next.end(); ++it) {
+        compileSource(source, it->surface_, *it, depth + 1);
+    }
+}
+
+unsigned SurfaceManager::transformCount(SurfaceID source) const {
+    return source < count_.size() ? count_[source] : 0;
+}
+
+bool SurfaceManager::mapped(const Touch &in) const {
+    return in.surface_ < count_.size() && count_[in.surface_] > 0;
+}
+
+SurfaceManager::ActiveTouch *SurfaceManager::active(const Touch &in) {
+    if (in.id_ < 0 || in.id_ >= static_cast<int>(MAX_TOUCH_IDS) || in.surface_ >= count_.size()) return nullptr;
+    return &active_[in.surface_ * MAX_TOUCH_IDS + in.id_];
+}
+
+void SurfaceManager::apply(const Transform &t, const Touch &in, unsigned voice, Touch &out) const {
+    float v[A_MAX] = {in.x_, in.y_, in.z_, in.r_, in.c_};
+    out.id_ = static_cast<int>(voice);
+    out.surface_ = t.surface_;
+    out.x_ = v[t.axis_[A_X]] * t.scale_[A_X] + t.offset_[A_X];
+    out.y_ = v[t.axis_[A_Y]] * t.scale_[A_Y] + t.offset_[A_Y];
+    out.z_ = v[t.axis_[A_Z]] * t.scale_[A_Z] + t.offset_[A_Z];
+    out.r_ = v[t.axis_[A_R]] * t.scale_[A_R] + t.offset_[A_R];
+    out.c_ = v[t.axis_[A_C]] * t.scale_[A_C] + t.offset_[A_C];
+}
+
+bool SurfaceManager::touchOn(const Touch &in, Touch &out) {
+    ActiveTouch *a = active(in);
+    if (!a || count_[in.surface_] == 0) return false;
+    if (a->transform_ >= 0) {
+        // missing touch off, release old voice
+        voices_[transforms_[a->transform_].surface_] &= ~(1ULL << a->voice_);
+        a->transform_ = -1;
+    }
+
+    float v[A_MAX] = {in.x_, in.y_, in.z_, in.r_, in.c_};
+    unsigned first = first_[in.surface_];
+    unsigned last = first + count_[in.surface_];
+    for (unsigned i = first; i < last; i++) {
+        const Transform &t = transforms_[i];
+        bool inside = true;
+        for (unsigned k = 0; k < A_MAX; k++) {
+            inside = inside && v[k] >= t.lo_[k] && v[k] < t.hi_[k];
+        }
+        if (!inside) continue;
+
+        // lowest free voice on output surface
+        unsigned long long used = voices_[t.surface_];
+        unsigned voice = 0;
+        while (voice < MAX_VOICES && (used & (1ULL << voice))) voice++;
+        if (voice >= MAX_VOICES) {
+            LOG_1("SurfaceManager: no free voice on " << surfaceName(t.surface_));
+            return false;
+        }
+        voices_[t.surface_] = used | (1ULL << voice);
+        a->transform_ = static_cast<int>(i);
+        a->voice_ = voice;
+        apply(t, in, voice, out);
+        return true;
+    }
+    return false;
+}
+
+bool SurfaceManager::touchContinue(const Touch &in, Touch &out) {
+    ActiveTouch *a = active(in);
+    if (!a || a->transform_ < 0) return false;
+    apply(transforms_[a->transform_], in, a->voice_, out);
+    return true;
+}
+
+bool SurfaceManager::touchOff(const Touch &in, Touch &out) {
+    ActiveTouch *a = active(in);
+    if (!a || a->transform_ < 0) return false;
+    const Transform &t = transforms_[a->transform_];
+    apply(t, in, a->voice_, out);
+    voices_[t.surface_] &= ~(1ULL << a->voice_);
+    a->transform_ = -1;
+    return true;
 }
 
 ////////////////////////////// Surface ////////////////////////////////////////
@@ -79,10 +299,37 @@ Touch Surface::map(const Touch &t) const {
     return t;
 }
 
+bool Surface::consumes(SurfaceID) const {
+    return false;
+}
+
+void Surface::compile(SurfaceID, const SurfaceManager::Transform &t, std::vector<SurfaceManager::Transform> &out) const {
+    out.push_back(t);
+}
+
 SurfaceID Surface::getId() {
     return surfaceId_;
 }
 
+SurfaceManager::Axis Surface::loadAxis(const Preferences &prefs) {
+    std::string axis = prefs.getString("axis", "");
+    if (axis == "y") return SurfaceManager::A_Y;
+    else if (axis == "z") return SurfaceManager::A_Z;
+    else if (axis == "r") return SurfaceManager::A_R;
+    else if (axis == "c") return SurfaceManager::A_C;
+    return SurfaceManager::A_X;
+}
+
+static void loadSurfaces(const Preferences &prefs, std::vector<SurfaceID> &surfaces) {
+    Preferences::Array array(prefs.getArray("surfaces"));
+    for (unsigned i = 0; i < array.getSize(); i++) {
+        std::string n = array.getString(i);
+        if (n.size() > 0) {
+            surfaces.push_back(internSurface(n));
+        }
+    }
+}
+
 
 //const float UNDEFINED_SPLIT = -1.0f;
 //const float MIN_SPLIT = 0.0f;
@@ -105,77 +352,41 @@ bool SplitSurface::load(const Preferences &prefs) {
     if (!prefs.valid()) return false;
 
     splitPoint_ = (float) prefs.getDouble("split point", 0.5);
+    loadSurfaces(prefs, surfaces_);
+    axis_ = loadAxis(prefs);
 
-    Preferences::Array array(prefs.getArray("surfaces"));
-    for (unsigned i = 0; i < array.getSize(); i++) {
-        SurfaceID n = array.getString(i);
-        if (n.size() > 0) {
-            surfaces_.push_back(n);
-        }
-    }
-
-    std::string axis = prefs.getString("axis", "");
-    if (axis.size() > 0) {
-        if (axis == "x") axis_ = C_X;
-        else if (axis == "y") axis_ = C_Y;
-        else if (axis == "z") axis_ = C_Z;
-        else if (axis == "r") axis_ = C_R;
-        else if (axis == "c") axis_ = C_C;
-        else axis_ = C_X;
-    } else {
-        axis_ = C_X;
-    }
-
-
-    return surfaces_.size() > 0;
+    return surfaces_.size() > 0 && splitPoint_ > 0.0f;
 }
 
 Touch SplitSurface::map(const Touch &t) const {
     // TODO
     // relationship between X-C , Y - R
-    // touch id, needs to be voiced on surface
     Touch out = t;
-    unsigned n = 0;
-
-    switch (axis_) {
-        case C_X: {
-            n = static_cast<unsigned>(t.x_ / splitPoint_);
-            n = std::min<unsigned>(n, surfaces_.size() - 1);
-            out.x_ = t.x_ - (splitPoint_ * n);
-            break;
-        }
-        case C_Y: {
-            n = static_cast<unsigned>(static_cast<int>(t.y_ / splitPoint_));
-            n = std::min<unsigned>(n, surfaces_.size() - 1);
-            out.y_ = t.y_ - (splitPoint_ * n);
-            break;
-        }
-        case C_Z: {
-            n = static_cast<unsigned>(t.z_ / splitPoint_);
-            n = std::min<unsigned>(n, surfaces_.size() - 1);
-            out.z_ = t.z_ - (splitPoint_ * n);
-            break;
-        }
-        case C_R: {
-            n = static_cast<unsigned>(t.r_ / splitPoint_);
-            n = std::min<unsigned>(n, surfaces_.size() - 1);
-            out.r_ = t.r_ - (splitPoint_ * n);
-            break;
-        }
-        case C_C: {
-            n = static_cast<unsigned>(t.c_ / splitPoint_);
-            n = std::min<unsigned>(n, surfaces_.size() - 1);
-            out.c_ = t.c_ - (splitPoint_ * n);
-            break;
-        }
-        default:
-            LOG_0("SplitSurface : invalid axis");
-            break;
-    }
+    float v = axisValue(t, axis_);
+    unsigned n = v > 0.0f ? static_cast<unsigned>(v / splitPoint_) : 0;
+    n = std::min<unsigned>(n, static_cast<unsigned>(surfaces_.size() - 1));
+    setAxisValue(out, axis_, v - (splitPoint_ * n));
     out.surface_ = surfaces_[n];
     return out;
 }
 
+bool SplitSurface::consumes(SurfaceID id) const {
+    return id == surfaceId_;
+}
+
+void SplitSurface::compile(SurfaceID, const SurfaceManager::Transform &t, std::vector<SurfaceManager::Transform> &out) const {
+    unsigned last = static_cast<unsigned>(surfaces_.size() - 1);
+    for (unsigned n = 0; n <= last; n++) {
+        SurfaceManager::Transform s = t;
+        float lo = n == 0 ? -UNBOUNDED : splitPoint_ * n;
+        float hi = n == last ? UNBOUNDED : splitPoint_ * (n + 1);
+        if (!restrict(s, axis_, lo, hi)) continue;
+        remap(t, axis_, axis_, 1.0f, -(splitPoint_ * n), s);
+        s.surface_ = surfaces_[n];
+        out.push_back(s);
+    }
+}
+
 
 ////////////////////////////// JoinedSurface ////////////////////////////////////////
 
@@ -194,27 +405,8 @@ bool JoinedSurface::load(const Preferences &prefs) {
 
     // temp, this will come from the source surface
     surfaceSize_ = (float) prefs.getDouble("surface size", 1.0);
-
-    Preferences::Array array(prefs.getArray("surfaces"));
-    for (unsigned i = 0; i < array.getSize(); i++) {
-        SurfaceID n = array.getString(i);
-        if (n.size() > 0) {
-            surfaces_.push_back(n);
-        }
-    }
-
-    std::string axis = prefs.getString("axis", "");
-    if (axis.size() > 0) {
-        if (axis == "x") axis_ = C_X;
-        else if (axis == "y") axis_ = C_Y;
-        else if (axis == "z") axis_ = C_Z;
-        else if (axis == "r") axis_ = C_R;
-        else if (axis == "c") axis_ = C_C;
-        else axis_ = C_X;
-    } else {
-        axis_ = C_X;
-    }
-
+    loadSurfaces(prefs, surfaces_);
+    axis_ = loadAxis(prefs);
 
     return surfaces_.size() > 0;
 }
@@ -223,44 +415,118 @@ Touch JoinedSurface::map(const Touch &t) const {
     // TODO
     // use source surface for dimension,
     // relationship between X-C , Y - R
-    // touch id, needs to be voiced on surface
     Touch out = t;
-    int idx = 0;
-    for (SurfaceID n : surfaces_) {
-        if (t.surface_ == n) {
-            switch (axis_) {
-                case C_X: {
-                    out.x_ = t.x_ + (surfaceSize_ * idx);
-                    break;
-                }
-                case C_Y: {
-                    out.y_ = t.y_ + (surfaceSize_ * idx);
-                    break;
-                }
-                case C_Z: {
-                    out.z_ = t.z_ + (surfaceSize_ * idx);
-                    break;
-                }
-                case C_R: {
-                    out.r_ = t.r_ + (surfaceSize_ * idx);
-                    break;
-                }
-                case C_C: {
-                    out.c_ = t.c_ + (surfaceSize_ * idx);
-                    break;
-                }
-                default:
-                    LOG_0("JoinedSurface : invalid axis");
-                    break;
-            }
-
+    for (unsigned idx = 0; idx < surfaces_.size(); idx++) {
+        if (t.surface_ == surfaces_[idx]) {
+            setAxisValue(out, axis_, axisValue(t, axis_) + (surfaceSize_ * idx));
             out.surface_ = surfaceId_;
             return out;
         }
-        idx++;
     }
     return out;
 }
 
+bool JoinedSurface::consumes(SurfaceID id) const {
+    return std::find(surfaces_.begin(), surfaces_.end(), id) != surfaces_.end();
+}
+
+void JoinedSurface::compile(SurfaceID from, const SurfaceManager::Transform &t, std::vector<SurfaceManager::Transform> &out) const {
+    unsigned idx = static_cast<unsigned>(std::find(surfaces_.begin(), surfaces_.end(), from) - surfaces_.begin());
+    SurfaceManager::Transform j = t;
+    remap(t, axis_, axis_, 1.0f, surfaceSize_ * idx, j);
+    j.surface_ = surfaceId_;
+    out.push_back(j);
+}
+
+
+////////////////////////////// RotatedSurface ////////////////////////////////////////
+
+
+RotatedSurface::RotatedSurface(SurfaceID surfaceId) :
+        Surface(surfaceId) {
+    ;
+}
+
+RotatedSurface::~RotatedSurface() {
+    ;
+}
+
+bool RotatedSurface::load(const Preferences &prefs) {
+    if (!prefs.valid()) return false;
+
+    source_ = internSurface(prefs.getString("surface", ""));
+    angle_ = static_cast<unsigned>(prefs.getInt("angle", 90));
+    surfaceSize_ = (float) prefs.getDouble("surface size", 1.0);
+    rows_ = (float) prefs.getDouble("rows", 1.0);
+    columns_ = (float) prefs.getDouble("columns", 1.0);
+
+    if (angle_ != 90 && angle_ != 180 && angle_ != 270) {
+        LOG_0("RotatedSurface: angle must be 90, 180 or 270");
+        return false;
+    }
+    return source_ != 0;
+}
+
+Touch RotatedSurface::map(const Touch &t) const {
+    // x runs along columns, y along rows
+    Touch out = t;
+    switch (angle_) {
+        case 90:
+            out.x_ = t.y_;
+            out.y_ = surfaceSize_ - t.x_;
+            out.c_ = t.r_;
+            out.r_ = columns_ - t.c_;
+            break;
+        case 180:
+            out.x_ = surfaceSize_ - t.x_;
+            out.y_ = surfaceSize_ - t.y_;
+            out.c_ = columns_ - t.c_;
+            out.r_ = rows_ - t.r_;
+            break;
+        case 270:
+            out.x_ = surfaceSize_ - t.y_;
+            out.y_ = t.x_;
+            out.c_ = rows_ - t.r_;
+            out.r_ = t.c_;
+            break;
+        default:
+            break;
+    }
+    out.surface_ = surfaceId_;
+    return out;
+}
+
+bool RotatedSurface::consumes(SurfaceID id) const {
+    return id == source_;
+}
+
+void RotatedSurface::compile(SurfaceID, const SurfaceManager::Transform &t, std::vector<SurfaceManager::Transform> &out) const {
+    SurfaceManager::Transform r = t;
+    switch (angle_) {
+        case 90:
+            remap(t, SurfaceManager::A_X, SurfaceManager::A_Y, 1.0f, 0.0f, r);
+            remap(t, SurfaceManager::A_Y, SurfaceManager::A_X, -1.0f, surfaceSize_, r);
+            remap(t, SurfaceManager::A_C, SurfaceManager::A_R, 1.0f, 0.0f, r);
+            remap(t, SurfaceManager::A_R, SurfaceManager::A_C, -1.0f, columns_, r);
+            break;
+        case 180:
+            remap(t, SurfaceManager::A_X, SurfaceManager::A_X, -1.0f, surfaceSize_, r);
+            remap(t, SurfaceManager::A_Y, SurfaceManager::A_Y, -1.0f, surfaceSize_, r);
+            remap(t, SurfaceManager::A_C, SurfaceManager::A_C, -1.0f, columns_, r);
+            remap(t, SurfaceManager::A_R, SurfaceManager::A_R, -1.0f, rows_, r);
+            break;
+        case 270:
+            remap(t, SurfaceManager::A_X, SurfaceManager::A_Y, -1.0f, surfaceSize_, r);
+            remap(t, SurfaceManager::A_Y, SurfaceManager::A_X, 1.0f, 0.0f, r);
+            remap(t, SurfaceManager::A_C, SurfaceManager::A_R, -1.0f, rows_, r);
+            remap(t, SurfaceManager::A_R, SurfaceManager::A_C, 1.0f, 0.0f, r);
+            break;
+        default:
+            break;
+    }
+    r.surface_ = surfaceId_;
+    out.push_back(r);
+}
+
 } // namespace
 
@@ -5,29 +5,95 @@
 #include "mec_prefs.h"
 
 
-// NOT USED YET INTERFACE EXPERIMENT ONLY
 //
 // mapping between surfaces
 //
+// surfaces (split/join/rotate) are loaded from prefs as a graph, which is then compiled into a flat table
+// of transforms per source surface. a transform is a region (on the source coordinates) and a per axis
+// scale/offset, so mapping a touch is a few compares and multiply-adds, with no allocation.
+// touches are voiced on their output surface, so touch ids are contiguous (lowest free) per surface.
+//
 
 
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace mec {
 
+// surface names are interned at load time, ids are small, dense and stable for the life of the process
+// id 0 is reserved for no/unknown surface
+SurfaceID internSurface(const std::string &name);
+const std::string &surfaceName(SurfaceID id);
+
 
 class Surface;
 
 class SurfaceManager {
 public:
+    static const unsigned MAX_TOUCH_IDS = 64; // per source surface
+    static const unsigned MAX_VOICES = 64;    // per output surface
+    static const unsigned MAX_DEPTH = 16;     // longest chain of surfaces
+
+    enum Axis {
+        A_X,
+        A_Y,
+        A_Z,
+        A_R,
+        A_C,
+        A_MAX
+    };
+
+    // region lo <= v < hi on the source coordinates, out[i] = in[axis_[i]] * scale_[i] + offset_[i]
+    struct Transform {
+        float lo_[A_MAX];
+        float hi_[A_MAX];
+        unsigned axis_[A_MAX];
+        float scale_[A_MAX];
+        float offset_[A_MAX];
+        SurfaceID surface_;
+    };
+
     SurfaceManager();
     virtual ~SurfaceManager();
+    // loads and compiles surfaces
     bool init(const Preferences &prefs);
 
     std::shared_ptr<Surface> getSurface(SurfaceID id);
+    std::shared_ptr<Surface> getSurface(const std::string &name);
+
+    // true if touches on this surface are mapped, otherwise they should be passed on unchanged
+    bool mapped(const Touch &in) const;
+
+    // compiled mapping, touch keeps its output surface (and voice) from touchOn to touchOff
+    // returns false if the touch should be dropped (touch id out of range, or no free voice)
+    bool touchOn(const Touch &in, Touch &out);
+    bool touchContinue(const Touch &in, Touch &out);
+    bool touchOff(const Touch &in, Touch &out);
+
+    unsigned transformCount(SurfaceID source) const;
+
 private:
+    struct ActiveTouch {
+        int transform_; // -1 inactive
+        unsigned voice_;
+    };
+
+    void compile();
+    void compileSource(SurfaceID source, SurfaceID current, const Transform &t, unsigned depth);
+    std::shared_ptr<Surface> consumer(SurfaceID id) const;
+    ActiveTouch *active(const Touch &in);
+    void apply(const Transform &t, const Touch &in, unsigned voice, Touch &out) const;
+
     std::map<SurfaceID, std::shared_ptr<Surface>> surfaces_;
+
+    // compiled, indexed by surface id
+    std::vector<Transform> transforms_;
+    std::vector<unsigned> first_;
+    std::vector<unsigned> count_;
+    std::vector<ActiveTouch> active_; // [source id * MAX_TOUCH_IDS + touch id]
+    std::vector<unsigned long long> voices_; // used voice bits, by output surface id
 };
 
 
@@ -38,9 +104,17 @@ public:
 
     SurfaceID getId();
     virtual bool load(const Preferences &prefs);
+    // single step mapping, only used for testing, the api uses the compiled transforms
     virtual Touch map(const Touch &) const;
+    // true if touches on this surface id are mapped by this surface
+    virtual bool consumes(SurfaceID id) const;
+    // append transforms for a touch on 'from', t is the transform from the source so far
+    virtual void compile(SurfaceID from, const SurfaceManager::Transform &t,
+                         std::vector<SurfaceManager::Transform> &out) const;
 
 protected:
+    static SurfaceManager::Axis loadAxis(const Preferences &prefs);
+
     SurfaceID surfaceId_;
 };
 
@@ -52,15 +126,12 @@ public:
 
     virtual bool load(const Preferences &prefs) override;
     virtual Touch map(const Touch &) const override;
+    virtual bool consumes(SurfaceID id) const override;
+    virtual void compile(SurfaceID from, const SurfaceManager::Transform &t,
+                         std::vector<SurfaceManager::Transform> &out) const override;
 
 private:
-    enum {
-        C_X,
-        C_Y,
-        C_Z,
-        C_R,
-        C_C
-    } axis_;
+    SurfaceManager::Axis axis_;
     std::vector<SurfaceID> surfaces_;
     float splitPoint_;
 };
@@ -75,19 +146,37 @@ public:
 
     virtual bool load(const Preferences &prefs) override;
     virtual Touch map(const Touch &) const override;
+    virtual bool consumes(SurfaceID id) const override;
+    virtual void compile(SurfaceID from, const SurfaceManager::Transform &t,
+                         std::vector<SurfaceManager::Transform> &out) const override;
 
 private:
-    enum {
-        C_X,
-        C_Y,
-        C_Z,
-        C_R,
-        C_C
-    } axis_;
+    SurfaceManager::Axis axis_;
     std::vector<SurfaceID> surfaces_;
     float surfaceSize_;
 };
 
+
+// rotate x/y (and r/c) by 90/180/270 degrees, within a surface of given size
+class RotatedSurface : public Surface {
+public:
+    RotatedSurface(SurfaceID surfaceId);
+    virtual ~RotatedSurface();
+
+    virtual bool load(const Preferences &prefs) override;
+    virtual Touch map(const Touch &) const override;
+    virtual bool consumes(SurfaceID id) const override;
+    virtual void compile(SurfaceID from, const SurfaceManager::Transform &t,
+                         std::vector<SurfaceManager::Transform> &out) const override;
+
+private:
+    SurfaceID source_;
+    unsigned angle_;
+    float surfaceSize_;
+    float rows_;
+    float columns_;
+};
+
 }
 
-#endif //MEC_SURFACE_H
\ No newline at end of file
+#endif //MEC_SURFACE_H
@@ -2,15 +2,25 @@
 
 #include "mec_log.h"
 
+#include <algorithm>
+
 namespace mec {
 
-SurfaceMapper::SurfaceMapper() : mode_(SM_NoMapping) {
+SurfaceMapper::SurfaceMapper() : geometry_(nullptr) {
+}
+
+void SurfaceMapper::setGeometry(const KeyGeometry *geometry) {
+    geometry_ = geometry;
+}
+
+unsigned SurfaceMapper::keyCount() const {
+    return geometry_ ? geometry_->keys() : MAX_KEYS;
 }
 
 void SurfaceMapper::load(Preferences &prefs) {
     LOG_2("load surface mapping");
 
-    mode_ = SM_NoMapping;
+    notes_.clear();
     if (prefs.exists("notes")) {
         loadNoteArray(prefs);
         return;
@@ -21,26 +31,15 @@ void SurfaceMapper::load(Preferences &prefs) {
     }
 }
 
-int SurfaceMapper::noteFromKey(int key) {
-    switch (mode_) {
-        case SM_NoMapping:
-            return key;
-        case SM_Notes:
-            return notes_[key % MAX_KEYS];
-        case SM_Calculated:
-            return ((key / keyInCol_) * colMult_) + ((key % keyInCol_) * rowMult_) + noteOffset_;
-    }
-    return key;
-}
-
 void SurfaceMapper::loadNoteArray(Preferences &prefs) {
-    mode_ = SM_Notes;
     Preferences::Array array(prefs.getArray("notes"));
-    int sz = array.getSize();
+    unsigned sz = array.getSize();
+    unsigned count = std::max(sz, keyCount());
+    notes_.resize(count);
     for (unsigned i = 0; i < sz; i++) {
         notes_[i] = array.getInt(i);
     }
-    for (int i = sz; i < MAX_KEYS; i++) {
+    for (unsigned i = sz; i < count; i++) {
         notes_[i] = i;
     }
 
@@ -49,15 +48,32 @@ void SurfaceMapper::loadNoteArray(Preferences &prefs) {
 
 void SurfaceMapper::loadCalcDefinition(Preferences &p) {
     Preferences prefs(p.getSubTree("calculated"));
-    mode_ = SM_Calculated;
-    keyInCol_ = prefs.getInt("keys in col", 127);
-    rowMult_ = prefs.getInt("row multiplier", 1);
-    colMult_ = prefs.getInt("col multipler", keyInCol_);
-    noteOffset_ = prefs.getInt("note offset", 0);
+    int rowMult = prefs.getInt("row multiplier", 1);
+    int noteOffset = prefs.getInt("note offset", 0);
+    unsigned count = keyCount();
+    notes_.resize(count);
+
+    if (geometry_ && !prefs.exists("keys in col")) {
+        // uneven strings (e.g. tau) need the geometry
+        int colMult = prefs.getInt("col multipler", geometry_->columns_);
+        for (unsigned k = 0; k < count; k++) {
+            const KeyPosition *pos = geometry_->position(0, k);
+            notes_[k] = (pos->row_ * colMult) + (pos->column_ * rowMult) + noteOffset;
+        }
+        LOG_2("loaded surface mapping (calc) " << geometry_->name_ << " , " << rowMult << " , " << colMult << " , "
+                                               << noteOffset);
+        return;
+    }
 
-    LOG_2("loaded surface mapping (calc) " << keyInCol_ << " , " << rowMult_ << " , " << colMult_ << " , "
-                                           << noteOffset_);
+    // r = k % keyInCol , c = k / keyInCol, note = (r * rowM) + (c * colM) + offset
+    int keyInCol = prefs.getInt("keys in col", 127);
+    int colMult = prefs.getInt("col multipler", keyInCol);
+    for (int k = 0; k < static_cast<int>(count); k++) {
+        notes_[k] = ((k / keyInCol) * colMult) + ((k % keyInCol) * rowMult) + noteOffset;
+    }
 
+    LOG_2("loaded surface mapping (calc) " << keyInCol << " , " << rowMult << " , " << colMult << " , "
+                                           << noteOffset);
 }
 
-}
\ No newline at end of file
+}
@@ -2,7 +2,9 @@
 #define MEC_SURFACE_MAPPER_H
 
 #include "mec_prefs.h"
+#include "mec_keygeometry.h"
 
+#include <vector>
 
 
 // SURFACE MAPPING
@@ -17,6 +19,11 @@ This class takes a devices 'key' and converts it into a midi note
 a couple of configurations are supported so far in a preferences file
 
 an array of note values, one for each key -  "notes" : [1,2,3]
+calculated from the key position "calculated" : { "row multiplier", "col multipler", "note offset" }
+    note = (position along string * row multiplier) + (string * col multipler) + offset
+    position/string come from the device key geometry (if set), else from "keys in col"
+
+notes are calculated on load, so noteFromKey() is a single lookup
 */
 
 namespace mec {
@@ -24,28 +31,23 @@ namespace mec {
 class SurfaceMapper {
 public:
     SurfaceMapper();
-    int noteFromKey(int key);
+    // key layout of the device, call before load, null if unknown
+    void setGeometry(const KeyGeometry *geometry);
+    const KeyGeometry *getGeometry() const { return geometry_; }
+
+    int noteFromKey(int key) const {
+        return (key >= 0 && key < static_cast<int>(notes_.size())) ? notes_[key] : key;
+    }
+
     void load(Preferences &prefs);
 private:
     void loadNoteArray(Preferences &prefs);
     void loadCalcDefinition(Preferences &prefs);
+    unsigned keyCount() const;
 
-    enum mode {
-        SM_NoMapping,
-        SM_Notes,
-        SM_Calculated
-    } mode_;
-
-    //note mode
-    int notes_[MAX_KEYS];
-
-    //calc mode
-    // r = k % keyInCol , c = k / keyInCol, note = (r * rowM) + (c * colM) + offset
-    int keyInCol_;
-    int rowMult_;
-    int colMult_;
-    int noteOffset_;
+    const KeyGeometry *geometry_;
+    std::vector<int> notes_; // empty = no mapping
 };
 }
 
-#endif //MEC_SURFACE_MAPPER_H
\ No newline at end of file
+#endif //MEC_SURFACE_MAPPER_H
@@ -0,0 +1,220 @@
+#include "mec_tuning.h"
+
+#include "mec_log.h"
+
+#include <math.h>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace mec {
+
+// next line which is not a comment, false at end of file
+static bool nextLine(std::istream &in, std::string &line) {
+    while (std::getline(in, line)) {
+        if (line.size() > 0 && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (line.size() > 0 && line[0] == '!') continue;
+        return true;
+    }
+    return false;
+}
+
+// first whitespace delimited token
+static std::string token(const std::string &line) {
+    std::istringstream s(line);
+    std::string t;
+    s >> t;
+    return t;
+}
+
+// cents if it contains a '.', otherwise a ratio n/d or n
+static bool parsePitch(const std::string &t, double &cents) {
+    if (t.size() == 0) return false;
+    char *end = nullptr;
+    if (t.find('.') != std::string::npos) {
+        cents = strtod(t.c_str(), &end);
+        return end != t.c_str();
+    }
+    long n = strtol(t.c_str(), &end, 10);
+    if (end == t.c_str() || n <= 0) return false;
+    long d = 1;
+    if (*end == '/') {
+        const char *ds = end + 1;
+        d = strtol(ds, &end, 10);
+        if (end == ds || d <= 0) return false;
+    }
+    cents = 1200.0 * log2((double) n / (double) d);
+    return true;
+}
+
+
+Tuning::Tuning() :
+        mapFirst_(0), mapLast_(KEYS - 1),
+        middle_(60), reference_(69), refFreq_(440.0),
+        octaveDegree_(12) {
+    description_ = "12 tone equal temperament";
+    for (int i = 1; i <= 12; i++) {
+        cents_.push_back(i * 100.0);
+    }
+    build();
+}
+
+Tuning::~Tuning() {
+    ;
+}
+
+bool Tuning::loadScl(const std::string &file) {
+    std::ifstream in(file.c_str());
+    if (!in.is_open()) {
+        LOG_0("Tuning: unable to open scale " << file);
+        return false;
+    }
+    return parseScl(in);
+}
+
+bool Tuning::loadKbm(const std::string &file) {
+    std::ifstream in(file.c_str());
+    if (!in.is_open()) {
+        LOG_0("Tuning: unable to open keyboard map " << file);
+        return false;
+    }
+    return parseKbm(in);
+}
+
+bool Tuning::parseScl(std::istream &in) {
+    std::string line;
+    if (!nextLine(in, line)) return false;
+    std::string description = line;
+    if (!nextLine(in, line)) return false;
+    int count = atoi(token(line).c_str());
+    if (count <= 0) {
+        LOG_0("Tuning: invalid scale size " << count);
+        return false;
+    }
+
+    std::vector<double> cents;
+    while (static_cast<int>(cents.size()) < count && nextLine(in, line)) {
+        double c;
+        if (!parsePitch(token(line), c)) {
+            LOG_0("Tuning: invalid pitch " << line);
+            return false;
+        }
+        cents.push_back(c);
+    }
+    if (static_cast<int>(cents.size()) != count || cents.back() <= 0.0) {
+        LOG_0("Tuning: incomplete scale " << description);
+        return false;
+    }
+
+    description_ = description;
+    cents_ = cents;
+    // a scale without keyboard map, maps every key to a degree
+    map_.clear();
+    octaveDegree_ = count;
+    build();
+    return true;
+}
+
+bool Tuning::parseKbm(std::istream &in) {
+    std::string line;
+    int values[7];
+    double refFreq = 0.0;
+    for (int i = 0; i < 7; i++) {
+        if (!nextLine(in, line)) {
+            LOG_0("Tuning: incomplete keyboard map");
+            return false;
+        }
+        if (i == 5) {
+            refFreq = strtod(token(line).c_str(), nullptr);
+            values[i] = 0;
+        } else {
+            values[i] = atoi(token(line).c_str());
+        }
+    }
+    int size = values[0];
+    if (size < 0 || refFreq <= 0.0) {
+        LOG_0("Tuning: invalid keyboard map");
+        return false;
+    }
+
+    std::vector<int> map;
+    while (static_cast<int>(map.size()) < size && nextLine(in, line)) {
+        std::string t = token(line);
+        if (t.size() == 0) continue;
+        map.push_back(t == "x" ? -1 : atoi(t.c_str()));
+    }
+    // missing entries are unmapped
+    while (static_cast<int>(map.size()) < size) map.push_back(-1);
+
+    mapFirst_ = values[1];
+    mapLast_ = values[2];
+    middle_ = values[3];
+    reference_ = values[4];
+    refFreq_ = refFreq;
+    octaveDegree_ = values[6];
+    map_ = map;
+    build();
+    return true;
+}
+
+double Tuning::degreeCents(int degree) const {
+    int n = static_cast<int>(cents_.size());
+    int octave = degree / n;
+    int d = degree % n;
+    if (d < 0) {
+        d += n;
+        octave--;
+    }
+    return (octave * cents_[n - 1]) + (d > 0 ? cents_[d - 1] : 0.0);
+}
+
+void Tuning::build() {
+    // degree per key, -1 not mapped
+    int degrees[KEYS];
+    bool mapped[KEYS];
+    int size = static_cast<int>(map_.size());
+    int octaveDegree = octaveDegree_ > 0 ? octaveDegree_ : static_cast<int>(cents_.size());
+    for (int k = 0; k < static_cast<int>(KEYS); k++) {
+        int offset = k - middle_;
+        mapped[k] = k >= mapFirst_ && k <= mapLast_;
+        if (size == 0) {
+            degrees[k] = offset;
+        } else {
+            int octave = offset / size;
+            int i = offset % size;
+            if (i < 0) {
+                i += size;
+                octave--;
+            }
+            mapped[k] = mapped[k] && map_[i] >= 0;
+            degrees[k] = mapped[k] ? map_[i] + octave * octaveDegree : 0;
+        }
+    }
+
+    // reference key, may itself be unmapped, so calculated directly
+    int refOffset = reference_ - middle_;
+    double refCents = 0.0;
+    if (size == 0) {
+        refCents = degreeCents(refOffset);
+    } else {
+        int octave = refOffset / size;
+        int i = refOffset % size;
+        if (i < 0) {
+            i += size;
+            octave--;
+        }
+        refCents = degreeCents((map_[i] >= 0 ? map_[i] : 0) + octave * octaveDegree);
+    }
+    double refNote = 69.0 + 12.0 * log2(refFreq_ / 440.0);
+
+    for (unsigned k = 0; k < KEYS; k++) {
+        if (mapped[k]) {
+            pitch_[k] = static_cast<float>(refNote + (degreeCents(degrees[k]) - refCents) / 100.0);
+        } else {
+            // unmapped keys hold the last mapped pitch, so slides stay continuous
+            pitch_[k] = k > 0 ? pitch_[k - 1] : static_cast<float>(k);
+        }
+    }
+}
+
+}
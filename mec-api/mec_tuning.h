@@ -0,0 +1,69 @@
+#ifndef MEC_TUNING_H
+#define MEC_TUNING_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+//
+// microtonal tuning, from Scala files
+// .scl gives the scale (cents or ratios per degree, last entry is the period, usually 2/1)
+// .kbm gives the keyboard mapping (keys to degrees, reference key/frequency), optional
+// see http://www.huygens-fokker.org/scala/scl_format.html
+//
+// files are parsed once, and a table of pitch per midi key is built,
+// so pitch() is a lookup and lerp, and tuning costs nothing extra when playing.
+// pitches are in (fractional) midi note numbers, 69.0 = 440Hz
+//
+
+namespace mec {
+
+class Tuning {
+public:
+    static const unsigned KEYS = 128;
+
+    Tuning(); // 12 tone equal temperament
+    virtual ~Tuning();
+
+    bool loadScl(const std::string &file);
+    bool loadKbm(const std::string &file);
+    bool parseScl(std::istream &in);
+    bool parseKbm(std::istream &in);
+
+    // key may be fractional, keys outside 0..127 keep the offset of the nearest end
+    inline float pitch(float key) const {
+        if (key < 0.0f) return key + (pitch_[0]);
+        if (key >= KEYS - 1) return key - (KEYS - 1) + pitch_[KEYS - 1];
+        unsigned i = static_cast<unsigned>(key);
+        float p0 = pitch_[i];
+        return p0 + (pitch_[i + 1] - p0) * (key - i);
+    }
+
+    float keyPitch(unsigned key) const { return pitch_[key < KEYS ? key : KEYS - 1]; }
+
+    const std::string &description() const { return description_; }
+
+    unsigned size() const { return static_cast<unsigned>(cents_.size()); }
+
+private:
+    void build();
+    double degreeCents(int degree) const;
+
+    std::string description_;
+    std::vector<double> cents_; // degree 1..n, last is the period
+
+    // keyboard mapping
+    int mapFirst_;
+    int mapLast_;
+    int middle_;       // key for degree 0
+    int reference_;    // key with reference frequency
+    double refFreq_;
+    int octaveDegree_; // degree of the formal octave, for map size > 0
+    std::vector<int> map_; // degree per key in map, -1 = unmapped
+
+    float pitch_[KEYS];
+};
+
+}
+
+#endif //MEC_TUNING_H
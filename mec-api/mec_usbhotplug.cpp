@@ -0,0 +1,140 @@
+#include "mec_usbhotplug.h"
+
+#include <libusb.h>
+
+#include "mec_log.h"
+#include "mec_time.h"
+
+namespace mec {
+
+static int LIBUSB_CALL usbhotplug_callback(libusb_context *, libusb_device *, libusb_hotplug_event, void *user_data) {
+    static_cast<UsbHotplug *>(user_data)->changed();
+    return 0; // keep callback registered
+}
+
+static void usbhotplug_thread_func(UsbHotplug *pThis) {
+    pThis->run();
+}
+
+UsbHotplug::UsbHotplug(unsigned settleTime)
+        : context_(nullptr),
+          listener_(nullptr),
+          settleTime_(static_cast<unsigned long long>(settleTime) * 1000),
+          running_(false),
+          changedAt_(0),
+          callbackHandle_(0) {
+}
+
+UsbHotplug::~UsbHotplug() {
+    stop();
+}
+
+bool UsbHotplug::start(UsbHotplugListener *listener) {
+    if (running_) return true;
+
+    if (libusb_init(&context_) != LIBUSB_SUCCESS) {
+        LOG_0("UsbHotplug : unable to initialise libusb");
+        context_ = nullptr;
+        return false;
+    }
+    if (!libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        LOG_0("UsbHotplug : libusb hotplug not supported on this platform");
+        libusb_exit(context_);
+        context_ = nullptr;
+        return false;
+    }
+
+    libusb_hotplug_callback_handle handle;
+    int rc = libusb_hotplug_register_callback(context_,
+                                              static_cast<libusb_hotplug_event>(
+                                                      LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+                                                      LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                                              static_cast<libusb_hotplug_flag>(0),
+                                              LIBUSB_HOTPLUG_MATCH_ANY,
+                                              LIBUSB_HOTPLUG_MATCH_ANY,
+                                              LIBUSB_HOTPLUG_MATCH_ANY,
+                                              usbhotplug_callback, this, &handle);
+    if (rc != LIBUSB_SUCCESS) {
+        LOG_0("UsbHotplug : unable to register hotplug callback " << rc);
+        libusb_exit(context_);
+        context_ = nullptr;
+        return false;
+    }
+    callbackHandle_ = handle;
+
+    listener_ = listener;
+    running_ = true;
+    thread_ = std::thread(usbhotplug_thread_func, this);
+    LOG_1("UsbHotplug : started");
+    return true;
+}
+
+void UsbHotplug::stop() {
+    if (!running_) return;
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    libusb_hotplug_deregister_callback(context_, callbackHandle_);
+    libusb_exit(context_);
+    context_ = nullptr;
+    listener_ = nullptr;
+    LOG_1("UsbHotplug : stopped");
+}
+
+void UsbHotplug::changed() {
+    changedAt_ = microtime();
+}
+
+std::string UsbHotplug::portPath(libusb_device *device) {
+    uint8_t ports[8];
+    int n = libusb_get_port_numbers(device, ports, sizeof(ports));
+    std::string path = std::to_string(libusb_get_bus_number(device));
+    for (int i = 0; i < n; i++) {
+        path += (i == 0 ? "-" : ".") + std::to_string(ports[i]);
+    }
+    return path;
+}
+
+// serial number needs the device opened, so only checked if asked for
+static bool serialMatches(libusb_device *device, const libusb_device_descriptor &desc, const std::string &serial) {
+    libusb_device_handle *handle = nullptr;
+    if (libusb_open(device, &handle) != LIBUSB_SUCCESS) return false;
+    unsigned char buf[64];
+    int len = libusb_get_string_descriptor_ascii(handle, desc.iSerialNumber, buf, sizeof(buf) - 1);
+    libusb_close(handle);
+    return len >= 0 && serial == std::string(reinterpret_cast<char *>(buf), static_cast<size_t>(len));
+}
+
+bool UsbHotplug::isAttached(unsigned vendor, unsigned product, const std::string &serial, const std::string &port) {
+    libusb_device **list = nullptr;
+    ssize_t n = libusb_get_device_list(context_, &list);
+    bool found = false;
+    for (ssize_t i = 0; i < n && !found; i++) {
+        libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) == LIBUSB_SUCCESS) {
+            found = desc.idVendor == vendor && (product == 0 || desc.idProduct == product)
+                    && (port.empty() || portPath(list[i]) == port)
+                    && (serial.empty() || serialMatches(list[i], desc, serial));
+        }
+    }
+    if (list) libusb_free_device_list(list, 1);
+    return found;
+}
+
+void UsbHotplug::run() {
+    while (running_) {
+        timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        libusb_handle_events_timeout_completed(context_, &tv, nullptr);
+
+        unsigned long long changedAt = changedAt_;
+        if (changedAt != 0 && microtime() - changedAt >= settleTime_) {
+            // only clear if no new events arrived meanwhile
+            changedAt_.compare_exchange_strong(changedAt, 0);
+            listener_->usbChanged();
+        }
+        listener_->usbIdle();
+    }
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef MEC_USBHOTPLUG_H
+#define MEC_USBHOTPLUG_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+struct libusb_context;
+struct libusb_device;
+
+namespace mec {
+
+class UsbHotplugListener {
+public:
+    virtual ~UsbHotplugListener() { ; }
+    // usb devices have been attached or detached, called once changes have settled
+    virtual void usbChanged() = 0;
+    // called periodically
+    virtual void usbIdle() { ; }
+};
+
+// watches for usb devices being attached/detached, using libusb hotplug
+// listener is called on the watcher thread, so may block (e.g. enumeration, firmware upload)
+// devices re-enumerate during firmware upload, so changes are only reported after settleTime with no events
+class UsbHotplug {
+public:
+    UsbHotplug(unsigned settleTime = 500); // mS
+    ~UsbHotplug();
+
+    bool start(UsbHotplugListener *listener);
+    void stop();
+
+    // is a matching device attached, product 0 = any
+    // serial and port (bus-port path, e.g. "1-2.3") select one of several units, empty = any
+    bool isAttached(unsigned vendor, unsigned product,
+                    const std::string &serial = "", const std::string &port = "");
+
+    // bus-port path of a device, as used by port above
+    static std::string portPath(libusb_device *device);
+
+    void run();
+    void changed(); // from libusb hotplug callback
+
+private:
+    libusb_context *context_;
+    UsbHotplugListener *listener_;
+    unsigned long long settleTime_; // uS
+    std::atomic<bool> running_;
+    std::atomic<unsigned long long> changedAt_; // 0 = no change
+    int callbackHandle_;
+    std::thread thread_;
+};
+
+}
+
+#endif //MEC_USBHOTPLUG_H
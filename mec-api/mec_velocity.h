@@ -0,0 +1,84 @@
+#ifndef MEC_VELOCITY_H_
+#define MEC_VELOCITY_H_
+
+#include <math.h>
+#include <vector>
+
+namespace mec {
+
+// velocity estimation from the first pressure samples of a touch
+// velocity is the slope of a least squares fit of pressure over sample index,
+// with two implicit zero samples at the start of the touch, so x runs 0..n-1
+// and sum(x), sum(x^2) are known from n alone.
+// state is kept as arrays indexed by voice, allocated on construction
+// voices are updated one at a time, as devices deliver key samples one at a time,
+// there is no batch pass over all voices, and no refinement once the touch on has been sent
+// (nothing downstream can take a revised velocity, touch on velocity is final)
+class VelocityEstimator {
+public:
+    static const unsigned CURVE_SIZE = 256;
+
+    VelocityEstimator(unsigned voiceCount, float scale = 4.0f, float curve = 1.0f)
+            : sumy_(voiceCount, 0.0f), sumxy_(voiceCount, 0.0f), n_(voiceCount, 2.0f), table_(CURVE_SIZE + 1) {
+        setCurve(scale, curve);
+    }
+
+    // v = 1 - (1 - raw) ^ curve, raw = scale * slope
+    void setCurve(float scale, float curve) {
+        scale_ = scale;
+        for (unsigned i = 0; i <= CURVE_SIZE; i++) {
+            float raw = float(i) / float(CURVE_SIZE);
+            table_[i] = static_cast<float>(1.0 - pow(1.0 - raw, (double) curve));
+        }
+    }
+
+    void start(unsigned i) {
+        sumy_[i] = 0.0f;
+        sumxy_[i] = 0.0f;
+        n_[i] = 2.0f; // implicit zero samples
+    }
+
+    // returns number of samples added since start
+    unsigned addSample(unsigned i, float p) {
+        sumy_[i] += p;
+        sumxy_[i] += n_[i] * p;
+        n_[i] += 1.0f;
+        return static_cast<unsigned>(n_[i]) - 2;
+    }
+
+    float raw(unsigned i) const {
+        return slope(sumy_[i], sumxy_[i], n_[i]) * scale_;
+    }
+
+    float velocity(unsigned i) const {
+        return curve(raw(i));
+    }
+
+    // curve applied by table lookup, clamped to 0.01 .. 1.0
+    float curve(float raw) const {
+        float r = raw < 0.0f ? 0.0f : (raw > 1.0f ? 1.0f : raw);
+        float fi = r * CURVE_SIZE;
+        unsigned i = static_cast<unsigned>(fi);
+        if (i >= CURVE_SIZE) i = CURVE_SIZE - 1;
+        float frac = fi - float(i);
+        float v = table_[i] + (table_[i + 1] - table_[i]) * frac;
+        return v < 0.01f ? 0.01f : (v > 1.0f ? 1.0f : v);
+    }
+
+private:
+    // sum(x) = n(n-1)/2, sum(x^2) = (n-1)n(2n-1)/6, so denominator is n^2(n^2-1)/12
+    static float slope(float sumy, float sumxy, float n) {
+        float sumx = n * (n - 1.0f) * 0.5f;
+        return (n * sumxy - sumx * sumy) * 12.0f / (n * n * (n * n - 1.0f));
+    }
+
+    std::vector<float> sumy_;
+    std::vector<float> sumxy_;
+    std::vector<float> n_;
+    std::vector<float> table_;
+    float scale_;
+};
+
+}
+
+#endif //MEC_VELOCITY_H_
@@ -3,25 +3,58 @@
 
 #include <math.h>
 #include <vector>
-#include <list>
+#include <string>
 
 #include "mec_log.h"
+#include "mec_velocity.h"
 
 namespace mec {
 
+// voice allocation, all storage is allocated on construction
+// keys (ids) below keyCount are looked up directly, others by scanning the used voices
+// free and used voices are intrusive lists thru the voice array,
+// used voices are in start order (so front is oldest), free voices are reused in stop order
+// when all voices are used, voiceToSteal() picks a voice according to the steal policy,
+// stolen keys are tracked (keys below keyCount) so they are not restarted until released
+// velocity is estimated from the first velocityCount pressures (see VelocityEstimator),
+// with early velocity the voice becomes active (and v_ is set) after fewer samples, v_ is not refined after
 class Voices {
 public:
     const float V_SCALE_AMT = 4.0f;
     const float V_CURVE_AMT = 1.0f;
+    static const unsigned DEFAULT_KEY_COUNT = 256;
 
-    Voices(unsigned voiceCount = 15, unsigned velocityCount = 5)
-            : maxVoices_(voiceCount), velocityCount_(velocityCount) {
+    enum StealPolicy {
+        STEAL_OLDEST,
+        STEAL_QUIETEST, // lowest z
+        STEAL_HIGHEST,  // highest note
+        STEAL_LOWEST,   // lowest note
+        STEAL_NEAREST   // nearest pitch to the new note
+    };
+
+    // from prefs "steal policy" : oldest, quietest, highest, lowest, nearest
+    static StealPolicy stealPolicy(const std::string &name) {
+        if (name == "quietest") return STEAL_QUIETEST;
+        if (name == "highest") return STEAL_HIGHEST;
+        if (name == "lowest") return STEAL_LOWEST;
+        if (name == "nearest") return STEAL_NEAREST;
+        if (name != "oldest") LOG_0("Voices : unknown steal policy " << name << ", using oldest");
+        return STEAL_OLDEST;
+    }
+
+    Voices(unsigned voiceCount = 15, unsigned velocityCount = 5, unsigned keyCount = DEFAULT_KEY_COUNT)
+            : maxVoices_(voiceCount), velocityCount_(velocityCount), earlyVelocity_(0),
+              velocity_(voiceCount, V_SCALE_AMT, V_CURVE_AMT),
+              stealPolicy_(STEAL_OLDEST) {
         voices_.resize(maxVoices_);
+        keys_.assign(keyCount, NO_VOICE);
+        stolen_.assign((keyCount + 63) / 64, 0);
         for (int i = 0; i < maxVoices_; i++) {
             voices_[i].i_ = i;
             voices_[i].state_ = Voice::INACTIVE;
             voices_[i].id_ = -1;
-            freeVoices_.push_back(&voices_[i]);
+            voices_[i].prev_ = voices_[i].next_ = NO_VOICE;
+            append(freeVoices_, i);
         }
 
     };
@@ -38,6 +71,7 @@ public:
         float z_;
         float v_;
         unsigned long long t_;
+        int prev_, next_; // list links, index into voices
         enum {
             INACTIVE,
             PENDING, // velocity
@@ -47,91 +81,72 @@ public:
         //velocity, taken from velocity detector
         struct {
             unsigned vcount_;
-            float sumx_, sumy_, sumxy_, sumxsq_, x_;
-            float scale_, curve_; // comes from config
             float raw_;
         } vel_;
     };
 
     Voice *voiceId(unsigned id) {
-        for (int i = 0; i < maxVoices_; i++) {
-            if (voices_[i].id_ == id)
+        if (id < keys_.size()) {
+            int i = keys_[id];
+            return i != NO_VOICE ? &voices_[i] : NULL;
+        }
+        for (int i = usedVoices_.head_; i != NO_VOICE; i = voices_[i].next_) {
+            if (voices_[i].id_ == (int) id)
                 return &voices_[i];
         }
         return NULL;
     }
 
     Voice *startVoice(unsigned id) {
-        Voice *voice;
-        if (freeVoices_.size() > 0) {
-            voice = freeVoices_.front();
-            freeVoices_.pop_front();
-        } else {
+        if (freeVoices_.head_ == NO_VOICE) {
             // all voices used, use oldestActiveVoice
             // if you wish to steal it
             return NULL;
         }
+        Voice *voice = &voices_[freeVoices_.head_];
+        remove(freeVoices_, voice->i_);
         voice->id_ = id;
+        if (id < keys_.size()) keys_[id] = voice->i_;
         voice->state_ = Voice::PENDING;
         voice->v_ = 0;
 
-        voice->vel_.scale_ = V_SCALE_AMT;
-        voice->vel_.curve_ = V_CURVE_AMT;
         voice->vel_.vcount_ = 0;
-        voice->vel_.sumx_ = voice->vel_.sumy_ = voice->vel_.sumxy_ = voice->vel_.sumxsq_ = 0.0;
-        voice->vel_.x_ = 0.0;
+        voice->vel_.raw_ = 0.0f;
+        velocity_.start(voice->i_);
 
-        voice->vel_.sumx_ += voice->vel_.x_;
-        voice->vel_.sumxsq_ += voice->vel_.x_ * voice->vel_.x_;
-        voice->vel_.x_++;
-
-        voice->vel_.sumx_ += voice->vel_.x_;
-        voice->vel_.sumxsq_ += voice->vel_.x_ * voice->vel_.x_;
-        voice->vel_.x_++;
-
-
-        usedVoices_.push_back(voice);
+        append(usedVoices_, voice->i_);
         return voice;
     }
 
+    // call for pending voices, voice becomes active once velocity is known
     void addPressure(Voice *voice, float p) {
-        if (voice->state_ == Voice::PENDING) {
-
-
-            if (voice->vel_.vcount_ < velocityCount_) {
-                voice->vel_.sumx_ += voice->vel_.x_;
-                voice->vel_.sumy_ += p;
-                voice->vel_.sumxy_ += (voice->vel_.x_ * p);
-                voice->vel_.sumxsq_ += (voice->vel_.x_ * voice->vel_.x_);
-                voice->vel_.vcount_++;
-                voice->vel_.x_++;
-
-                if (p <= 1.0) {
-                    return;
-                }
-                // else max pressure, so consider 'complete'
-            }
+        if (voice->state_ != Voice::PENDING) return;
 
+        if (voice->vel_.vcount_ < velocityCount_) {
+            voice->vel_.vcount_ = velocity_.addSample(voice->i_, p);
+        }
+        // max pressure, so consider 'complete'
+        bool complete = voice->vel_.vcount_ >= velocityCount_ || p > 1.0f;
+        if (complete || (earlyVelocity_ > 0 && voice->vel_.vcount_ >= earlyVelocity_)) {
+            voice->vel_.raw_ = velocity_.raw(voice->i_);
+            voice->v_ = velocity_.curve(voice->vel_.raw_);
             voice->state_ = Voice::ACTIVE;
-            voice->vel_.raw_ = voice->vel_.scale_ *
-                               (voice->vel_.x_ * voice->vel_.sumxy_ - (voice->vel_.sumx_ * voice->vel_.sumy_))
-                               / (voice->vel_.x_ * voice->vel_.sumxsq_ - (voice->vel_.sumx_ * voice->vel_.sumx_));
-            voice->v_ = static_cast<float>(1.0f - pow((double) (1.0f - voice->vel_.raw_), (double) (voice->vel_.curve_)));
-
-            // LOG_1("vel detector : " << voice->id_);
-            // LOG_1("raw : " << voice->vel_.raw_ << " v " << voice->v_);
-            // LOG_1("x  " << voice->vel_.x_);
-            // LOG_1("sumxy " <<voice->vel_.sumxy_ << " sumxsq " << voice->vel_.sumxsq_);
-            // LOG_1("sumx  " << voice->vel_.sumx_ << " sumy " << voice->vel_.sumy_ );
-
-            if (voice->v_ > 1.0) voice->v_ = 1.0;
-            if (voice->v_ < 0.01) voice->v_ = 0.01;
+            // LOG_1("vel detector : " << voice->id_ << " raw : " << voice->vel_.raw_ << " v " << voice->v_);
         }
     }
 
+    // prefs "velocity scale", "velocity curve"
+    void setVelocityCurve(float scale, float curve) { velocity_.setCurve(scale, curve); }
+
+    // prefs "velocity early", samples before voice is active, 0 = wait for velocity count
+    void setEarlyVelocity(unsigned samples) { earlyVelocity_ = samples; }
+
     void stopVoice(Voice *voice) {
-        if (!voice) return;
-        usedVoices_.remove(voice);
+        if (!voice || voice->state_ == Voice::INACTIVE) return;
+        remove(usedVoices_, voice->i_);
+        if (voice->id_ >= 0 && (unsigned) voice->id_ < keys_.size() && keys_[voice->id_] == voice->i_) {
+            keys_[voice->id_] = NO_VOICE;
+        }
         voice->id_ = -1;
         voice->note_ = 0;
         voice->x_ = 0;
@@ -139,20 +154,116 @@ public:
         voice->z_ = 0;
         voice->t_ = 0;
         voice->state_ = Voice::INACTIVE;
-        freeVoices_.push_back(voice);
+        append(freeVoices_, voice->i_);
     }
 
+    // NULL if no voices are in use
     Voice *oldestActiveVoice() {
-        return usedVoices_.front();
+        return usedVoices_.head_ != NO_VOICE ? &voices_[usedVoices_.head_] : NULL;
+    }
+
+    // used voices in start order, from oldestActiveVoice(), NULL at end
+    Voice *nextVoice(Voice *voice) {
+        return voice->next_ != NO_VOICE ? &voices_[voice->next_] : NULL;
+    }
+
+    unsigned voiceCount() const { return maxVoices_; }
+
+    void setStealPolicy(StealPolicy policy) { stealPolicy_ = policy; }
+
+    StealPolicy stealPolicy() { return stealPolicy_; }
+
+    // voice to steal for a new note, NULL if no voices are in use
+    // only active voices are considered (pending voices have not sent a touch on yet),
+    // if none are active, the oldest voice. ties go to the oldest voice
+    Voice *voiceToSteal(float note) {
+        Voice *best = NULL;
+        float bestScore = 0.0f;
+        for (int i = usedVoices_.head_; i != NO_VOICE; i = voices_[i].next_) {
+            Voice *voice = &voices_[i];
+            if (voice->state_ != Voice::ACTIVE) continue;
+            float score;
+            switch (stealPolicy_) {
+                case STEAL_OLDEST:
+                    return voice;
+                case STEAL_QUIETEST:
+                    score = voice->z_;
+                    break;
+                case STEAL_HIGHEST:
+                    score = -voice->note_;
+                    break;
+                case STEAL_LOWEST:
+                    score = voice->note_;
+                    break;
+                case STEAL_NEAREST:
+                default:
+                    score = fabsf(voice->note_ - note);
+                    break;
+            }
+            if (best == NULL || score < bestScore) {
+                best = voice;
+                bestScore = score;
+            }
+        }
+        return best != NULL ? best : oldestActiveVoice();
+    }
+
+    // stops the voice, and marks its key as stolen
+    void stealVoice(Voice *voice) {
+        if (!voice || voice->state_ == Voice::INACTIVE) return;
+        unsigned id = static_cast<unsigned>(voice->id_);
+        if (voice->id_ >= 0 && id < keys_.size()) stolen_[id / 64] |= (1ULL << (id % 64));
+        stopVoice(voice);
+    }
+
+    bool isStolen(unsigned id) {
+        return id < keys_.size() && (stolen_[id / 64] & (1ULL << (id % 64))) != 0;
+    }
+
+    // call when the key is released
+    void clearStolen(unsigned id) {
+        if (id < keys_.size()) stolen_[id / 64] &= ~(1ULL << (id % 64));
     }
 
 
 private:
+    enum {
+        NO_VOICE = -1
+    };
+
+    struct VoiceList {
+        VoiceList() : head_(NO_VOICE), tail_(NO_VOICE) { ; }
+        int head_, tail_;
+    };
+
+    void append(VoiceList &list, int i) {
+        Voice &v = voices_[i];
+        v.prev_ = list.tail_;
+        v.next_ = NO_VOICE;
+        if (list.tail_ != NO_VOICE) voices_[list.tail_].next_ = i;
+        else list.head_ = i;
+        list.tail_ = i;
+    }
+
+    void remove(VoiceList &list, int i) {
+        Voice &v = voices_[i];
+        if (v.prev_ != NO_VOICE) voices_[v.prev_].next_ = v.next_;
+        else list.head_ = v.next_;
+        if (v.next_ != NO_VOICE) voices_[v.next_].prev_ = v.prev_;
+        else list.tail_ = v.prev_;
+        v.prev_ = v.next_ = NO_VOICE;
+    }
+
     std::vector<Voice> voices_;
-    std::list<Voice *> freeVoices_;
-    std::list<Voice *> usedVoices_;
+    std::vector<int> keys_; // key -> voice index
+    std::vector<unsigned long long> stolen_; // bitset, by key
+    VoiceList freeVoices_;
+    VoiceList usedVoices_;
     unsigned maxVoices_;
     unsigned velocityCount_;
+    unsigned earlyVelocity_;
+    VelocityEstimator velocity_;
+    StealPolicy stealPolicy_;
 };
 }
 
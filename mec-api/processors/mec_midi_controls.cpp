@@ -0,0 +1,83 @@
+#include "mec_midi_controls.h"
+
+#include "mec_log.h"
+
+#include <math.h>
+#include <cstdlib>
+
+namespace mec {
+
+MidiControls::MidiControls() {
+    clear();
+    for (unsigned id = 0; id < 128; id++) {
+        set(id, T_CC, id);
+    }
+}
+
+void MidiControls::clear() {
+    for (unsigned id = 0; id < MAX_CONTROLS; id++) {
+        Control &c = controls_[id];
+        c.type_ = T_NONE;
+        c.channel_ = -1;
+        c.number_ = 0;
+        c.curve_ = 1.0f;
+        c.bipolar_ = false;
+        c.deadband_ = 0;
+        c.max_ = 127;
+        c.sent_ = -1;
+    }
+}
+
+bool MidiControls::set(unsigned id, Type type, unsigned number, int channel,
+                       float curve, unsigned deadband, bool bipolar) {
+    if (id >= MAX_CONTROLS) return false;
+    // cc14 uses number + 32 for lsb
+    unsigned limit = type == T_NRPN ? 16384 : (type == T_CC14 ? 32 : 128);
+    if (number >= limit || channel > 15 || curve <= 0.0f) return false;
+    Control &c = controls_[id];
+    c.type_ = type;
+    c.channel_ = channel < 0 ? -1 : channel;
+    c.number_ = number;
+    c.curve_ = curve;
+    c.bipolar_ = bipolar;
+    c.deadband_ = deadband;
+    c.max_ = type == T_CC ? 127 : 16383;
+    c.sent_ = -1;
+    return true;
+}
+
+bool MidiControls::load(const Preferences &prefs) {
+    if (!prefs.valid()) return false;
+    clear();
+    bool ok = true;
+    std::vector<std::string> keys = prefs.getKeys();
+    for (std::vector<std::string>::iterator i = keys.begin(); i != keys.end(); i++) {
+        Preferences p(prefs.getSubTree(*i));
+        char *end = nullptr;
+        long id = strtol(i->c_str(), &end, 0);
+        if (end == i->c_str() || *end != 0 || !p.valid()) {
+            LOG_0("MidiControls: invalid control " << *i);
+            ok = false;
+            continue;
+        }
+        std::string t = p.getString("type", "cc");
+        Type type = t == "cc14" ? T_CC14 : (t == "nrpn" ? T_NRPN : (t == "none" ? T_NONE : T_CC));
+        if (type == T_NONE) continue;
+        if (!set(static_cast<unsigned>(id), type,
+                 static_cast<unsigned>(p.getInt("number", static_cast<int>(id))),
+                 p.getInt("channel", 0) - 1,
+                 static_cast<float>(p.getDouble("curve", 1.0)),
+                 static_cast<unsigned>(p.getInt("deadband", 0)),
+                 p.getBool("bipolar", false))) {
+            LOG_0("MidiControls: invalid mapping for control " << *i);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+float MidiControls::curve(float v, float exponent) {
+    return powf(v, exponent);
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+//////////////
+// maps control ids (e.g. eigenharp strips 0x10+, pedals 0x20+, breath) to midi controllers
+// each id maps to a 7 bit cc, a 14 bit cc pair (msb n, lsb n+32) or an nrpn (14 bit data entry),
+// with a response curve and a deadband (in output steps).
+// the table is indexed directly by control id, so evaluating a control is an index and a compare.
+// ids outside the table are ignored.
+//
+// loaded from prefs, keyed by control id:
+//   "controls" : { "16" : { "type" : "cc14", "number" : 1, "curve" : 2.0, "deadband" : 4 } }
+// "type" cc, cc14, nrpn or none, "channel" 1-16 (default processor channel), "bipolar" for -1..1 input
+// without prefs, ids 0-127 are sent as the 7 bit cc of the same number
+
+#include "mec_prefs.h"
+
+namespace mec {
+
+class MidiControls {
+public:
+    static const unsigned MAX_CONTROLS = 256;
+
+    enum Type {
+        T_NONE,
+        T_CC,
+        T_CC14,
+        T_NRPN
+    };
+
+    struct Control {
+        Type type_;
+        int channel_;       // 0-15, -1 = default
+        unsigned number_;   // cc or nrpn
+        float curve_;       // exponent, 1 = linear
+        bool bipolar_;
+        unsigned deadband_;
+        unsigned max_;      // 127 or 16383
+        int sent_;          // -1 never sent
+    };
+
+    MidiControls();
+
+    // replaces the default mapping with the prefs mapping
+    bool load(const Preferences &prefs);
+    void clear();
+    bool set(unsigned id, Type type, unsigned number, int channel = -1,
+             float curve = 1.0f, unsigned deadband = 0, bool bipolar = false);
+
+    // null if not mapped
+    const Control *control(int id) const {
+        if (id < 0 || id >= static_cast<int>(MAX_CONTROLS) || controls_[id].type_ == T_NONE) return nullptr;
+        return &controls_[id];
+    }
+
+    // scaled value, false if within deadband of last sent value
+    bool value(int id, float v, unsigned &out) {
+        Control &c = controls_[id];
+        if (c.bipolar_) v = (v + 1.0f) / 2.0f;
+        v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+        if (c.curve_ != 1.0f) v = curve(v, c.curve_);
+        out = static_cast<unsigned>(v * c.max_ + 0.5f);
+        if (c.sent_ >= 0) {
+            unsigned d = out > static_cast<unsigned>(c.sent_) ? out - c.sent_ : c.sent_ - out;
+            if (d == 0 || (d <= c.deadband_ && out != 0 && out != c.max_)) return false;
+        }
+        c.sent_ = static_cast<int>(out);
+        return true;
+    }
+
+private:
+    static float curve(float v, float exponent);
+
+    Control controls_[MAX_CONTROLS];
+};
+
+}
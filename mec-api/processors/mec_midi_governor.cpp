@@ -0,0 +1,97 @@
+#include "mec_midi_governor.h"
+
+#include <stdlib.h>
+
+namespace mec {
+
+MidiGovernor::MidiGovernor() : rate_(0), burst_(4.0f) {
+    for (unsigned p = 0; p < P_MAX; p++) {
+        deadband_[p] = 0;
+    }
+    for (unsigned ch = 0; ch < CHANNELS; ch++) {
+        noteOn(ch, 0, 0, 0, 0);
+    }
+}
+
+void MidiGovernor::load(const Preferences &prefs) {
+    if (!prefs.valid()) return;
+    setDeadband(P_PITCH, static_cast<unsigned>(prefs.getInt("pitch deadband", 0)));
+    setDeadband(P_TIMBRE, static_cast<unsigned>(prefs.getInt("timbre deadband", 0)));
+    setDeadband(P_PRESSURE, static_cast<unsigned>(prefs.getInt("pressure deadband", 0)));
+    setRate(static_cast<unsigned>(prefs.getInt("max rate", 0)), static_cast<unsigned>(prefs.getInt("burst", 4)));
+}
+
+void MidiGovernor::setDeadband(Param p, unsigned deadband) {
+    deadband_[p] = deadband;
+}
+
+void MidiGovernor::setRate(unsigned maxRate, unsigned burst) {
+    rate_ = maxRate;
+    // need at least a token for pitch, and one in reserve
+    burst_ = static_cast<float>(burst < 2 ? 2 : burst);
+}
+
+void MidiGovernor::noteOn(unsigned ch, int pitch, int timbre, int pressure, unsigned long long t) {
+    Channel &c = channels_[ch % CHANNELS];
+    int values[P_MAX] = {pitch, timbre, pressure};
+    for (unsigned p = 0; p < P_MAX; p++) {
+        c.values_[p].sent_ = values[p];
+        c.values_[p].latest_ = values[p];
+        c.values_[p].pending_ = false;
+    }
+    c.tokens_ = burst_;
+    c.t_ = t;
+}
+
+bool MidiGovernor::take(unsigned ch, Param p, unsigned long long t) {
+    if (rate_ == 0) return true;
+    Channel &c = channels_[ch];
+    if (t > c.t_) {
+        c.tokens_ += static_cast<float>(t - c.t_) * rate_ / 1000000.0f;
+        if (c.tokens_ > burst_) c.tokens_ = burst_;
+        c.t_ = t;
+    }
+    float reserve = p == P_PITCH ? 0.0f : 1.0f;
+    if (c.tokens_ < 1.0f + reserve) return false;
+    c.tokens_ -= 1.0f;
+    return true;
+}
+
+bool MidiGovernor::send(unsigned ch, Param p, int value, unsigned long long t) {
+    ch = ch % CHANNELS;
+    Value &v = channels_[ch].values_[p];
+    v.latest_ = value;
+    if (static_cast<unsigned>(abs(value - v.sent_)) <= deadband_[p]) {
+        // includes no change, nothing left to send
+        if (value == v.sent_) v.pending_ = false;
+        return false;
+    }
+    if (!take(ch, p, t)) {
+        v.pending_ = true;
+        return false;
+    }
+    v.sent_ = value;
+    v.pending_ = false;
+    return true;
+}
+
+bool MidiGovernor::pending(unsigned ch, Param p, unsigned long long t, int &value) {
+    ch = ch % CHANNELS;
+    Value &v = channels_[ch].values_[p];
+    if (!v.pending_ || !take(ch, p, t)) return false;
+    v.pending_ = false;
+    v.sent_ = v.latest_;
+    value = v.latest_;
+    return true;
+}
+
+bool MidiGovernor::final(unsigned ch, Param p, int &value) {
+    Value &v = channels_[ch % CHANNELS].values_[p];
+    v.pending_ = false;
+    if (v.latest_ == v.sent_) return false;
+    v.sent_ = v.latest_;
+    value = v.latest_;
+    return true;
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+//////////////
+// limits midi output from continuous touch data, per channel
+// - deadband per parameter, changes within it are not sent (until release)
+// - maximum message rate per channel, as a token bucket, note on/off are never limited,
+//   and pressure/timbre leave a token in reserve so pitch is sent first
+// - values held back by the rate limit are sent when tokens are available (flush),
+//   and on release the final values are always sent, so nothing is left stale
+// defaults (no deadband, no rate limit) send every change
+
+#include "mec_prefs.h"
+
+namespace mec {
+
+class MidiGovernor {
+public:
+    static const unsigned CHANNELS = 16;
+
+    enum Param {
+        P_PITCH,    // 14 bit pitchbend
+        P_TIMBRE,   // 7 bit
+        P_PRESSURE, // 7 bit
+        P_MAX
+    };
+
+    MidiGovernor();
+
+    // "pitch deadband", "timbre deadband", "pressure deadband", "max rate" (per channel/second), "burst"
+    void load(const Preferences &prefs);
+
+    void setDeadband(Param p, unsigned deadband);
+    // 0 = unlimited
+    void setRate(unsigned maxRate, unsigned burst = 4);
+
+    // values sent with note on
+    void noteOn(unsigned ch, int pitch, int timbre, int pressure, unsigned long long t);
+
+    // true if the value should be sent now
+    bool send(unsigned ch, Param p, int value, unsigned long long t);
+
+    // value held back by rate limit, which can now be sent
+    bool pending(unsigned ch, Param p, unsigned long long t, int &value);
+
+    // on release, latest value if it was not sent
+    bool final(unsigned ch, Param p, int &value);
+
+private:
+    bool take(unsigned ch, Param p, unsigned long long t);
+
+    struct Value {
+        int sent_;
+        int latest_;
+        bool pending_; // held back by rate limit
+    };
+
+    struct Channel {
+        Value values_[P_MAX];
+        float tokens_;
+        unsigned long long t_;
+    };
+
+    unsigned deadband_[P_MAX];
+    unsigned rate_;
+    float burst_;
+    Channel channels_[CHANNELS];
+};
+
+}
@@ -1,12 +1,17 @@
 
 #include "mec_midi_processor.h"
 
+#include "../mec_stats.h"
+
 //#include "mec_log.h"
 
 namespace mec {
 
-Midi_Processor::Midi_Processor(float pbr) : pitchbendRange_ (pbr) {
-    ;
+Midi_Processor::Midi_Processor(float pbr) : pitchbendRange_ (pbr), controlChannel_(0),
+    buffered_(false), bufferUsed_(0) {
+    for (unsigned ch = 0; ch < 16; ch++) {
+        nrpnSelected_[ch] = -1;
+    }
 }
 
 Midi_Processor::~Midi_Processor() {
@@ -17,6 +22,11 @@ void Midi_Processor::setPitchbendRange(float v) {
     pitchbendRange_ = v;
 }
 
+void Midi_Processor::setBuffered(bool buffered) {
+    flush();
+    buffered_ = buffered;
+}
+
 /////////////////////////
 // ICallback interface
 void Midi_Processor::touchOn(int id, float note, float , float , float z) {
@@ -37,11 +47,24 @@ void Midi_Processor::touchOff(int id, float note, float , float , float z) {
 }
 
 void Midi_Processor::control(int attr, float v) {
-
-    if (global_[attr] != v ) {
-        global_[attr] = v;
-        cc(0, static_cast<unsigned int>(attr), unipolar7bit(v));
-        // cc(ch, attr, isBipolar ? bipolar7bit(v) : unipolar7bit(v));
+    const MidiControls::Control *c = controls_.control(attr);
+    unsigned value;
+    if (c == nullptr || !controls_.value(attr, v, value)) return;
+
+    unsigned ch = c->channel_ < 0 ? controlChannel_ : static_cast<unsigned>(c->channel_);
+    switch (c->type_) {
+        case MidiControls::T_CC :
+            cc(ch, c->number_, value);
+            break;
+        case MidiControls::T_CC14 :
+            cc(ch, c->number_, value >> 7);
+            cc(ch, c->number_ + 32, value & 0x7F);
+            break;
+        case MidiControls::T_NRPN :
+            nrpn(ch, c->number_, value);
+            break;
+        default:
+            break;
     }
 }
 
@@ -51,10 +74,47 @@ void Midi_Processor::mec_control(int , void* ) {
 }
 
 
+void Midi_Processor::output(MidiMsg &msg) {
+    if (!buffered_) {
+        MEC_STAT_START(st);
+        process(msg);
+        MEC_STAT_SINCE(Stats::S_PROCESSOR, st);
+        return;
+    }
+
+    if (bufferUsed_ + msg.size > BUFFER_SIZE) flush();
+
+    for (unsigned i = 0; i < msg.size; i++) {
+        buffer_[bufferUsed_++] = static_cast<unsigned char>(msg.data[i]);
+    }
+}
+
+void Midi_Processor::flush() {
+    if (bufferUsed_ == 0) return;
+    MEC_STAT_START(st);
+    processBatch(buffer_, bufferUsed_);
+    MEC_STAT_SINCE(Stats::S_PROCESSOR, st);
+    bufferUsed_ = 0;
+}
+
+void Midi_Processor::processBatch(const unsigned char *data, unsigned size) {
+    unsigned i = 0;
+    while (i < size) {
+        unsigned char status = data[i++];
+        if ((status & 0x80) == 0) continue; // data without status
+        MidiMsg msg(static_cast<char>(status));
+        unsigned len = dataLength(status);
+        for (unsigned n = 0; n < len && i < size; n++) {
+            msg.data[msg.size++] = static_cast<char>(data[i++]);
+        }
+        process(msg);
+    }
+}
+
 bool Midi_Processor::noteOn(unsigned ch, unsigned note, unsigned vel) {
     // LOG_1( "midi note on ch " << ch << " note " << note  << " vel " << vel );
     MidiMsg msg(static_cast<char>(0x90 + ch), static_cast<char>(note), static_cast<char>(vel));
-    process(msg);
+    output(msg);
     return true;
 }
 
@@ -62,28 +122,42 @@ bool Midi_Processor::noteOn(unsigned ch, unsigned note, unsigned vel) {
 bool Midi_Processor::noteOff(unsigned ch, unsigned note, unsigned vel) {
     // LOG_1( "midi  note off ch " << ch << " note " << note  << " vel " << vel )
     MidiMsg msg(static_cast<char>(0x80 + ch), static_cast<char>(note), static_cast<char>(vel));
-    process(msg);
+    output(msg);
     return true;
 }
 
 bool Midi_Processor::cc(unsigned ch, unsigned cc, unsigned v) {
+    // (n)rpn selection changed by caller
+    if (cc >= 98 && cc <= 101) nrpnSelected_[ch & 0x0F] = -1;
     // LOG_1( "midi note off ch " << ch << " note " << note  << " vel " << vel )
     MidiMsg msg(static_cast<char>(0xB0 + ch), static_cast<char>(cc), static_cast<char>(v));
-    process(msg);
+    output(msg);
     return true;
 }
 
 bool Midi_Processor::pressure(unsigned ch, unsigned v) {
     // LOG_1( "midi pressure ch " << ch << " v  " << v)
     MidiMsg msg(static_cast<char>(0xD0 + ch),static_cast<char>(v));
-    process(msg);
+    output(msg);
     return true;
 }
 
 bool Midi_Processor::pitchbend(unsigned ch, unsigned v) {
     // LOG_1( "midi pitchbend ch " << ch << " v  " << v)
     MidiMsg msg(static_cast<char>(0xE0 + ch), static_cast<char>(v & 0x7f), static_cast<char>((v & 0x3F80) >> 7));
-    process(msg);
+    output(msg);
+    return true;
+}
+
+bool Midi_Processor::nrpn(unsigned ch, unsigned param, unsigned v) {
+    ch &= 0x0F;
+    if (nrpnSelected_[ch] != static_cast<int>(param)) {
+        cc(ch, 99, (param >> 7) & 0x7F);
+        cc(ch, 98, param & 0x7F);
+        nrpnSelected_[ch] = static_cast<int>(param);
+    }
+    cc(ch, 6, (v >> 7) & 0x7F);
+    cc(ch, 38, v & 0x7F);
     return true;
 }
 
@@ -3,8 +3,12 @@
 //////////////
 // this class can be used to process incoming callbacks and convert into Midi messages
 // define the process method to determine what to do with the midi message
+// when buffered, messages are instead written to a buffer as complete messages (no running status,
+// as outputs e.g. rtmidi only take complete messages), which is
+// passed to processBatch() once per dispatch cycle (flush), or when full
 
 #include "../mec_api.h"
+#include "mec_midi_controls.h"
 
 #include <list>
 
@@ -26,8 +30,21 @@ public:
     };
 
 
+    static const unsigned BUFFER_SIZE = 1024;
+
     virtual void  process(MidiMsg& msg) = 0;
+    // default splits the batch (complete messages) into process() calls
+    virtual void  processBatch(const unsigned char *data, unsigned size);
     void setPitchbendRange(float pbr);
+    void setBuffered(bool buffered);
+
+    // control id to cc/nrpn mapping, see mec_midi_controls.h
+    MidiControls &controls() { return controls_; }
+
+    // number of data bytes following a status byte
+    static unsigned dataLength(unsigned char status) {
+        return (status & 0xE0) == 0xC0 ? 1 : (status < 0xF0 ? 2 : 0);
+    }
 
     // ICallback handling
     virtual void touchOn(int touchId, float note, float x, float y, float z);
@@ -35,22 +52,36 @@ public:
     virtual void touchOff(int touchId, float note, float x, float y, float z);
     virtual void control(int ctrlId, float v);
     virtual void mec_control(int cmd, void* other); //ignores
+    virtual void flush();
 
 protected:
 
+    // calls process(), timing midi output
+    void output(MidiMsg &msg);
+
     // low level midi, open unchecked
     bool noteOn(unsigned ch, unsigned note, unsigned vel);
     bool noteOff(unsigned ch, unsigned note, unsigned vel);
     bool cc(unsigned ch, unsigned cc, unsigned v);
     bool pressure(unsigned ch, unsigned v);
     bool pitchbend(unsigned ch, unsigned v);
+    bool nrpn(unsigned ch, unsigned param, unsigned v);
 
-    unsigned bipolar14bit(float v) {return static_cast<unsigned int>((v * 0x2000) + 0x2000);}
-    unsigned bipolar7bit(float v)  {return static_cast<unsigned int>(((v / 2.0f) + 0.5f) * 127); }
-    unsigned unipolar7bit(float v) {return static_cast<unsigned int>(v * 127);}
+    // clamped, so out of range values cannot set the status bit
+    unsigned bipolar14bit(float v) {return clamp(static_cast<int>((v * 0x2000) + 0x2000), 0x3FFF);}
+    unsigned bipolar7bit(float v)  {return clamp(static_cast<int>(((v / 2.0f) + 0.5f) * 127), 127); }
+    unsigned unipolar7bit(float v) {return clamp(static_cast<int>(v * 127), 127);}
+    static unsigned clamp(int v, int mx) {return static_cast<unsigned>(v < 0 ? 0 : (v > mx ? mx : v));}
 
-    float global_[127];
     float pitchbendRange_;
+    unsigned controlChannel_; // for controls without channel
+
+private:
+    MidiControls controls_;
+    int nrpnSelected_[16]; // avoids resending nrpn param, -1 unknown
+    bool buffered_;
+    unsigned bufferUsed_;
+    unsigned char buffer_[BUFFER_SIZE];
 };
 
 }
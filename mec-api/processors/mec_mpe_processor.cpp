@@ -1,27 +1,115 @@
 
 #include "mec_mpe_processor.h"
 
+#include "mec_time.h"
+
 //#include "mec_log.h"
 
 namespace mec {
 
 #define TIMBRE_CC 74
 
-MPE_Processor::MPE_Processor(float pbr) : Midi_Processor(pbr) {
-    ;
+MPE_Processor::MPE_Processor(float pbr) : Midi_Processor(pbr),
+    zone_(Z_LOWER), members_(MAX_CHANNELS), releases_(0), touchInput_(true) {
+    controlChannel_ = managerChannel();
+    for (unsigned i = 0; i < MAX_TOUCHES; i++) {
+        voices_[i].channel_ = -1;
+        voices_[i].startNote_ = 0;
+    }
+    for (unsigned ch = 0; ch < 16; ch++) {
+        channels_[ch].active_ = false;
+        channels_[ch].released_ = 0;
+    }
 }
 
 MPE_Processor::~MPE_Processor() {
     ;
 }
 
+void MPE_Processor::setZone(Zone zone, unsigned members) {
+    zone_ = zone;
+    members_ = members < 1 ? 1 : (members > MAX_CHANNELS ? MAX_CHANNELS : members);
+    // global controls on the manager channel
+    controlChannel_ = managerChannel();
+}
+
+void MPE_Processor::rpn(unsigned ch, unsigned rpn, unsigned msb, unsigned lsb) {
+    cc(ch, 101, (rpn >> 7) & 0x7F);
+    cc(ch, 100, rpn & 0x7F);
+    cc(ch, 6, msb);
+    cc(ch, 38, lsb);
+}
+
+void MPE_Processor::configure() {
+    // MCM with no members on the other manager channel, disables the other zone,
+    // sent first so it cannot shrink this zone
+    unsigned other = zone_ == Z_LOWER ? 15 : 0;
+    cc(other, 101, 0);
+    cc(other, 100, 6);
+    cc(other, 6, 0);
+    cc(other, 101, 127);
+    cc(other, 100, 127);
+    // MCM, sets the zone
+    unsigned mgr = managerChannel();
+    cc(mgr, 101, 0);
+    cc(mgr, 100, 6);
+    cc(mgr, 6, members_);
+    // pitchbend range on every member, for synths which do not apply it zone wide
+    unsigned semis = static_cast<unsigned>(pitchbendRange_);
+    unsigned cents = static_cast<unsigned>((pitchbendRange_ - semis) * 100.0f + 0.5f);
+    for (unsigned i = 0; i < members_; i++) {
+        unsigned ch = memberChannel(i);
+        rpn(ch, 0, semis & 0x7F, cents & 0x7F);
+        // null rpn, so later data entry is not misread
+        cc(ch, 101, 127);
+        cc(ch, 100, 127);
+    }
+    cc(mgr, 101, 127);
+    cc(mgr, 100, 127);
+}
+
+int MPE_Processor::allocateChannel() {
+    int best = -1;
+    for (unsigned i = 0; i < members_; i++) {
+        unsigned ch = memberChannel(i);
+        if (channels_[ch].active_) continue;
+        if (best < 0 || channels_[ch].released_ < channels_[best].released_) best = ch;
+    }
+    return best;
+}
+
 /////////////////////////
 // ICallback interface
+// device touches, ignored when musical touches are played instead
 void MPE_Processor::touchOn(int id, float note, float x, float y, float z) {
+    if (touchInput_) voiceOn(id, note, x, y, z);
+}
 
-    VoiceData& voice = voices_[id];
+void MPE_Processor::touchContinue(int id, float note, float x, float y, float z) {
+    if (touchInput_) voiceContinue(id, note, x, y, z);
+}
 
-    unsigned ch = id + 1; // MPE starts on 2
+void MPE_Processor::touchOff(int id, float note, float x, float y, float z) {
+    if (touchInput_) voiceOff(id, note, x, y, z);
+}
+
+void MPE_Processor::setTouchInput(bool enable) {
+    touchInput_ = enable;
+}
+
+// touches, from device or musical input
+void MPE_Processor::voiceOn(int id, float note, float x, float y, float z) {
+    if (id < 0 || id >= static_cast<int>(MAX_TOUCHES)) return;
+
+    VoiceData& voice = voices_[id];
+    if (voice.channel_ >= 0) voiceOff(id, note, x, y, 0.0f); // missed release
+    // all channels in use, touch is dropped
+    int c = allocateChannel();
+    if (c < 0) return;
+    voice.channel_ = c;
+    channels_[c].active_ = true;
+
+    unsigned ch = c;
     voice.startNote_ = (note + 0.4999999) ; //int
 
     float semis = note - float(voice.startNote_);
@@ -48,12 +136,16 @@ void MPE_Processor::touchOn(int id, float note, float x, float y, float z) {
     // start with zero z, as we use intial z of velocity
     pressure(ch, 0.0f);
     voice.pressure_ = 0.0f;
+
+    governor_.noteOn(ch, pb, my, 0, microtime());
 }
 
-void MPE_Processor::touchContinue(int id, float note, float x, float y, float z) {
+void MPE_Processor::voiceContinue(int id, float note, float x, float y, float z) {
+    if (id < 0 || id >= static_cast<int>(MAX_TOUCHES)) return;
 
     VoiceData& voice = voices_[id];
-    unsigned ch = id + 1; // MPE starts on 2
+    if (voice.channel_ < 0) return;
+    unsigned ch = voice.channel_;
     // unsigned mx = bipolar14bit(x);
     int my = bipolar7bit(y);
     unsigned mz = unipolar7bit(z);
@@ -70,29 +162,42 @@ void MPE_Processor::touchContinue(int id, float note, float x, float y, float z)
 
     voice.note_ = note;
 
-    if (voice.pitchbend_ != pb) {
+    // pitch first, governor may hold back timbre/pressure to leave room for pitch
+    unsigned long long t = microtime();
+    if (governor_.send(ch, MidiGovernor::P_PITCH, pb, t)) {
         voice.pitchbend_ = pb;
         pitchbend(ch, pb) ;
     }
-    if (voice.timbre_ != my) {
+    if (governor_.send(ch, MidiGovernor::P_TIMBRE, my, t)) {
         voice.timbre_ = my;
         cc(ch, TIMBRE_CC, my);
     }
-    if (voice.pressure_ != mz) {
+    if (governor_.send(ch, MidiGovernor::P_PRESSURE, mz, t)) {
         voice.pressure_ = mz;
         pressure(ch, mz);
     }
 }
 
-void MPE_Processor::touchOff(int id, float note, float x, float y, float z) {
+void MPE_Processor::voiceOff(int id, float note, float x, float y, float z) {
+    if (id < 0 || id >= static_cast<int>(MAX_TOUCHES)) return;
 
     VoiceData& voice = voices_[id];
-
-    unsigned ch = id + 1; // MPE starts on 2
+    if (voice.channel_ < 0) return;
+    unsigned ch = voice.channel_;
     unsigned vel = 0.0f; // last vel = release velocity
+
+    // final pitch/timbre, if held back by the governor
+    int v;
+    if (governor_.final(ch, MidiGovernor::P_PITCH, v)) pitchbend(ch, v);
+    if (governor_.final(ch, MidiGovernor::P_TIMBRE, v)) cc(ch, TIMBRE_CC, v);
+    governor_.final(ch, MidiGovernor::P_PRESSURE, v);
     pressure(ch, 0.0f);
     noteOff(ch, voice.startNote_ , vel);
 
+    channels_[ch].active_ = false;
+    channels_[ch].released_ = ++releases_;
+
+    voice.channel_ = -1;
     voice.startNote_ = 0;
     voice.note_ = 0.0f;
     voice.pitchbend_ = 0.0f;
@@ -100,18 +205,49 @@ void MPE_Processor::touchOff(int id, float note, float x, float y, float z) {
     voice.pressure_ = 0.0f;//
 }
 
-void MPE_Processor::control(int attr, float v) {
+void MPE_Processor::mec_control(int cmd, void* other) {
+    // ignored
+    ;
+}
 
-    if (global_[attr] != v ) {
-        global_[attr] = v;
-        cc(0, attr, unipolar7bit(v));
-        // cc(ch, attr, isBipolar ? bipolar7bit(v) : unipolar7bit(v));
+void MPE_Processor::flush() {
+    // values held back by the rate limit
+    unsigned long long t = microtime();
+    int v;
+    for (unsigned id = 0; id < MAX_TOUCHES; id++) {
+        VoiceData& voice = voices_[id];
+        if (voice.channel_ < 0) continue;
+        unsigned ch = voice.channel_;
+        if (governor_.pending(ch, MidiGovernor::P_PITCH, t, v)) {
+            voice.pitchbend_ = v;
+            pitchbend(ch, v);
+        }
+        if (governor_.pending(ch, MidiGovernor::P_TIMBRE, t, v)) {
+            voice.timbre_ = v;
+            cc(ch, TIMBRE_CC, v);
+        }
+        if (governor_.pending(ch, MidiGovernor::P_PRESSURE, t, v)) {
+            voice.pressure_ = v;
+            pressure(ch, v);
+        }
     }
+    Midi_Processor::flush();
 }
 
-void MPE_Processor::mec_control(int cmd, void* other) {
-    // ignored
-    ;
+/////////////////////////
+// MPE_MusicalInput
+// note_ is already tuned, so fractional pitch goes straight to pitchbend
+// x/y are surface positions, so are made relative to the key
+void MPE_MusicalInput::touchOn(const MusicalTouch& t) {
+    processor_.voiceOn(t.id_, t.note_, t.keyX(), t.keyY(), t.z_);
+}
+
+void MPE_MusicalInput::touchContinue(const MusicalTouch& t) {
+    processor_.voiceContinue(t.id_, t.note_, t.keyX(), t.keyY(), t.z_);
+}
+
+void MPE_MusicalInput::touchOff(const MusicalTouch& t) {
+    processor_.voiceOff(t.id_, t.note_, t.keyX(), t.keyY(), t.z_);
 }
 
 
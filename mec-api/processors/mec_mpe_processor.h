@@ -5,27 +5,56 @@
 
 #include "../mec_api.h"
 #include "mec_midi_processor.h"
+#include "mec_midi_governor.h"
 #include <list>
 
 namespace mec {
 
+// mpe zones, lower zone has manager channel 1 and members from 2 up,
+// upper zone has manager channel 16 and members from 15 down.
+// each touch gets its own member channel, the least recently released, so release tails are not retriggered.
+// configure() sends the MPE configuration message (RPN 6) and pitchbend range (RPN 0),
+// it should be called when the output is (re)connected
 class MPE_Processor : public Midi_Processor {
 public:
+    enum Zone {
+        Z_LOWER,
+        Z_UPPER
+    };
+
+    static const unsigned MAX_TOUCHES = 64;
+    static const unsigned MAX_CHANNELS = 15; // member channels
+
     MPE_Processor(float pbr = 48.0);
     virtual ~MPE_Processor();
 
+    // members clamped to 1-15, pitchbend range is for member channels, manager is left at 2 semitones
+    void setZone(Zone zone, unsigned members = MAX_CHANNELS);
+    void configure();
+
     virtual void  process(MidiMsg& msg) = 0;
 
     // ICallback handling
     virtual void touchOn(int touchId, float note, float x, float y, float z);
     virtual void touchContinue(int touchId, float note, float x, float y, float z);
     virtual void touchOff(int touchId, float note, float x, float y, float z);
-    virtual void control(int ctrlId, float v);
     virtual void mec_control(int cmd, void* other); //ignores
+    virtual void flush();
 
-private:
+    // false ignores device touches, when musical touches (MPE_MusicalInput) are played instead
+    // controls are still handled
+    void setTouchInput(bool enable);
 
+    // limits continuous output, see mec_midi_governor.h
+    MidiGovernor &governor() { return governor_; }
+
+    unsigned managerChannel() const { return zone_ == Z_LOWER ? 0 : 15; }
+    unsigned memberChannel(unsigned i) const { return zone_ == Z_LOWER ? 1 + i : 14 - i; }
+    unsigned members() const { return members_; }
+
+private:
     struct VoiceData {
+        int         channel_;   // -1 not playing
         unsigned    startNote_;
         unsigned    note_;      //0
         int         pitchbend_; //1
@@ -33,7 +62,42 @@ private:
         unsigned    pressure_;  //3
     };
 
-    VoiceData voices_[16];
+    struct ChannelData {
+        bool        active_;
+        unsigned long long released_; // release order, for lru
+    };
+
+    friend class MPE_MusicalInput;
+
+    void voiceOn(int touchId, float note, float x, float y, float z);
+    void voiceContinue(int touchId, float note, float x, float y, float z);
+    void voiceOff(int touchId, float note, float x, float y, float z);
+    void rpn(unsigned ch, unsigned rpn, unsigned msb, unsigned lsb);
+    int allocateChannel();
+
+    Zone zone_;
+    unsigned members_;
+    unsigned long long releases_;
+    bool touchInput_;
+    VoiceData voices_[MAX_TOUCHES];
+    ChannelData channels_[16];
+    MidiGovernor governor_;
+};
+
+// musical touches in to an MPE_Processor, where note_ is the (tuned) pitch from the scaler, touch id is the voice
+// subscribed as IMusicalCallback, the processor is subscribed as ICallback too, which carries controls and flush,
+// with setTouchInput(false), so device touches are not played as well.
+// kept apart from the processor, so subscribe(processor) is not ambiguous
+class MPE_MusicalInput : public IMusicalCallback {
+public:
+    MPE_MusicalInput(MPE_Processor &processor) : processor_(processor) { ; }
+
+    virtual void touchOn(const MusicalTouch&);
+    virtual void touchContinue(const MusicalTouch&);
+    virtual void touchOff(const MusicalTouch&);
+
+private:
+    MPE_Processor &processor_;
 };
 
 }
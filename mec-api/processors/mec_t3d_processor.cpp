@@ -0,0 +1,83 @@
+#include "mec_t3d_processor.h"
+
+#include "../mec_stats.h"
+
+#include <stdio.h>
+
+namespace mec {
+
+// largest message, address + type tags + 4 args
+static const unsigned MAX_MESSAGE_SIZE = 64;
+
+T3D_Processor::T3D_Processor() : frame_(0), open_(false), stream_(buffer_, BUFFER_SIZE) {
+    for (unsigned i = 0; i < MAX_TOUCHES; i++) {
+        snprintf(addresses_[i], ADDRESS_SIZE, "/t3d/tch%u", i);
+    }
+}
+
+T3D_Processor::~T3D_Processor() {
+    ;
+}
+
+/////////////////////////
+// ICallback interface
+void T3D_Processor::touchOn(int id, float note, float x, float y, float z) {
+    touch(id, note, x, y, z);
+}
+
+void T3D_Processor::touchContinue(int id, float note, float x, float y, float z) {
+    touch(id, note, x, y, z);
+}
+
+void T3D_Processor::touchOff(int id, float note, float x, float y, float z) {
+    touch(id, note, x, y, 0.0f);
+}
+
+void T3D_Processor::control(int id, float v) {
+    reserve(MAX_MESSAGE_SIZE);
+    stream_ << osc::BeginMessage("/t3d/control") << static_cast<osc::int32>(id) << v << osc::EndMessage;
+}
+
+void T3D_Processor::mec_control(int cmd, void* other) {
+    // ignored
+    ;
+}
+
+void T3D_Processor::touch(int id, float note, float x, float y, float z) {
+    if (id < 0) return;
+    reserve(MAX_MESSAGE_SIZE);
+    if (id < static_cast<int>(MAX_TOUCHES)) {
+        stream_ << osc::BeginMessage(addresses_[id]);
+    } else {
+        char address[ADDRESS_SIZE];
+        snprintf(address, ADDRESS_SIZE, "/t3d/tch%d", id);
+        stream_ << osc::BeginMessage(address);
+    }
+    stream_ << x << y << z << note << osc::EndMessage;
+}
+
+void T3D_Processor::reserve(unsigned size) {
+    if (open_ && stream_.Capacity() - stream_.Size() < size + 8) flush();
+    if (open_) return;
+
+    // very large frames are split, each bundle is a frame
+    stream_.Clear();
+    stream_ << osc::BeginBundleImmediate
+            << osc::BeginMessage("/t3d/frm")
+            << static_cast<osc::int32>(frame_)
+            << static_cast<osc::int32>(microtime() / 1000)
+            << osc::EndMessage;
+    open_ = true;
+}
+
+void T3D_Processor::flush() {
+    if (!open_) return;
+    stream_ << osc::EndBundle;
+    MEC_STAT_START(st);
+    process(stream_.Data(), static_cast<unsigned>(stream_.Size()));
+    MEC_STAT_SINCE(Stats::S_PROCESSOR, st);
+    open_ = false;
+    frame_++;
+}
+
+}
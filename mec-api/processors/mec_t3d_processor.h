@@ -0,0 +1,53 @@
+#pragma once
+//////////////
+// this class can be used to process incoming callbacks and convert into T3D osc
+// define the process method to determine what to do with the packet (e.g. send to one or more hosts)
+//
+// all touches in a dispatch cycle are written into one bundle, led by /t3d/frm (frame, time mS),
+// which is passed to process() on flush (or when the buffer is full).
+// touches are /t3d/tchN x y z note, touch off is sent with z = 0, controls are /t3d/control id v
+// addresses are formatted once per touch id, so encoding does not allocate
+
+#include "../mec_api.h"
+
+#include <osc/OscOutboundPacketStream.h>
+
+namespace mec {
+
+class T3D_Processor : public ICallback {
+public:
+    static const unsigned BUFFER_SIZE = 4096;
+    static const unsigned MAX_TOUCHES = 64; // cached addresses, others are formatted as needed
+
+    T3D_Processor();
+    virtual ~T3D_Processor();
+
+    virtual void process(const char *data, unsigned size) = 0;
+
+    // ICallback handling
+    virtual void touchOn(int touchId, float note, float x, float y, float z);
+    virtual void touchContinue(int touchId, float note, float x, float y, float z);
+    virtual void touchOff(int touchId, float note, float x, float y, float z);
+    virtual void control(int ctrlId, float v);
+    virtual void mec_control(int cmd, void* other); //ignores
+    virtual void flush();
+
+    unsigned frame() const { return frame_; }
+
+protected:
+    void touch(int touchId, float note, float x, float y, float z);
+    // starts the bundle, or a new one if there is no room for size bytes
+    void reserve(unsigned size);
+
+private:
+    // "/t3d/tch" + any non negative int (10 digits) + null
+    static const unsigned ADDRESS_SIZE = 20;
+
+    char addresses_[MAX_TOUCHES][ADDRESS_SIZE];
+    unsigned frame_;
+    bool open_;
+    char buffer_[BUFFER_SIZE];
+    osc::OutboundPacketStream stream_;
+};
+
+}
@@ -0,0 +1,195 @@
+#include "mec_ump_processor.h"
+
+#include "../mec_stats.h"
+
+namespace mec {
+
+// midi 2.0 channel voice status
+enum {
+    UMP_RPNC = 0x0,
+    UMP_NOTE_OFF = 0x8,
+    UMP_NOTE_ON = 0x9,
+    UMP_POLY_PRESSURE = 0xA,
+    UMP_CC = 0xB
+};
+
+// note on attribute type
+static const unsigned ATTR_PITCH79 = 0x03;
+
+UMP_Processor::UMP_Processor(unsigned group) : group_(group), nextChannel_(0), touchInput_(true), used_(0) {
+    for (unsigned i = 0; i < MAX_TOUCHES; i++) {
+        touches_[i].channel_ = -1;
+    }
+    for (unsigned ch = 0; ch < MAX_CHANNELS; ch++) {
+        channelUsed_[ch] = 0;
+        for (unsigned n = 0; n < 128; n++) {
+            owner_[ch][n] = -1;
+        }
+    }
+    for (unsigned i = 0; i < 128; i++) {
+        global_[i] = -1.0f;
+    }
+}
+
+UMP_Processor::~UMP_Processor() {
+    ;
+}
+
+// least used channel without the note sounding, searched round robin, -1 if none
+int UMP_Processor::allocateChannel(unsigned note) {
+    int best = -1;
+    for (unsigned i = 0; i < MAX_CHANNELS; i++) {
+        unsigned ch = (nextChannel_ + i) % MAX_CHANNELS;
+        if (owner_[ch][note] >= 0) continue;
+        if (best < 0 || channelUsed_[ch] < channelUsed_[best]) best = ch;
+    }
+    if (best >= 0) nextChannel_ = (static_cast<unsigned>(best) + 1) % MAX_CHANNELS;
+    return best;
+}
+
+/////////////////////////
+// ICallback interface
+// device touches, ignored when musical touches are played instead
+void UMP_Processor::touchOn(int id, float note, float x, float y, float z) {
+    if (touchInput_) voiceOn(id, note, x, y, z);
+}
+
+void UMP_Processor::touchContinue(int id, float note, float x, float y, float z) {
+    if (touchInput_) voiceContinue(id, note, x, y, z);
+}
+
+void UMP_Processor::touchOff(int id, float note, float x, float y, float z) {
+    if (touchInput_) voiceOff(id, note, x, y, z);
+}
+
+void UMP_Processor::setTouchInput(bool enable) {
+    touchInput_ = enable;
+}
+
+// touches, from device or musical input
+void UMP_Processor::voiceOn(int id, float note, float x, float y, float z) {
+    if (id < 0 || id >= static_cast<int>(MAX_TOUCHES)) return;
+    TouchData &touch = touches_[id];
+    if (touch.channel_ >= 0) voiceOff(id, note, x, y, 0.0f); // missed release
+
+    unsigned n = static_cast<unsigned>(note + 0.4999999f) & 0x7F;
+    // note sounding on all channels, touch is dropped
+    int c = allocateChannel(n);
+    if (c < 0) return;
+
+    unsigned ch = static_cast<unsigned>(c);
+    owner_[ch][n] = id;
+    channelUsed_[ch]++;
+    touch.channel_ = c;
+    touch.note_ = n;
+    touch.pitch_ = pitch725(note);
+    touch.timbre_ = bipolar32(y);
+    touch.pressure_ = 0;
+
+    // timbre before note on, so the note starts with it, z is velocity
+    perNote(ch, touch.note_, RPNC_TIMBRE, touch.timbre_);
+    noteOn(ch, touch.note_, z, note);
+}
+
+void UMP_Processor::voiceContinue(int id, float note, float x, float y, float z) {
+    if (id < 0 || id >= static_cast<int>(MAX_TOUCHES)) return;
+    TouchData &touch = touches_[id];
+    if (touch.channel_ < 0) return;
+
+    unsigned ch = static_cast<unsigned>(touch.channel_);
+    uint32_t pitch = pitch725(note);
+    uint32_t timbre = bipolar32(y);
+    uint32_t pressure = unipolar32(z);
+    if (touch.pitch_ != pitch) {
+        touch.pitch_ = pitch;
+        perNote(ch, touch.note_, RPNC_PITCH, pitch);
+    }
+    if (touch.timbre_ != timbre) {
+        touch.timbre_ = timbre;
+        perNote(ch, touch.note_, RPNC_TIMBRE, timbre);
+    }
+    if (touch.pressure_ != pressure) {
+        touch.pressure_ = pressure;
+        polyPressure(ch, touch.note_, pressure);
+    }
+}
+
+void UMP_Processor::voiceOff(int id, float note, float x, float y, float z) {
+    if (id < 0 || id >= static_cast<int>(MAX_TOUCHES)) return;
+    TouchData &touch = touches_[id];
+    if (touch.channel_ < 0) return;
+
+    unsigned ch = static_cast<unsigned>(touch.channel_);
+    polyPressure(ch, touch.note_, 0);
+    noteOff(ch, touch.note_, 0.0f);
+    owner_[ch][touch.note_] = -1;
+    channelUsed_[ch]--;
+    touch.channel_ = -1;
+}
+
+void UMP_Processor::control(int attr, float v) {
+    if (attr < 0 || attr > 127) return;
+    if (global_[attr] != v) {
+        global_[attr] = v;
+        cc(0, static_cast<unsigned>(attr), unipolar32(v));
+    }
+}
+
+void UMP_Processor::mec_control(int cmd, void* other) {
+    // ignored
+    ;
+}
+
+/////////////////////////
+// UMP_MusicalInput
+void UMP_MusicalInput::touchOn(const MusicalTouch& t) {
+    processor_.voiceOn(t.id_, t.note_, t.keyX(), t.keyY(), t.z_);
+}
+
+void UMP_MusicalInput::touchContinue(const MusicalTouch& t) {
+    processor_.voiceContinue(t.id_, t.note_, t.keyX(), t.keyY(), t.z_);
+}
+
+void UMP_MusicalInput::touchOff(const MusicalTouch& t) {
+    processor_.voiceOff(t.id_, t.note_, t.keyX(), t.keyY(), t.z_);
+}
+
+/////////////////////////
+// output
+void UMP_Processor::noteOn(unsigned ch, unsigned note, float velocity, float pitch) {
+    output(header(group_, UMP_NOTE_ON, ch, note, ATTR_PITCH79),
+           (static_cast<uint32_t>(unipolar16(velocity)) << 16) | pitch79(pitch));
+}
+
+void UMP_Processor::noteOff(unsigned ch, unsigned note, float velocity) {
+    output(header(group_, UMP_NOTE_OFF, ch, note, 0),
+           static_cast<uint32_t>(unipolar16(velocity)) << 16);
+}
+
+void UMP_Processor::perNote(unsigned ch, unsigned note, unsigned index, uint32_t v) {
+    output(header(group_, UMP_RPNC, ch, note, index), v);
+}
+
+void UMP_Processor::polyPressure(unsigned ch, unsigned note, uint32_t v) {
+    output(header(group_, UMP_POLY_PRESSURE, ch, note, 0), v);
+}
+
+void UMP_Processor::cc(unsigned ch, unsigned cc, uint32_t v) {
+    output(header(group_, UMP_CC, ch, cc, 0), v);
+}
+
+void UMP_Processor::output(uint32_t w0, uint32_t w1) {
+    if (used_ + 2 > BUFFER_WORDS) flush();
+    words_[used_++] = w0;
+    words_[used_++] = w1;
+}
+
+void UMP_Processor::flush() {
+    if (used_ == 0) return;
+    MEC_STAT_START(st);
+    process(words_, used_);
+    MEC_STAT_SINCE(Stats::S_PROCESSOR, st);
+    used_ = 0;
+}
+
+}
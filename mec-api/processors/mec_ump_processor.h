@@ -0,0 +1,128 @@
+#pragma once
+//////////////
+// this class can be used to process incoming callbacks and convert into MIDI 2.0 Universal MIDI Packets
+// define the process method to determine what to do with the packets
+//
+// touches become per-note messages (MIDI 2.0 channel voice, 64 bit), at full resolution:
+// note on/off with 16 bit velocity and pitch 7.9 attribute
+// pitch  : registered per-note controller 3 (pitch 7.25), absolute so no pitchbend range needed
+// timbre : registered per-note controller 74 (32 bit)
+// pressure : poly pressure (32 bit)
+// state is kept per touch id, each touch is allocated a (channel, note) pair, so touches on the same note do not collide.
+// the least used channel is preferred, so touches are spread over channels.
+// if all 16 channels already have the note sounding, the touch is dropped, as are touch ids >= MAX_TOUCHES.
+// packets are written to a word buffer, passed to process() once per dispatch cycle (flush), or when full
+
+#include "../mec_api.h"
+
+#include <stdint.h>
+
+namespace mec {
+
+class UMP_Processor : public ICallback {
+public:
+    static const unsigned BUFFER_WORDS = 512;
+    static const unsigned MAX_TOUCHES = 64;
+    static const unsigned MAX_CHANNELS = 16;
+
+    enum {
+        RPNC_PITCH = 3,
+        RPNC_TIMBRE = 74
+    };
+
+    UMP_Processor(unsigned group = 0);
+    virtual ~UMP_Processor();
+
+    // count is in 32 bit words, always a multiple of 2
+    virtual void process(const uint32_t *words, unsigned count) = 0;
+
+    // ICallback handling
+    virtual void touchOn(int touchId, float note, float x, float y, float z);
+    virtual void touchContinue(int touchId, float note, float x, float y, float z);
+    virtual void touchOff(int touchId, float note, float x, float y, float z);
+    virtual void control(int ctrlId, float v);
+    virtual void mec_control(int cmd, void* other); //ignores
+    virtual void flush();
+
+    // false ignores device touches, when musical touches (UMP_MusicalInput) are played instead
+    void setTouchInput(bool enable);
+
+    // packet building, word 0 = type/group/status/channel/index, word 1 = data
+    static uint32_t header(unsigned group, unsigned status, unsigned ch, unsigned b1, unsigned b2) {
+        return (0x4u << 28) | ((group & 0xF) << 24) | ((status & 0xF) << 20) | ((ch & 0xF) << 16)
+               | ((b1 & 0x7F) << 8) | (b2 & 0xFF);
+    }
+
+    static uint32_t unipolar32(float v) {
+        double d = v < 0.0f ? 0.0 : (v > 1.0f ? 1.0 : (double) v);
+        return static_cast<uint32_t>(d * 4294967295.0);
+    }
+
+    static uint32_t bipolar32(float v) {
+        return unipolar32((v + 1.0f) * 0.5f);
+    }
+
+    static uint16_t unipolar16(float v) {
+        return static_cast<uint16_t>(unipolar32(v) >> 16);
+    }
+
+    // 7 bit note, 25 bit fraction
+    static uint32_t pitch725(float note) {
+        double d = note < 0.0f ? 0.0 : (note >= 128.0f ? 127.9999999 : (double) note);
+        return static_cast<uint32_t>(d * 33554432.0);
+    }
+
+    // 7 bit note, 9 bit fraction
+    static uint16_t pitch79(float note) {
+        return static_cast<uint16_t>(pitch725(note) >> 16);
+    }
+
+protected:
+    void noteOn(unsigned ch, unsigned note, float velocity, float pitch);
+    void noteOff(unsigned ch, unsigned note, float velocity);
+    void perNote(unsigned ch, unsigned note, unsigned index, uint32_t v);
+    void polyPressure(unsigned ch, unsigned note, uint32_t v);
+    void cc(unsigned ch, unsigned cc, uint32_t v);
+
+private:
+    friend class UMP_MusicalInput;
+
+    void voiceOn(int touchId, float note, float x, float y, float z);
+    void voiceContinue(int touchId, float note, float x, float y, float z);
+    void voiceOff(int touchId, float note, float x, float y, float z);
+    void output(uint32_t w0, uint32_t w1);
+    int allocateChannel(unsigned note);
+
+    struct TouchData {
+        int         channel_;   // -1 not playing
+        unsigned    note_;
+        uint32_t    pitch_;
+        uint32_t    timbre_;
+        uint32_t    pressure_;
+    };
+
+    unsigned group_;
+    TouchData touches_[MAX_TOUCHES];
+    int owner_[MAX_CHANNELS][128];     // touch id playing the channel/note, -1 free
+    unsigned channelUsed_[MAX_CHANNELS]; // notes sounding on the channel
+    unsigned nextChannel_;
+    bool touchInput_;
+    float global_[128];
+    unsigned used_;
+    uint32_t words_[BUFFER_WORDS];
+};
+
+// musical touches in to a UMP_Processor, touch id is the voice, see MPE_MusicalInput
+class UMP_MusicalInput : public IMusicalCallback {
+public:
+    UMP_MusicalInput(UMP_Processor &processor) : processor_(processor) { ; }
+
+    virtual void touchOn(const MusicalTouch&);
+    virtual void touchContinue(const MusicalTouch&);
+    virtual void touchOff(const MusicalTouch&);
+
+private:
+    UMP_Processor &processor_;
+};
+
+}
@@ -0,0 +1,96 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <vector>
+
+#include <processors/mec_midi_processor.h>
+#include <processors/mec_midi_controls.h>
+#include <mec_prefs.h>
+#include <mec_log.h>
+
+class TestMidi : public mec::Midi_Processor {
+public:
+    void process(MidiMsg &msg) {
+        std::vector<unsigned char> m;
+        for (unsigned i = 0; i < msg.size; i++) m.push_back((unsigned char) msg.data[i]);
+        msgs_.push_back(m);
+    }
+
+    bool is(unsigned i, unsigned char s, unsigned char d1, unsigned char d2) const {
+        return i < msgs_.size() && msgs_[i].size() == 3
+               && msgs_[i][0] == s && msgs_[i][1] == d1 && msgs_[i][2] == d2;
+    }
+
+    std::vector<std::vector<unsigned char>> msgs_;
+};
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    // default, ids 0-127 as 7 bit cc, others ignored
+    {
+        TestMidi p;
+        p.control(7, 1.0f);
+        assert(p.msgs_.size() == 1 && p.is(0, 0xB0, 7, 127));
+        p.control(7, 1.0f); // no change
+        p.control(0x20 + 200, 1.0f);
+        p.control(-1, 1.0f);
+        p.control(100000, 1.0f);
+        assert(p.msgs_.size() == 1);
+    }
+
+    mec::Preferences prefs("../mec-api/tests/test.json");
+    assert(prefs.valid());
+    mec::Preferences controls(mec::Preferences(prefs.getSubTree("mec")).getSubTree("controls"));
+    assert(controls.valid());
+
+    TestMidi p;
+    assert(p.controls().load(controls));
+    // defaults are replaced
+    p.control(7, 1.0f);
+    assert(p.msgs_.empty());
+
+    // 14 bit cc, msb then lsb
+    p.control(16, 0.5f);
+    assert(p.msgs_.size() == 2);
+    assert(p.is(0, 0xB0, 1, 0x40) && p.is(1, 0xB0, 33, 0x00));
+    // deadband of 8 steps
+    p.control(16, 0.5f + 5.0f / 16383.0f);
+    assert(p.msgs_.size() == 2);
+    p.control(16, 0.5f + 20.0f / 16383.0f);
+    assert(p.msgs_.size() == 4);
+    // limits always sent
+    p.control(16, 1.0f - 3.0f / 16383.0f);
+    assert(p.msgs_.size() == 6);
+    p.control(16, 1.0f);
+    assert(p.msgs_.size() == 8 && p.is(6, 0xB0, 1, 127) && p.is(7, 0xB0, 33, 127));
+
+    // nrpn, param selected once
+    p.msgs_.clear();
+    p.control(32, 1.0f);
+    assert(p.msgs_.size() == 4);
+    assert(p.is(0, 0xB1, 99, 2) && p.is(1, 0xB1, 98, 300 & 0x7F));
+    assert(p.is(2, 0xB1, 6, 127) && p.is(3, 0xB1, 38, 127));
+    p.control(32, 0.0f);
+    assert(p.msgs_.size() == 6 && p.is(4, 0xB1, 6, 0));
+
+    // curve
+    p.msgs_.clear();
+    p.control(48, 0.5f);
+    assert(p.is(0, 0xB0, 2, 32));
+
+    // bipolar, hex id
+    p.control(0x11, 0.0f);
+    assert(p.is(1, 0xB0, 11, 64));
+
+    // invalid mappings
+    mec::MidiControls c;
+    assert(!c.set(mec::MidiControls::MAX_CONTROLS, mec::MidiControls::T_CC, 1));
+    assert(!c.set(1, mec::MidiControls::T_CC, 128));
+    assert(!c.set(1, mec::MidiControls::T_CC14, 32));
+    assert(c.set(1, mec::MidiControls::T_NRPN, 16383));
+    assert(c.control(300) == nullptr);
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <iostream>
+
+#include <mec_device.h>
+#include <mec_deviceworker.h>
+#include <mec_log.h>
+
+#include <chrono>
+#include <thread>
+
+// polled device, sends a few touches from process(), and surface touches if the callback takes them
+class TestDevice : public mec::Device {
+public:
+    TestDevice(mec::ICallback &cb) :
+            callback_(cb), surfaceCallback_(dynamic_cast<mec::ISurfaceCallback *>(&cb)), count_(0), active_(false) { ; }
+
+    bool init(void *) override {
+        active_ = true;
+        return true;
+    }
+
+    bool process() override {
+        if (count_ < 3) {
+            callback_.touchOn(count_, 60.0f, 0.0f, 0.0f, 0.5f);
+            if (surfaceCallback_) surfaceCallback_->touchOn(mec::Touch(count_, 7, 1.0f, 2.0f, 0.5f, 2.0f, 1.0f));
+            count_++;
+        }
+        return true;
+    }
+
+    void deinit() override { active_ = false; }
+
+    bool isActive() override { return active_; }
+
+private:
+    mec::ICallback &callback_;
+    mec::ISurfaceCallback *surfaceCallback_;
+    int count_;
+    bool active_;
+};
+
+static std::shared_ptr<mec::Device> createTestDevice(mec::ICallback &cb) {
+    return std::make_shared<TestDevice>(cb);
+}
+
+class CountingCallback : public mec::Callback {
+public:
+    CountingCallback() : on_(0) { ; }
+
+    void touchOn(int, float, float, float, float) override { on_++; }
+
+    int on_;
+};
+
+class CountingSurfaceCallback : public mec::ISurfaceCallback {
+public:
+    CountingSurfaceCallback() : on_(0) { ; }
+
+    void touchOn(const mec::Touch &t) override {
+        assert(t.surface_ == 7 && t.x_ == 1.0f && t.r_ == 2.0f);
+        on_++;
+    }
+
+    void touchContinue(const mec::Touch &) override { ; }
+
+    void touchOff(const mec::Touch &) override { ; }
+
+    int on_;
+};
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    // devices register themselves when mec-api is loaded
+    const mec::DeviceFactory::Entry *midi = mec::DeviceFactory::find("midi");
+    assert(midi != nullptr);
+    assert(midi->prefs_ == "midi");
+    assert(midi->usbVendor_ == 0);
+    assert(!midi->surfaceTouches_);
+    assert(mec::DeviceFactory::find("osct3d") != nullptr);
+    assert(mec::DeviceFactory::find("kontrol")->prefs_ == "Kontrol");
+    assert(mec::DeviceFactory::find("unknown") == nullptr);
+
+    // duplicate names are rejected
+    assert(!mec::DeviceFactory::add(*midi));
+
+    // creation order, kontrol before devices using its model
+    assert(midi->order_ == mec::DeviceFactory::O_DEFAULT);
+    assert(mec::DeviceFactory::find("kontrol")->order_ < midi->order_);
+
+#if !DISABLE_PUSH2
+    assert(mec::DeviceFactory::findUsb(0x2982, 0x1967) == mec::DeviceFactory::find("push2"));
+    assert(mec::DeviceFactory::find("push2")->order_ > mec::DeviceFactory::find("kontrol")->order_);
+#endif
+    assert(mec::DeviceFactory::findUsb(0x1234, 0x5678) == nullptr);
+
+    // worker runs the device on its own thread, touches are delivered by process()
+    // surface touches are queued too, and delivered to the surface callback
+    CountingCallback cb;
+    CountingSurfaceCallback scb;
+    mec::DeviceWorker worker("test", createTestDevice, cb, &scb);
+    assert(worker.init(nullptr));
+    assert(worker.isActive());
+    for (int i = 0; i < 1000 && (cb.on_ < 3 || scb.on_ < 3); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        worker.process();
+    }
+    assert(cb.on_ == 3);
+    assert(scb.on_ == 3);
+    worker.deinit();
+    assert(!worker.isActive());
+
+    LOG_0("test completed");
+    return 0;
+}
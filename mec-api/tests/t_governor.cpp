@@ -0,0 +1,95 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <vector>
+
+#include <processors/mec_midi_governor.h>
+#include <processors/mec_mpe_processor.h>
+#include <mec_log.h>
+
+using mec::MidiGovernor;
+
+class TestMpe : public mec::MPE_Processor {
+public:
+    void process(MidiMsg &msg) {
+        std::vector<unsigned char> m;
+        for (unsigned i = 0; i < msg.size; i++) m.push_back((unsigned char) msg.data[i]);
+        msgs_.push_back(m);
+    }
+
+    std::vector<std::vector<unsigned char>> msgs_;
+};
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    // defaults, every change is sent
+    {
+        MidiGovernor g;
+        g.noteOn(1, 0, 0, 0, 0);
+        assert(g.send(1, MidiGovernor::P_PITCH, 1, 0));
+        assert(!g.send(1, MidiGovernor::P_PITCH, 1, 0));
+        assert(g.send(1, MidiGovernor::P_PRESSURE, 10, 0));
+    }
+
+    // deadband, small changes are held until release
+    {
+        MidiGovernor g;
+        g.setDeadband(MidiGovernor::P_PITCH, 4);
+        g.noteOn(1, 100, 0, 0, 0);
+        assert(!g.send(1, MidiGovernor::P_PITCH, 103, 0));
+        assert(!g.send(1, MidiGovernor::P_PITCH, 97, 0));
+        assert(g.send(1, MidiGovernor::P_PITCH, 105, 0));
+        assert(!g.send(1, MidiGovernor::P_PITCH, 107, 0));
+        int v = 0;
+        assert(g.final(1, MidiGovernor::P_PITCH, v) && v == 107);
+        assert(!g.final(1, MidiGovernor::P_PITCH, v));
+    }
+
+    // rate limit, 1000 msgs/sec = 1 per ms, burst 2
+    {
+        MidiGovernor g;
+        g.setRate(1000, 2);
+        g.noteOn(1, 0, 0, 0, 0);
+        // pitch can use the reserve token, pressure can not
+        assert(g.send(1, MidiGovernor::P_PITCH, 1, 0));
+        assert(!g.send(1, MidiGovernor::P_PRESSURE, 1, 0));
+        assert(g.send(1, MidiGovernor::P_PITCH, 2, 0));
+        assert(!g.send(1, MidiGovernor::P_PITCH, 3, 0));
+
+        int v = 0;
+        // nothing refilled yet
+        assert(!g.pending(1, MidiGovernor::P_PITCH, 0, v));
+        // other channels are independent
+        g.noteOn(2, 0, 0, 0, 0);
+        assert(g.send(2, MidiGovernor::P_PITCH, 1, 0));
+        // 1ms later, a token
+        assert(g.pending(1, MidiGovernor::P_PITCH, 1000, v) && v == 3);
+        assert(!g.pending(1, MidiGovernor::P_PITCH, 1000, v));
+        // pressure needs two tokens (one reserved for pitch)
+        assert(!g.pending(1, MidiGovernor::P_PRESSURE, 2000, v));
+        assert(g.pending(1, MidiGovernor::P_PRESSURE, 3000, v) && v == 1);
+        assert(!g.final(1, MidiGovernor::P_PRESSURE, v));
+    }
+
+    // mpe, release always sends the final pitch
+    {
+        TestMpe p;
+        p.governor().setDeadband(MidiGovernor::P_PITCH, 1000);
+        p.touchOn(0, 60.0f, 0.0f, 0.0f, 0.5f);
+        p.flush();
+        size_t n = p.msgs_.size();
+        p.touchContinue(0, 60.1f, 0.0f, 0.0f, 0.0f);
+        p.flush();
+        assert(p.msgs_.size() == n);
+        p.touchOff(0, 60.1f, 0.0f, 0.0f, 0.0f);
+        p.flush();
+        // pitchbend, pressure, note off
+        assert(p.msgs_.size() == n + 3);
+        assert((p.msgs_[n][0] & 0xF0) == 0xE0);
+        assert((p.msgs_[n + 2][0] & 0xF0) == 0x80 || (p.msgs_[n + 2][0] & 0xF0) == 0x90);
+    }
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <mec_api.h>
+
+#include <cassert>
+
+#include <mec_keygeometry.h>
+#include <mec_surfacemapper.h>
+#include <mec_log.h>
+
+// checked at compile time
+static_assert(mec::keygeometry::TauKeys::KEYS == 84, "tau keys");
+static_assert(mec::keygeometry::TauKeys::position(32).row_ == 2, "tau key 32 row");
+static_assert(mec::keygeometry::TauKeys::position(32).column_ == 0, "tau key 32 column");
+static_assert(mec::keygeometry::AlphaKeys::KEYS == 120, "alpha keys");
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    assert(mec::KeyGeometry::find("squirrel") == nullptr);
+
+    const mec::KeyGeometry *pico = mec::KeyGeometry::find("pico");
+    assert(pico != nullptr);
+    assert(pico->keys() == 18 && pico->keys(1) == 4);
+    assert(pico->rows_ == 2 && pico->columns_ == 9);
+    assert(pico->position(0, 10)->row_ == 1 && pico->position(0, 10)->column_ == 1);
+    assert(pico->position(1, 3)->course_ == 1);
+    assert(pico->position(0, 18) == nullptr);
+
+    // uneven strings
+    const mec::KeyGeometry *tau = mec::KeyGeometry::find("tau");
+    assert(tau != nullptr);
+    assert(tau->rows_ == 5 && tau->columns_ == 20);
+    assert(tau->position(0, 15)->row_ == 0 && tau->position(0, 15)->column_ == 15);
+    assert(tau->position(0, 52)->row_ == 3 && tau->position(0, 52)->column_ == 0);
+    assert(tau->position(0, 83)->row_ == 4 && tau->position(0, 83)->column_ == 11);
+    assert(tau->position(1, 0) == nullptr);
+
+    const mec::KeyGeometry *alpha = mec::KeyGeometry::find("alpha");
+    assert(alpha->position(0, 119)->row_ == 4 && alpha->position(0, 119)->column_ == 23);
+    assert(alpha->keys(1) == 12);
+
+    const mec::KeyGeometry *sp = mec::KeyGeometry::find("soundplane");
+    assert(sp->keys() == 150 && sp->position(0, 31)->row_ == 1 && sp->position(0, 31)->column_ == 1);
+
+    // mapping, old style (keys in col)
+    mec::Preferences prefs("../mec-api/tests/test.json");
+    assert(prefs.valid());
+    mec::Preferences mapping(mec::Preferences(prefs.getSubTree("mec")).getSubTree("mapping"));
+    assert(mapping.valid());
+
+    mec::SurfaceMapper mapper;
+    assert(mapper.noteFromKey(10) == 10); // no mapping
+    mec::Preferences picomap(mapping.getSubTree("pico"));
+    mapper.load(picomap);
+    assert(mapper.noteFromKey(0) == 60);
+    assert(mapper.noteFromKey(10) == 70);
+
+    // geometry, tau strings a 4th apart
+    mec::SurfaceMapper taumapper;
+    taumapper.setGeometry(tau);
+    mec::Preferences taumap(mapping.getSubTree("tau"));
+    taumapper.load(taumap);
+    assert(taumapper.noteFromKey(0) == 40);
+    assert(taumapper.noteFromKey(15) == 55);
+    assert(taumapper.noteFromKey(16) == 45);
+    assert(taumapper.noteFromKey(52) == 55);
+    assert(taumapper.noteFromKey(71) == 74);
+    assert(taumapper.noteFromKey(200) == 200);
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <vector>
+
+#include <processors/mec_mpe_processor.h>
+#include <mec_log.h>
+
+// collects individual messages
+class TestMpe : public mec::MPE_Processor {
+public:
+    void process(MidiMsg &msg) {
+        std::vector<unsigned char> m;
+        for (unsigned i = 0; i < msg.size; i++) m.push_back((unsigned char) msg.data[i]);
+        msgs_.push_back(m);
+    }
+
+    std::vector<std::vector<unsigned char>> msgs_;
+};
+
+// collects raw batches
+class TestBatchMpe : public TestMpe {
+public:
+    void processBatch(const unsigned char *data, unsigned size) {
+        batches_.push_back(std::vector<unsigned char>(data, data + size));
+        TestMpe::processBatch(data, size);
+    }
+
+    std::vector<std::vector<unsigned char>> batches_;
+};
+
+static void play(mec::MPE_Processor &p) {
+    p.touchOn(0, 60.0f, 0.0f, 0.0f, 0.5f);
+    for (int i = 0; i < 10; i++) {
+        p.touchContinue(0, 60.0f + (i * 0.1f), 0.0f, 0.0f, 0.5f);
+    }
+    p.touchOn(1, 64.0f, 0.0f, 0.0f, 0.5f);
+    p.touchContinue(0, 62.0f, 0.0f, 0.0f, 0.5f);
+    p.touchContinue(1, 64.5f, 0.0f, 0.0f, 0.8f);
+    p.touchOff(0, 62.0f, 0.0f, 0.0f, 0.0f);
+    p.touchOff(1, 64.5f, 0.0f, 0.0f, 0.0f);
+}
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    assert(mec::Midi_Processor::dataLength(0x90) == 2);
+    assert(mec::Midi_Processor::dataLength(0xD3) == 1);
+    assert(mec::Midi_Processor::dataLength(0xC0) == 1);
+    assert(mec::Midi_Processor::dataLength(0xE1) == 2);
+
+    // unbuffered, sent immediately
+    TestMpe direct;
+    play(direct);
+    assert(direct.msgs_.size() > 0);
+    direct.flush();
+
+    // buffered, nothing until flush, then same messages
+    TestBatchMpe buffered;
+    buffered.setBuffered(true);
+    play(buffered);
+    assert(buffered.msgs_.empty());
+    assert(buffered.batches_.empty());
+    buffered.flush();
+    assert(buffered.batches_.size() == 1);
+    assert(buffered.msgs_ == direct.msgs_);
+
+    // the batch is the complete messages, as sent unbuffered
+    std::vector<unsigned char> joined;
+    for (const std::vector<unsigned char> &m : direct.msgs_) joined.insert(joined.end(), m.begin(), m.end());
+    assert(buffered.batches_[0] == joined);
+
+    // consecutive pitchbends on the same channel, each has status
+    buffered.batches_.clear();
+    buffered.msgs_.clear();
+    buffered.touchOn(2, 60.0f, 0.0f, 0.0f, 0.5f);
+    buffered.flush();
+    buffered.batches_.clear();
+    buffered.touchContinue(2, 60.2f, 0.0f, 0.0f, 0.0f);
+    buffered.touchContinue(2, 60.4f, 0.0f, 0.0f, 0.0f);
+    buffered.flush();
+    assert(buffered.batches_.size() == 1);
+    assert(buffered.batches_[0].size() == 6);
+    assert(buffered.batches_[0][0] == 0xE3);
+    assert(buffered.batches_[0][3] == 0xE3);
+
+    // flush with nothing buffered does nothing
+    buffered.batches_.clear();
+    buffered.flush();
+    assert(buffered.batches_.empty());
+
+    // a full buffer is flushed early
+    buffered.msgs_.clear();
+    for (int i = 0; i < 1000; i++) {
+        buffered.touchContinue(2, 60.0f + (i % 2) * 0.5f, 0.0f, 0.0f, 0.0f);
+    }
+    assert(buffered.batches_.size() >= 1);
+    buffered.flush();
+    assert(buffered.msgs_.size() == 1000);
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <vector>
+
+#include <processors/mec_mpe_processor.h>
+#include <mec_log.h>
+
+class TestMpe : public mec::MPE_Processor {
+public:
+    void process(MidiMsg &msg) {
+        std::vector<unsigned char> m;
+        for (unsigned i = 0; i < msg.size; i++) m.push_back((unsigned char) msg.data[i]);
+        msgs_.push_back(m);
+    }
+
+    // channel of last note on
+    int noteOnChannel() const {
+        for (auto i = msgs_.rbegin(); i != msgs_.rend(); i++) {
+            if (((*i)[0] & 0xF0) == 0x90 && (*i)[2] > 0) return (*i)[0] & 0x0F;
+        }
+        return -1;
+    }
+
+    bool hasCC(unsigned ch, unsigned cc, unsigned v) const {
+        for (auto i = msgs_.begin(); i != msgs_.end(); i++) {
+            if ((*i)[0] == (0xB0 | ch) && (*i)[1] == cc && (*i)[2] == v) return true;
+        }
+        return false;
+    }
+
+    std::vector<std::vector<unsigned char>> msgs_;
+};
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    // configuration, lower zone
+    {
+        TestMpe p;
+        p.setPitchbendRange(48.0f);
+        p.setZone(mec::MPE_Processor::Z_LOWER, 4);
+        p.configure();
+        // MCM with no members on the upper manager channel, then null rpn
+        assert(p.msgs_.size() >= 8);
+        assert(p.msgs_[0][0] == 0xBF && p.msgs_[0][1] == 101 && p.msgs_[0][2] == 0);
+        assert(p.msgs_[1][0] == 0xBF && p.msgs_[1][1] == 100 && p.msgs_[1][2] == 6);
+        assert(p.msgs_[2][0] == 0xBF && p.msgs_[2][1] == 6 && p.msgs_[2][2] == 0);
+        assert(p.msgs_[3][0] == 0xBF && p.msgs_[3][1] == 101 && p.msgs_[3][2] == 127);
+        assert(p.msgs_[4][0] == 0xBF && p.msgs_[4][1] == 100 && p.msgs_[4][2] == 127);
+        // MCM on manager channel
+        assert(p.msgs_[5][0] == 0xB0 && p.msgs_[5][1] == 101 && p.msgs_[5][2] == 0);
+        assert(p.msgs_[6][0] == 0xB0 && p.msgs_[6][1] == 100 && p.msgs_[6][2] == 6);
+        assert(p.msgs_[7][0] == 0xB0 && p.msgs_[7][1] == 6 && p.msgs_[7][2] == 4);
+        // pitchbend range on members 2-5
+        for (unsigned ch = 1; ch <= 4; ch++) assert(p.hasCC(ch, 6, 48));
+        assert(!p.hasCC(5, 6, 48));
+        // 4 rpns and null per member, plus both MCMs and nulls
+        assert(p.msgs_.size() == 5 + 3 + 4 * 6 + 2);
+    }
+
+    // configuration, upper zone
+    {
+        TestMpe p;
+        p.setPitchbendRange(24.5f);
+        p.setZone(mec::MPE_Processor::Z_UPPER, 2);
+        p.configure();
+        assert(p.msgs_[2][0] == 0xB0 && p.msgs_[2][1] == 6 && p.msgs_[2][2] == 0);
+        assert(p.msgs_[7][0] == 0xBF && p.msgs_[7][2] == 2);
+        assert(p.hasCC(14, 6, 24) && p.hasCC(14, 38, 50));
+        assert(p.hasCC(13, 6, 24));
+        assert(!p.hasCC(12, 6, 24));
+    }
+
+    // channel rotation, least recently released
+    {
+        TestMpe p;
+        p.setZone(mec::MPE_Processor::Z_LOWER, 3);
+        p.touchOn(0, 60.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.noteOnChannel() == 1);
+        p.touchOn(1, 62.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.noteOnChannel() == 2);
+        p.touchOff(0, 60.0f, 0.0f, 0.0f, 0.0f);
+        // channel 3 was never used, so before just released channel 1
+        p.touchOn(2, 64.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.noteOnChannel() == 3);
+        p.touchOn(0, 65.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.noteOnChannel() == 1);
+        // zone full, touch is dropped
+        size_t n = p.msgs_.size();
+        p.touchOn(3, 67.0f, 0.0f, 0.0f, 0.5f);
+        p.touchContinue(3, 67.0f, 0.0f, 0.5f, 0.5f);
+        p.touchOff(3, 67.0f, 0.0f, 0.0f, 0.0f);
+        assert(p.msgs_.size() == n);
+
+        p.touchOff(2, 64.0f, 0.0f, 0.0f, 0.0f);
+        p.touchOff(1, 62.0f, 0.0f, 0.0f, 0.0f);
+        // channel 3 released before 2
+        p.touchOn(3, 67.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.noteOnChannel() == 3);
+        // continue on the allocated channel
+        p.touchContinue(3, 67.0f, 0.0f, 0.0f, 0.8f);
+        assert(p.msgs_.back()[0] == 0xD3);
+        // out of range ids are ignored
+        n = p.msgs_.size();
+        p.touchOn(-1, 60.0f, 0.0f, 0.0f, 0.5f);
+        p.touchOn(mec::MPE_Processor::MAX_TOUCHES, 60.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.msgs_.size() == n);
+    }
+
+    // musical input, device touches ignored, controls still sent
+    {
+        TestMpe p;
+        mec::MPE_MusicalInput musical(p);
+        p.setTouchInput(false);
+        p.touchOn(0, 60.0f, 0.0f, 0.0f, 0.5f);
+        assert(p.msgs_.empty());
+        p.control(7, 1.0f);
+        assert(p.hasCC(0, 7, 127));
+        mec::MusicalTouch t(mec::Touch(0, 0, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f), 62.0f);
+        musical.touchOn(t);
+        assert(p.noteOnChannel() == 1);
+        p.touchOff(0, 62.0f, 0.0f, 0.0f, 0.0f);
+        size_t n = p.msgs_.size();
+        musical.touchOff(t);
+        assert(p.msgs_.size() > n);
+    }
+
+    // musical touch on a row > 0, timbre is relative to the key
+    {
+        TestMpe p;
+        mec::MPE_MusicalInput musical(p);
+        mec::MusicalTouch t(mec::Touch(0, 0, 3.0f, 5.25f, 0.5f, 5.0f, 3.0f), 64.0f);
+        musical.touchOn(t);
+        assert(p.hasCC(1, 74, 95));
+        // out of range values are clamped, data bytes never have the top bit set
+        p.touchContinue(0, 64.0f, 0.0f, 5.0f, 2.0f);
+        assert(p.hasCC(1, 74, 127));
+        for (auto i = p.msgs_.begin(); i != p.msgs_.end(); i++) {
+            for (size_t b = 1; b < i->size(); b++) assert(((*i)[b] & 0x80) == 0);
+        }
+    }
+
+    LOG_0("test completed");
+    return 0;
+}
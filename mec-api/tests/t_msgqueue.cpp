@@ -0,0 +1,199 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <iostream>
+
+#include <mec_msg_queue.h>
+#include <mec_log.h>
+
+static mec::MecMsg touchMsg(mec::MecMsg::type t, int id, float z) {
+    mec::MecMsg msg;
+    msg.type_ = t;
+    msg.data_.touch_.touchId_ = id;
+    msg.data_.touch_.note_ = 60.0f;
+    msg.data_.touch_.x_ = 0.0f;
+    msg.data_.touch_.y_ = 0.0f;
+    msg.data_.touch_.z_ = z;
+    msg.data_.touch_.t_ = 1000 + static_cast<unsigned long long>(z);
+    return msg;
+}
+
+class CountingCallback : public mec::Callback {
+public:
+    CountingCallback() : on_(0), continue_(0), off_(0), lastZ_(0.0f), lastT_(0), continueAfterOff_(false) { ; }
+
+    using mec::Callback::touchContinue;
+
+    void touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z) override {
+        lastT_ = t;
+        touchContinue(touchId, note, x, y, z);
+    }
+
+    void touchOn(int, float, float, float, float) override { on_++; }
+
+    void touchContinue(int touchId, float, float, float, float z) override {
+        continue_++;
+        lastZ_ = z;
+        if (off_ > 0) continueAfterOff_ = true;
+    }
+
+    void touchOff(int, float, float, float, float) override { off_++; }
+
+    int on_, continue_, off_;
+    float lastZ_;
+    unsigned long long lastT_;
+    bool continueAfterOff_;
+};
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    mec::MsgQueue queue(10);
+    assert(queue.capacity() == 16);
+    assert(queue.isEmpty());
+
+    mec::MecMsg msg;
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 1, 0.5f);
+    assert(queue.addToQueue(msg));
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 2, 0.5f);
+    assert(queue.addToQueue(msg));
+
+    // fill with continues, these stop short of capacity, and then coalesce
+    for (int i = 0; i < 100; i++) {
+        msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 1 + (i % 2), float(i));
+        assert(queue.addToQueue(msg));
+    }
+    assert(!queue.isFull());
+    int pending = queue.pending();
+    assert(pending == 12);
+
+    // offs must still get thru, and supersede held continues
+    msg = touchMsg(mec::MecMsg::TOUCH_OFF, 1, 0.0f);
+    assert(queue.addToQueue(msg));
+    assert(queue.pending() == pending + 1);
+
+    // consume, then next add flushes held continue for touch 2 before the new message
+    int n = 0;
+    bool off = false;
+    while (queue.nextMsg(msg)) {
+        n++;
+        if (msg.type_ == mec::MecMsg::TOUCH_OFF) off = true;
+    }
+    assert(n == pending + 1);
+    assert(off);
+    assert(queue.isEmpty());
+
+    msg = touchMsg(mec::MecMsg::TOUCH_OFF, 2, 0.0f);
+    assert(queue.addToQueue(msg));
+    assert(queue.nextMsg(msg) && msg.type_ == mec::MecMsg::TOUCH_OFF && msg.data_.touch_.touchId_ == 2);
+    assert(!queue.nextMsg(msg));
+
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 3, 0.5f);
+    assert(queue.addToQueue(msg));
+    for (int i = 0; i < 100; i++) {
+        msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 3, float(i));
+        assert(queue.addToQueue(msg));
+    }
+    while (queue.nextMsg(msg)) { ; }
+    // latest continue is held, and delivered once there is room
+    msg.type_ = mec::MecMsg::CONTROL;
+    msg.data_.control_.controlId_ = 1;
+    msg.data_.control_.value_ = 1.0f;
+    assert(queue.addToQueue(msg));
+    assert(queue.nextMsg(msg) && msg.type_ == mec::MecMsg::TOUCH_CONTINUE && msg.data_.touch_.z_ == 99.0f);
+    assert(queue.nextMsg(msg) && msg.type_ == mec::MecMsg::CONTROL);
+
+    // coalescing, one continue per touch per process, ordering of on/off kept
+    mec::MsgQueue cqueue(64);
+    cqueue.setCoalesce(true);
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 4, 0.5f);
+    assert(cqueue.addToQueue(msg));
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 5, 0.5f);
+    assert(cqueue.addToQueue(msg));
+    for (int i = 0; i < 20; i++) {
+        msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 4 + (i % 2), float(i));
+        assert(cqueue.addToQueue(msg));
+    }
+    msg = touchMsg(mec::MecMsg::TOUCH_OFF, 4, 0.0f);
+    assert(cqueue.addToQueue(msg));
+
+    CountingCallback cb;
+    cqueue.process(cb);
+    assert(cb.on_ == 2);
+    assert(cb.continue_ == 2);
+    assert(cb.off_ == 1);
+    assert(cb.lastZ_ == 19.0f);
+    assert(cb.lastT_ == 1019);
+    assert(cqueue.isEmpty());
+
+    CountingCallback cb2;
+    msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 5, 1.0f);
+    assert(cqueue.addToQueue(msg));
+    msg = touchMsg(mec::MecMsg::TOUCH_OFF, 5, 0.0f);
+    assert(cqueue.addToQueue(msg));
+    cqueue.process(cb2);
+    assert(cb2.continue_ == 1);
+    assert(cb2.off_ == 1);
+    assert(!cb2.continueAfterOff_);
+
+    // held continues stay with the producer, process() does not take them, a flush (from the producer) queues them
+    // touch ids beyond 64 are held too, when the queue is sized for them
+    mec::MsgQueue hqueue(16, 128);
+    assert(hqueue.touches() == 128);
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 100, 0.5f);
+    assert(hqueue.addToQueue(msg));
+    for (int i = 0; i < 100; i++) {
+        msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 100, float(i));
+        assert(hqueue.addToQueue(msg));
+    }
+    CountingCallback cb3;
+    hqueue.process(cb3);
+    assert(cb3.on_ == 1);
+    assert(cb3.lastZ_ == 10.0f);
+    assert(hqueue.isEmpty());
+    hqueue.flush();
+    CountingCallback cb4;
+    hqueue.process(cb4);
+    assert(cb4.continue_ == 1);
+    assert(cb4.lastZ_ == 99.0f);
+    assert(cb4.lastT_ == 1099);
+    assert(hqueue.isEmpty());
+    hqueue.flush();
+    CountingCallback cb6;
+    hqueue.process(cb6);
+    assert(cb6.continue_ == 0);
+
+    // an off supersedes the held continue, which is not delivered after it
+    for (int i = 0; i < 100; i++) {
+        msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 100, float(i));
+        assert(hqueue.addToQueue(msg));
+    }
+    msg = touchMsg(mec::MecMsg::TOUCH_OFF, 100, 0.0f);
+    assert(hqueue.addToQueue(msg));
+    CountingCallback cb5;
+    hqueue.process(cb5);
+    assert(cb5.off_ == 1);
+    assert(!cb5.continueAfterOff_);
+    assert(hqueue.isEmpty());
+
+    // ids outside the touches still fail when full
+    mec::MsgQueue squeue(16, 4);
+    for (int i = 0; i < 12; i++) {
+        msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 8, float(i));
+        assert(squeue.addToQueue(msg));
+    }
+    msg = touchMsg(mec::MecMsg::TOUCH_CONTINUE, 8, 1.0f);
+    assert(!squeue.addToQueue(msg));
+
+    // signal, wakes a waiting consumer when messages are added
+    mec::MsgSignal signal;
+    cqueue.setSignal(&signal);
+    assert(!signal.wait(std::chrono::microseconds(100)));
+    msg = touchMsg(mec::MecMsg::TOUCH_ON, 6, 0.5f);
+    assert(cqueue.addToQueue(msg));
+    assert(signal.wait(std::chrono::microseconds(100)));
+    assert(!signal.wait(std::chrono::microseconds(100)));
+
+    LOG_0("test completed");
+    return 0;
+}
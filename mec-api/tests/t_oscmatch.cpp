@@ -0,0 +1,50 @@
+#include <mec_api.h>
+
+#include <cassert>
+
+#include <mec_oscmatch.h>
+#include <mec_log.h>
+
+enum {
+    A_TOUCH,
+    A_FRM,
+    A_COMMAND,
+    A_ALIVE
+};
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    mec::OscAddressMatcher m;
+    assert(m.add("/t3d/tch", A_TOUCH, true));
+    assert(m.add("/t3d/frm", A_FRM));
+    assert(m.add("/t3d/command", A_COMMAND));
+    assert(m.add("/t3d/alive", A_ALIVE));
+    // duplicates
+    assert(!m.add("/t3d/frm", A_ALIVE));
+    assert(!m.add("/t3d/tch", A_ALIVE, true));
+    // same address can be exact and suffixed
+    assert(m.add("/t3d/tch", A_ALIVE));
+
+    unsigned idx = 99;
+    assert(m.match("/t3d/tch1", idx) == A_TOUCH && idx == 1);
+    assert(m.match("/t3d/tch12", idx) == A_TOUCH && idx == 12);
+    assert(m.match("/t3d/tch0", idx) == A_TOUCH && idx == 0);
+    assert(m.match("/t3d/tch", idx) == A_ALIVE && idx == 0);
+    assert(m.match("/t3d/frm", idx) == A_FRM);
+    assert(m.match("/t3d/command") == A_COMMAND);
+    assert(m.match("/t3d/alive") == A_ALIVE);
+
+    // no match
+    assert(m.match("/t3d/tch1x") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match("/t3d/tch12345678901") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match("/t3d/frm1") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match("/t3d/fr") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match("/t3d/commands") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match("/t3d/tch*") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match("") == mec::OscAddressMatcher::NO_MATCH);
+    assert(m.match(nullptr) == mec::OscAddressMatcher::NO_MATCH);
+
+    LOG_0("test completed");
+    return 0;
+}
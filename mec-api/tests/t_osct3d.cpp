@@ -0,0 +1,111 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <devices/mec_osct3d.h>
+#include <mec_stats.h>
+#include <mec_prefs.h>
+#include <mec_log.h>
+
+#include <osc/OscOutboundPacketStream.h>
+#include <ip/UdpSocket.h>
+
+class TouchCallback : public mec::Callback {
+public:
+    TouchCallback() : on_(0), continue_(0), off_(0) { ; }
+
+    void touchOn(int, float, float, float, float) override { on_++; }
+    void touchContinue(int, float, float, float, float) override { continue_++; }
+    void touchOff(int, float, float, float, float) override { off_++; }
+
+    int on_, continue_, off_;
+};
+
+static const int PORT = 9123;
+
+static void sendMessage(UdpTransmitSocket &s, osc::OutboundPacketStream &p, bool bundle) {
+    if (bundle) return;
+    s.Send(p.Data(), p.Size());
+    p.Clear();
+}
+
+// frame with given touches (z > 0), as a bundle or separate messages
+static void sendFrame(UdpTransmitSocket &s, int frame, int touches, bool bundle = true) {
+    char buffer[1024];
+    osc::OutboundPacketStream p(buffer, sizeof(buffer));
+    if (bundle) p << osc::BeginBundleImmediate;
+    p << osc::BeginMessage("/t3d/frm") << frame << 0 << osc::EndMessage;
+    sendMessage(s, p, bundle);
+    for (int i = 1; i <= touches; i++) {
+        char addr[16];
+        snprintf(addr, sizeof(addr), "/t3d/tch%d", i);
+        p << osc::BeginMessage(addr) << 0.5f << 0.5f << 0.5f << 60.0f << osc::EndMessage;
+        sendMessage(s, p, bundle);
+    }
+    if (bundle) {
+        p << osc::EndBundle;
+        s.Send(p.Data(), p.Size());
+    }
+}
+
+// process until condition, or timeout
+template<typename F>
+static bool waitFor(mec::OscT3D &dev, F cond, int ms = 1000) {
+    for (int i = 0; i < ms; i++) {
+        dev.process();
+        if (cond()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    mec::Preferences prefs("../mec-api/tests/test.json");
+    assert(prefs.valid());
+    mec::Preferences t3d(mec::Preferences(prefs.getSubTree("mec")).getSubTree("osct3d"));
+    assert(t3d.valid());
+
+    mec::Stats::reset();
+    TouchCallback cb;
+    mec::OscT3D dev(cb);
+    assert(dev.init(t3d.getTree()));
+
+    UdpTransmitSocket s(IpEndpointName("127.0.0.1", PORT));
+
+    // touches start with the frame
+    sendFrame(s, 1, 2);
+    assert(waitFor(dev, [&] { return cb.on_ == 2; }));
+    sendFrame(s, 2, 2);
+    assert(waitFor(dev, [&] { return cb.continue_ == 2; }));
+
+    // touch 2 missing, release lost, reaped after 2 frames
+    sendFrame(s, 3, 1);
+    sendFrame(s, 4, 1);
+    assert(waitFor(dev, [&] { return cb.off_ == 1; }));
+    assert(cb.continue_ == 4);
+    assert(mec::Stats::enabled() == false || mec::Stats::counter(mec::Stats::C_TOUCH_REAPED) == 1);
+
+    // frames 5-9 lost
+    sendFrame(s, 10, 1);
+    assert(waitFor(dev, [&] { return cb.continue_ == 5; }));
+    assert(mec::Stats::enabled() == false || mec::Stats::counter(mec::Stats::C_FRAME_DROPPED) == 5);
+
+    // unbundled, frame is applied when next starts
+    sendFrame(s, 11, 1, false);
+    sendFrame(s, 12, 1, false);
+    assert(waitFor(dev, [&] { return cb.continue_ == 6; }));
+
+    // sender stops, touch reaped after timeout, incl. the open frame
+    assert(waitFor(dev, [&] { return cb.off_ == 2; }));
+    assert(cb.continue_ == 7);
+
+    dev.deinit();
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include <iostream>
 
 #include <cassert>
+#include <atomic>
+#include <thread>
 #include <mec_scaler.h>
 #include <mec_log.h>
 
@@ -84,6 +86,67 @@ int main (int argc, char** argv) {
     assert(mt.note_ == 19.5f);
 
 
+    // batch mapping matches single touch mapping, incl. out of table columns
+    {
+        const unsigned N = 8;
+        float r[N] = {0.0f, 1.0f, 2.0f, 0.0f, 1.0f, 3.0f, 0.0f, 2.0f};
+        float c[N] = {0.0f, 8.5f, 3.25f, 255.9f, 256.0f, 300.5f, -1.0f, -8.5f};
+        float notes[N];
+        mec::Touch tin[N];
+        mec::MusicalTouch tout[N];
+        scaler.notes(r, c, notes, N);
+        for (unsigned i = 0; i < N; i++) {
+            tin[i].r_ = r[i];
+            tin[i].c_ = c[i];
+        }
+        scaler.map(tin, tout, N);
+        for (unsigned i = 0; i < N; i++) {
+            mt = scaler.map(tin[i]);
+            assert(notes[i] == mt.note_);
+            assert(tout[i].note_ == mt.note_);
+        }
+        // minor, one degree below tonic is -2 (10 - 12), plus column offset
+        t.r_ = 0;
+        t.c_ = -1.0f;
+        mt = scaler.map(t);
+        assert(mt.note_ == -1.0f);
+    }
+
+    // settings can change while another thread is mapping
+    {
+        std::atomic<bool> running(true);
+        std::atomic<unsigned> mapped(0);
+        std::thread reader([&] {
+            mec::Touch rt;
+            rt.r_ = 0.0f;
+            rt.c_ = 7.0f;
+            while (running) {
+                mec::MusicalTouch m = scaler.map(rt);
+                // always a complete table, octave of minor + column offset + tonic (0..11)
+                assert(m.note_ >= 13.0f && m.note_ <= 24.0f);
+                scaler.endCycle();
+                mapped++;
+            }
+        });
+        for (int i = 0; i < 1000; i++) {
+            scaler.setTonic((float) (i % 12));
+        }
+        while (mapped == 0) { ; }
+        running = false;
+        reader.join();
+        assert(scaler.getTonic() == 999 % 12);
+
+        // superseded tables are freed once a cycle has ended
+        scaler.endCycle();
+        scaler.setTonic(1.0f);
+        assert(scaler.retired() == 1);
+        for (int i = 0; i < 100; i++) {
+            scaler.setTonic((float) (i % 12));
+            scaler.endCycle();
+        }
+        assert(scaler.retired() <= 1);
+    }
+
     LOG_0("test completed");
     return 0;
 }
\ No newline at end of file
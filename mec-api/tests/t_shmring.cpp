@@ -0,0 +1,137 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+#include <mec_shmring.h>
+#include <mec_log.h>
+#include <mec_time.h>
+
+static const char *NAME = "/mec-test-touches";
+
+static mec::ShmTouch touch(unsigned type, int id, float v) {
+    mec::ShmTouch t;
+    t.time_ = mec::microtime();
+    t.type_ = type;
+    t.id_ = id;
+    t.note_ = v;
+    t.x_ = v;
+    t.y_ = v;
+    t.z_ = v;
+    return t;
+}
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    // no writer
+    {
+        mec::ShmRing reader;
+        assert(!reader.open("/mec-test-missing"));
+        assert(!reader.isOpen());
+        mec::ShmTouch t;
+        assert(!reader.read(t));
+        assert(!reader.wait(100));
+    }
+
+    // records in order, to each reader
+    {
+        mec::ShmRing writer;
+        assert(writer.create(NAME, 10));
+        assert(writer.capacity() == 16);
+
+        mec::ShmRing reader1, reader2;
+        assert(reader1.open(NAME));
+        assert(reader1.capacity() == 16);
+        mec::ShmTouch t;
+        assert(!reader1.read(t));
+
+        writer.write(touch(mec::ShmTouch::T_ON, 1, 60.0f));
+        writer.write(touch(mec::ShmTouch::T_CONTINUE, 1, 61.0f));
+        // readers start at the current position
+        assert(reader2.open(NAME));
+        writer.write(touch(mec::ShmTouch::T_OFF, 1, 62.0f));
+        writer.notify();
+
+        assert(reader1.read(t) && t.type_ == mec::ShmTouch::T_ON && t.id_ == 1 && t.note_ == 60.0f);
+        assert(reader1.read(t) && t.type_ == mec::ShmTouch::T_CONTINUE && t.note_ == 61.0f);
+        assert(reader1.read(t) && t.type_ == mec::ShmTouch::T_OFF && t.note_ == 62.0f);
+        assert(!reader1.read(t));
+        assert(reader2.read(t) && t.type_ == mec::ShmTouch::T_OFF);
+        assert(!reader2.read(t));
+        assert(reader1.dropped() == 0);
+
+        // overrun, reader skips to the oldest record the writer will not overwrite next
+        for (int i = 0; i < 40; i++) {
+            writer.write(touch(mec::ShmTouch::T_CONTINUE, 2, static_cast<float>(i)));
+        }
+        assert(reader1.read(t) && t.note_ == 25.0f);
+        assert(reader1.dropped() == 25);
+        int n = 1;
+        while (reader1.read(t)) n++;
+        assert(n == 15 && t.note_ == 39.0f);
+
+        // writer closing is seen by readers
+        assert(!reader1.closed());
+        writer.close();
+        assert(reader1.closed());
+        assert(!reader1.wait(1000));
+        assert(!reader2.open(NAME));
+    }
+
+    // writer restarts without closing (e.g. crashed), readers see the old region closed
+    {
+        mec::ShmRing *crashed = new mec::ShmRing();
+        assert(crashed->create(NAME));
+        mec::ShmRing reader;
+        assert(reader.open(NAME));
+        crashed->write(touch(mec::ShmTouch::T_ON, 1, 60.0f));
+        // leaked, so the region is never closed or unlinked
+        crashed = nullptr;
+
+        mec::ShmRing writer;
+        assert(writer.create(NAME));
+        mec::ShmTouch t;
+        assert(reader.read(t) && t.type_ == mec::ShmTouch::T_ON);
+        assert(reader.closed());
+        assert(reader.open(NAME));
+        assert(!reader.closed());
+        writer.write(touch(mec::ShmTouch::T_OFF, 1, 60.0f));
+        assert(reader.read(t) && t.type_ == mec::ShmTouch::T_OFF);
+    }
+
+    // doorbell wakes a waiting reader
+    {
+        mec::ShmRing writer;
+        assert(writer.create(NAME));
+        mec::ShmRing reader;
+        assert(reader.open(NAME));
+        assert(!reader.wait(1000));
+
+        unsigned long long worst = 0;
+        unsigned received = 0;
+        std::thread consumer([&]() {
+            mec::ShmTouch t;
+            while (received < 100) {
+                if (!reader.wait(1000000)) break;
+                while (reader.read(t)) {
+                    unsigned long long latency = mec::microtime() - t.time_;
+                    if (latency > worst) worst = latency;
+                    received++;
+                }
+            }
+        });
+        for (int i = 0; i < 100; i++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            writer.write(touch(mec::ShmTouch::T_CONTINUE, 3, static_cast<float>(i)));
+            writer.notify();
+        }
+        consumer.join();
+        assert(received == 100);
+        LOG_0("worst latency (uS) : " << worst);
+    }
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <mec_stats.h>
+
+#include <cassert>
+#include <iostream>
+
+#include <mec_log.h>
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    mec::Stats::reset();
+    mec::Stats::Histogram h;
+    mec::Stats::histogram(mec::Stats::S_DISPATCH, h);
+    assert(h.count_ == 0);
+    assert(h.percentile(0.5f) == 0);
+
+    if (!mec::Stats::enabled()) {
+        LOG_0("stats disabled, test completed");
+        return 0;
+    }
+
+    for (int i = 0; i < 99; i++) {
+        mec::Stats::record(mec::Stats::S_DISPATCH, 10);
+    }
+    mec::Stats::record(mec::Stats::S_DISPATCH, 5000);
+
+    mec::Stats::histogram(mec::Stats::S_DISPATCH, h);
+    assert(h.count_ == 100);
+    assert(h.max_ == 5000);
+    assert(h.mean() == (99 * 10 + 5000) / 100);
+    // 10uS is in the < 16uS bucket
+    assert(h.percentile(0.5f) == 16);
+    assert(h.percentile(0.99f) == 8192);
+
+    mec::Stats::count(mec::Stats::C_VOICE_STEAL);
+    mec::Stats::count(mec::Stats::C_VOICE_STEAL);
+    assert(mec::Stats::counter(mec::Stats::C_VOICE_STEAL) == 2);
+
+    mec::Stats::highWater(mec::Stats::C_QUEUE_HIGH_WATER, 10);
+    mec::Stats::highWater(mec::Stats::C_QUEUE_HIGH_WATER, 5);
+    assert(mec::Stats::counter(mec::Stats::C_QUEUE_HIGH_WATER) == 10);
+
+    mec::Stats::reset();
+    assert(mec::Stats::counter(mec::Stats::C_VOICE_STEAL) == 0);
+    mec::Stats::histogram(mec::Stats::S_DISPATCH, h);
+    assert(h.count_ == 0);
+
+    LOG_0("test completed");
+    return 0;
+}
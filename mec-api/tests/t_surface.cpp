@@ -1,6 +1,7 @@
 #include <mec_api.h>
 
 #include <cassert>
+#include <cmath>
 #include <iostream>
 
 #include <mec_surface.h>
@@ -23,21 +24,28 @@ int main (int argc, char** argv) {
     mec::SurfaceManager mgr;
     assert(mgr.init(sm_prefs));
 
+    // interned ids
+    mec::SurfaceID s1 = mec::internSurface("1");
+    assert(s1 != 0);
+    assert(mec::internSurface("1") == s1);
+    assert(mec::surfaceName(s1) == "1");
+    assert(mec::internSurface("") == 0);
+
     mec::Touch t;
     mec::Touch out;
 
     // simple split
     std::shared_ptr<mec::Surface> split1 = mgr.getSurface("1");
     assert(split1 != nullptr);
-    t.surface_ = "a1";
+    t.surface_ = mec::internSurface("a1");
     t.x_ = 0.1f;
     out = split1->map(t);
     assert(out.x_ == t.x_);
-    assert(out.surface_ == "10");
+    assert(out.surface_ == mec::internSurface("10"));
     t.x_ = 0.8f;
     out = split1->map(t);
     assert(out.x_ == 0.3f);
-    assert(out.surface_ == "11");
+    assert(out.surface_ == mec::internSurface("11"));
 
 
 
@@ -45,15 +53,79 @@ int main (int argc, char** argv) {
     std::shared_ptr<mec::Surface> join1 = mgr.getSurface("2");
     assert(join1 != nullptr);
     t.x_ = 0.1f;
-    t.surface_ = "20";
+    t.surface_ = mec::internSurface("20");
     out = join1->map(t);
     assert(out.x_ == t.x_);
-    assert(out.surface_ == "2");
-    t.surface_ = "21";
+    assert(out.surface_ == mec::internSurface("2"));
+    t.surface_ = mec::internSurface("21");
     out = join1->map(t);
     assert(out.x_ == 1.1f);
-    assert(out.surface_ == "2");
+    assert(out.surface_ == mec::internSurface("2"));
+
+
+    // compiled split, matches single step mapping
+    assert(mgr.transformCount(s1) == 2);
+    t = mec::Touch(5, s1, 0.8f, 0.2f, 0.5f, 1.0f, 3.0f);
+    assert(mgr.mapped(t));
+    assert(mgr.touchOn(t, out));
+    assert(out.surface_ == mec::internSurface("11"));
+    assert(out.x_ == 0.3f && out.y_ == 0.2f && out.z_ == 0.5f);
+    assert(out.id_ == 0);
+
+    // touch stays on its surface, even if it moves across the split
+    t.x_ = 0.4f;
+    assert(mgr.touchContinue(t, out));
+    assert(out.surface_ == mec::internSurface("11"));
+    assert(std::fabs(out.x_ + 0.1f) < 0.0001f);
+
+    // voices are contiguous per output surface
+    mec::Touch t2(9, s1, 0.9f, 0.0f, 0.5f, 0.0f, 0.0f);
+    mec::Touch out2;
+    assert(mgr.touchOn(t2, out2));
+    assert(out2.surface_ == mec::internSurface("11") && out2.id_ == 1);
+    mec::Touch t3(12, s1, 0.1f, 0.0f, 0.5f, 0.0f, 0.0f);
+    assert(mgr.touchOn(t3, out2));
+    assert(out2.surface_ == mec::internSurface("10") && out2.id_ == 0);
+    assert(mgr.touchOff(t, out));
+    assert(out.id_ == 0);
+    mec::Touch t4(13, s1, 0.7f, 0.0f, 0.5f, 0.0f, 0.0f);
+    assert(mgr.touchOn(t4, out2));
+    assert(out2.id_ == 0); // reuses lowest free
+    assert(!mgr.touchContinue(t, out)); // already off
+
+    // compiled join
+    t = mec::Touch(1, mec::internSurface("21"), 0.1f, 0.0f, 0.5f, 0.0f, 0.0f);
+    assert(mgr.touchOn(t, out));
+    assert(out.x_ == 1.1f && out.surface_ == mec::internSurface("2"));
+    assert(mgr.touchOff(t, out));
+
+    // rotate 90
+    t = mec::Touch(1, mec::internSurface("30"), 0.25f, 0.75f, 0.5f, 0.0f, 0.0f);
+    out = mgr.getSurface("3")->map(t);
+    assert(out.x_ == 0.75f && out.y_ == 0.75f && out.surface_ == mec::internSurface("3"));
+    assert(mgr.touchOn(t, out2));
+    assert(out2.x_ == out.x_ && out2.y_ == out.y_ && out2.surface_ == out.surface_);
+    assert(mgr.touchOff(t, out2));
+
+    // split then join, compiled into a single transform per region
+    mec::SurfaceID s4 = mec::internSurface("4");
+    assert(mgr.transformCount(s4) == 2);
+    t = mec::Touch(2, s4, 0.8f, 0.25f, 0.5f, 0.0f, 0.0f);
+    assert(mgr.touchOn(t, out));
+    assert(out.surface_ == mec::internSurface("5"));
+    assert(out.x_ == 0.3f && out.y_ == 2.25f);
+    assert(mgr.touchOff(t, out));
+    t.x_ = 0.1f;
+    assert(mgr.touchOn(t, out));
+    assert(out.surface_ == mec::internSurface("40") && out.x_ == 0.1f);
+    assert(mgr.touchOff(t, out));
+
+    // unmapped surface, and out of range touch ids
+    t = mec::Touch(1, mec::internSurface("10"), 0.1f, 0.0f, 0.5f, 0.0f, 0.0f);
+    assert(!mgr.mapped(t));
+    t = mec::Touch(mec::SurfaceManager::MAX_TOUCH_IDS, s1, 0.1f, 0.0f, 0.5f, 0.0f, 0.0f);
+    assert(!mgr.touchOn(t, out));
 
     LOG_0("test completed");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,102 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <processors/mec_t3d_processor.h>
+#include <mec_log.h>
+
+#include <osc/OscReceivedElements.h>
+
+class TestT3D : public mec::T3D_Processor {
+public:
+    void process(const char *data, unsigned size) {
+        packets_.push_back(std::string(data, size));
+    }
+
+    std::vector<std::string> packets_;
+};
+
+// addresses in bundle
+static std::vector<std::string> addresses(const std::string &packet) {
+    std::vector<std::string> r;
+    osc::ReceivedPacket p(packet.data(), static_cast<osc::osc_bundle_element_size_t>(packet.size()));
+    assert(p.IsBundle());
+    osc::ReceivedBundle b(p);
+    for (osc::ReceivedBundle::const_iterator i = b.ElementsBegin(); i != b.ElementsEnd(); i++) {
+        assert(i->IsMessage());
+        r.push_back(osc::ReceivedMessage(*i).AddressPattern());
+    }
+    return r;
+}
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    TestT3D t;
+    // nothing sent for an empty cycle
+    t.flush();
+    assert(t.packets_.empty());
+
+    // one bundle per cycle, led by frame
+    t.touchOn(1, 60.0f, 0.1f, 0.2f, 0.5f);
+    t.touchContinue(2, 62.0f, 0.1f, 0.2f, 0.5f);
+    t.touchOff(100, 64.0f, 0.1f, 0.2f, 0.5f);
+    t.control(3, 0.5f);
+    assert(t.packets_.empty());
+    t.flush();
+    assert(t.packets_.size() == 1);
+    std::vector<std::string> a = addresses(t.packets_[0]);
+    assert(a.size() == 5);
+    assert(a[0] == "/t3d/frm" && a[1] == "/t3d/tch1" && a[2] == "/t3d/tch2");
+    assert(a[3] == "/t3d/tch100" && a[4] == "/t3d/control");
+
+    // args, frame count, touch off has z = 0
+    {
+        osc::ReceivedPacket p(t.packets_[0].data(), static_cast<osc::osc_bundle_element_size_t>(t.packets_[0].size()));
+        osc::ReceivedBundle b(p);
+        osc::ReceivedBundle::const_iterator i = b.ElementsBegin();
+        osc::ReceivedMessage frm(*i++);
+        osc::int32 frame, time;
+        frm.ArgumentStream() >> frame >> time >> osc::EndMessage;
+        assert(frame == 0);
+        osc::ReceivedMessage tch1(*i++);
+        float x, y, z, note;
+        tch1.ArgumentStream() >> x >> y >> z >> note >> osc::EndMessage;
+        assert(x == 0.1f && y == 0.2f && z == 0.5f && note == 60.0f);
+        i++;
+        osc::ReceivedMessage off(*i++);
+        off.ArgumentStream() >> x >> y >> z >> note >> osc::EndMessage;
+        assert(z == 0.0f && note == 64.0f);
+    }
+    assert(t.frame() == 1);
+
+    // large frames are split over bundles, each a frame
+    t.packets_.clear();
+    for (int i = 0; i < 200; i++) {
+        t.touchContinue(i % 16, 60.0f, 0.0f, 0.0f, 0.5f);
+    }
+    t.flush();
+    assert(t.packets_.size() > 1);
+    unsigned touches = 0;
+    for (auto p = t.packets_.begin(); p != t.packets_.end(); p++) {
+        assert(p->size() <= mec::T3D_Processor::BUFFER_SIZE);
+        a = addresses(*p);
+        assert(a[0] == "/t3d/frm");
+        touches += a.size() - 1;
+    }
+    assert(touches == 200);
+    assert(t.frame() == 1 + t.packets_.size());
+
+    // largest touch id, address is not truncated
+    t.packets_.clear();
+    t.touchOn(2147483647, 60.0f, 0.0f, 0.0f, 0.5f);
+    t.flush();
+    a = addresses(t.packets_[0]);
+    assert(a.size() == 2 && a[1] == "/t3d/tch2147483647");
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+#include <mec_tuning.h>
+#include <mec_scaler.h>
+#include <processors/mec_mpe_processor.h>
+#include <mec_log.h>
+
+static bool near(float a, float b) {
+    return std::fabs(a - b) < 0.001f;
+}
+
+class TestMpe : public mec::MPE_Processor {
+public:
+    void process(MidiMsg &msg) {
+        msgs_.push_back(msg);
+    }
+
+    std::vector<MidiMsg> msgs_;
+};
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    // default is 12 tet
+    mec::Tuning tet;
+    assert(tet.size() == 12);
+    assert(near(tet.pitch(60.0f), 60.0f));
+    assert(near(tet.pitch(61.5f), 61.5f));
+    assert(near(tet.pitch(-2.0f), -2.0f));
+    assert(near(tet.pitch(130.0f), 130.0f));
+
+    // cents and ratios
+    std::istringstream edo(
+        "! 24 edo\n"
+        "quarter tones\n"
+        "24\n"
+        "50.0\n100.0\n150.0\n200.0\n250.0\n300.0\n350.0\n400.0\n450.0\n500.0\n550.0\n600.0\n"
+        "650.0\n700.0\n750.0\n800.0\n850.0\n900.0\n950.0\n1000.0\n1050.0\n1100.0\n1150.0\n2/1\n");
+    mec::Tuning qt;
+    assert(qt.parseScl(edo));
+    assert(qt.description() == "quarter tones");
+    assert(qt.size() == 24);
+    // degree 0 on key 60, 440Hz on key 69 (18 quarter tones up)
+    assert(near(qt.pitch(69.0f), 69.0f));
+    assert(near(qt.pitch(70.0f), 69.5f));
+    assert(near(qt.pitch(60.0f), 64.5f));
+
+    std::istringstream bad("bad\n3\n9/8\nsquirrel\n2/1\n");
+    assert(!qt.parseScl(bad));
+    assert(qt.size() == 24); // unchanged
+
+    // just intonation, all keys mapped to degrees
+    mec::Tuning ji;
+    assert(ji.loadScl("../mec-api/tests/test.scl"));
+    assert(ji.size() == 7);
+    assert(near(ji.pitch(67.0f) - ji.pitch(60.0f), 12.0f));
+    assert(near(ji.pitch(62.0f) - ji.pitch(60.0f), 3.8631f));
+
+    // keyboard map, white keys, C4 at 261.6256Hz
+    assert(ji.loadKbm("../mec-api/tests/test.kbm"));
+    assert(near(ji.pitch(60.0f), 60.0f));
+    assert(near(ji.pitch(64.0f), 63.8631f));
+    assert(near(ji.pitch(67.0f), 67.0196f));
+    assert(near(ji.pitch(72.0f), 72.0f));
+    assert(near(ji.pitch(48.0f), 48.0f));
+    assert(near(ji.pitch(61.0f), 60.0f)); // unmapped, holds last pitch
+    assert(near(ji.pitch(59.0f), 58.8827f)); // 15/8 an octave down
+
+    // scaler retunes its output
+    mec::Scaler scaler;
+    std::shared_ptr<mec::Tuning> tuning(new mec::Tuning(ji));
+    scaler.setTuning(tuning);
+    assert(scaler.getTuning() == tuning);
+    mec::Touch t(0, 1, 0.0f, 0.0f, 0.5f, 0.0f, 64.0f);
+    mec::MusicalTouch mt = scaler.map(t);
+    assert(near(mt.note_, 63.8631f));
+    float r = 0.0f, c = 67.0f, n = 0.0f;
+    scaler.notes(&r, &c, &n, 1);
+    assert(near(n, 67.0196f));
+
+    // mpe uses the tuned note for pitchbend
+    TestMpe mpe;
+    mec::MPE_MusicalInput musical(mpe);
+    musical.touchOn(mt);
+    bool noteOn = false, bend = false;
+    for (const mec::Midi_Processor::MidiMsg &m : mpe.msgs_) {
+        unsigned char status = (unsigned char) m.data[0];
+        if (status == 0x91) {
+            noteOn = true;
+            assert(m.data[1] == 64);
+        }
+        if (status == 0xE1) {
+            bend = true;
+            unsigned pb = (unsigned) m.data[1] + ((unsigned) m.data[2] << 7);
+            assert(pb < 0x2000);
+        }
+    }
+    assert(noteOn && bend);
+    musical.touchOff(mt);
+
+    // out of range voice ignored
+    mpe.msgs_.clear();
+    mt.id_ = mec::MPE_Processor::MAX_TOUCHES;
+    musical.touchOn(mt);
+    assert(mpe.msgs_.empty());
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mec_udpreceiver.h>
+#include <mec_log.h>
+
+#include <ip/UdpSocket.h>
+
+class TestListener : public mec::UdpReceiver::Listener {
+public:
+    TestListener(bool release) : release_(release), timers_(0) { ; }
+
+    void receive(mec::UdpReceiver::Packet *p) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        data_.push_back(std::string(p->data_, p->size_));
+        assert(p->address_ == 0x7F000001);
+        shards_.push_back(p->shard_);
+        if (release_) p->release();
+        else held_.push_back(p);
+    }
+
+    void timer(unsigned) override { timers_++; }
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return data_.size();
+    }
+
+    void releaseAll() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto i = held_.begin(); i != held_.end(); i++) (*i)->release();
+        held_.clear();
+    }
+
+    bool release_;
+    std::atomic<unsigned> timers_;
+    std::mutex mutex_;
+    std::vector<std::string> data_;
+    std::vector<unsigned> shards_;
+    std::vector<mec::UdpReceiver::Packet *> held_;
+};
+
+static bool waitFor(TestListener &l, size_t n, int ms = 1000) {
+    for (int i = 0; i < ms && l.count() < n; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return l.count() == n;
+}
+
+static const int PORT = 9124;
+
+int main(int ac, char **av) {
+    LOG_0("test started");
+
+    // packets passed by reference, in order from one sender
+    {
+        TestListener l(true);
+        mec::UdpReceiver r;
+        r.setTimer(10);
+        assert(r.start(PORT, &l));
+        UdpTransmitSocket s(IpEndpointName("127.0.0.1", PORT));
+        for (int i = 0; i < 50; i++) {
+            std::string msg = "packet " + std::to_string(i);
+            s.Send(msg.c_str(), msg.size());
+        }
+        assert(waitFor(l, 50));
+        for (int i = 0; i < 50; i++) {
+            assert(l.data_[i] == "packet " + std::to_string(i));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        assert(l.timers_ > 0);
+        r.stop();
+        assert(!r.isRunning());
+    }
+
+    // pool exhausted, reading pauses until packets are released
+    {
+        TestListener l(false);
+        mec::UdpReceiver r;
+        assert(r.start(PORT, &l, 1, 4, 16, 64));
+        UdpTransmitSocket s(IpEndpointName("127.0.0.1", PORT));
+        for (int i = 0; i < 20; i++) {
+            s.Send("x", 1);
+        }
+        assert(waitFor(l, 16));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(l.count() == 16);
+        l.releaseAll();
+        assert(waitFor(l, 20));
+        l.releaseAll();
+        r.stop();
+    }
+
+    // sharded, several senders over several threads
+    {
+        TestListener l(true);
+        mec::UdpReceiver r;
+        if (r.start(PORT, &l, 4)) {
+            assert(r.threads() == 4);
+            std::vector<std::unique_ptr<UdpTransmitSocket>> senders;
+            for (int i = 0; i < 8; i++) {
+                senders.push_back(std::unique_ptr<UdpTransmitSocket>(
+                        new UdpTransmitSocket(IpEndpointName("127.0.0.1", PORT))));
+            }
+            for (int n = 0; n < 10; n++) {
+                for (auto i = senders.begin(); i != senders.end(); i++) (*i)->Send("y", 1);
+            }
+            assert(waitFor(l, 80));
+            for (auto i = l.shards_.begin(); i != l.shards_.end(); i++) assert(*i < 4);
+            r.stop();
+        } else {
+            LOG_0("SO_REUSEPORT not available, sharding not tested");
+        }
+    }
+
+    // invalid
+    {
+        TestListener l(true);
+        mec::UdpReceiver r;
+        assert(!r.start(PORT, nullptr));
+        assert(!r.start(PORT, &l, 1, 16, 8));
+    }
+
+    LOG_0("test completed");
+    return 0;
+}
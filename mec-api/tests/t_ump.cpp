@@ -0,0 +1,158 @@
+#include <mec_api.h>
+
+#include <cassert>
+#include <vector>
+
+#include <processors/mec_ump_processor.h>
+#include <mec_log.h>
+
+class TestUmp : public mec::UMP_Processor {
+public:
+    void process(const uint32_t *words, unsigned count) {
+        assert(count % 2 == 0);
+        batches_++;
+        words_.insert(words_.end(), words, words + count);
+    }
+
+    unsigned status(unsigned i) const { return (words_[i * 2] >> 20) & 0xF; }
+    unsigned channel(unsigned i) const { return (words_[i * 2] >> 16) & 0xF; }
+    unsigned note(unsigned i) const { return (words_[i * 2] >> 8) & 0x7F; }
+    unsigned index(unsigned i) const { return words_[i * 2] & 0xFF; }
+    uint32_t data(unsigned i) const { return words_[i * 2 + 1]; }
+    unsigned count() const { return static_cast<unsigned>(words_.size() / 2); }
+
+    std::vector<uint32_t> words_;
+    unsigned batches_ = 0;
+};
+
+int main (int argc, char** argv) {
+    LOG_0("test started");
+
+    // conversions
+    assert(mec::UMP_Processor::unipolar32(0.0f) == 0);
+    assert(mec::UMP_Processor::unipolar32(1.0f) == 0xFFFFFFFF);
+    assert(mec::UMP_Processor::unipolar32(2.0f) == 0xFFFFFFFF);
+    assert(mec::UMP_Processor::bipolar32(0.0f) == 0x7FFFFFFF);
+    assert(mec::UMP_Processor::pitch725(60.0f) == (60u << 25));
+    assert(mec::UMP_Processor::pitch725(60.5f) == ((60u << 25) | (1u << 24)));
+    assert(mec::UMP_Processor::pitch79(60.5f) == ((60u << 9) | (1u << 8)));
+    assert(mec::UMP_Processor::header(1, 0x9, 2, 60, 3) == 0x41923C03);
+
+    TestUmp ump;
+    ump.touchOn(2, 60.25f, 0.0f, 0.0f, 0.5f);
+    assert(ump.count() == 0); // buffered
+    ump.flush();
+    assert(ump.batches_ == 1);
+    assert(ump.count() == 2);
+
+    // timbre, then note on with pitch attribute
+    assert(ump.status(0) == 0x0 && ump.index(0) == mec::UMP_Processor::RPNC_TIMBRE);
+    assert(ump.status(1) == 0x9 && ump.channel(1) == 0 && ump.note(1) == 60 && ump.index(1) == 3);
+    assert((ump.data(1) & 0xFFFF) == mec::UMP_Processor::pitch79(60.25f));
+    assert((ump.data(1) >> 16) == mec::UMP_Processor::unipolar16(0.5f));
+
+    // full resolution pitch, pressure only sent on change
+    ump.words_.clear();
+    ump.touchContinue(2, 60.3f, 0.0f, 0.0f, 0.7f);
+    ump.touchContinue(2, 60.3f, 0.0f, 0.0f, 0.7f);
+    ump.flush();
+    assert(ump.count() == 2);
+    assert(ump.status(0) == 0x0 && ump.index(0) == mec::UMP_Processor::RPNC_PITCH);
+    assert(ump.data(0) == mec::UMP_Processor::pitch725(60.3f));
+    assert(ump.status(1) == 0xA && ump.data(1) == mec::UMP_Processor::unipolar32(0.7f));
+
+    // off
+    ump.words_.clear();
+    ump.touchOff(2, 60.3f, 0.0f, 0.0f, 0.0f);
+    ump.flush();
+    assert(ump.count() == 2);
+    assert(ump.status(1) == 0x8 && ump.note(1) == 60);
+
+    // continue/off for unknown touch ignored
+    ump.words_.clear();
+    ump.touchContinue(5, 60.0f, 0.0f, 0.0f, 0.5f);
+    ump.touchOff(5, 60.0f, 0.0f, 0.0f, 0.5f);
+    ump.flush();
+    assert(ump.count() == 0);
+
+    // ids 0 and 16 on the same note, each gets its own channel
+    ump.words_.clear();
+    ump.touchOn(0, 62.0f, 0.0f, 0.0f, 0.5f);
+    ump.touchOn(16, 62.0f, 0.0f, 0.0f, 0.5f);
+    ump.flush();
+    assert(ump.count() == 4);
+    assert(ump.status(1) == 0x9 && ump.status(3) == 0x9);
+    assert(ump.channel(1) != ump.channel(3));
+    unsigned ch16 = ump.channel(3);
+    ump.words_.clear();
+    ump.touchOff(0, 62.0f, 0.0f, 0.0f, 0.0f);
+    ump.touchContinue(16, 62.0f, 0.0f, 0.0f, 0.5f);
+    ump.flush();
+    assert(ump.count() == 3);
+    assert(ump.status(2) == 0xA && ump.channel(2) == ch16);
+    ump.words_.clear();
+    ump.touchOff(16, 62.0f, 0.0f, 0.0f, 0.0f);
+    ump.flush();
+    assert(ump.status(1) == 0x8 && ump.channel(1) == ch16);
+
+    // different notes are spread over channels
+    ump.words_.clear();
+    ump.touchOn(1, 64.0f, 0.0f, 0.0f, 0.5f);
+    ump.touchOn(2, 65.0f, 0.0f, 0.0f, 0.5f);
+    ump.flush();
+    assert(ump.channel(1) != ump.channel(3));
+    ump.touchOff(1, 64.0f, 0.0f, 0.0f, 0.0f);
+    ump.touchOff(2, 65.0f, 0.0f, 0.0f, 0.0f);
+
+    // once the note is sounding on every channel, further touches on it are dropped
+    ump.flush();
+    ump.words_.clear();
+    for (int id = 0; id < 16; id++) {
+        ump.touchOn(id, 67.0f, 0.0f, 0.0f, 0.5f);
+    }
+    ump.flush();
+    assert(ump.count() == 32);
+    ump.words_.clear();
+    ump.touchOn(20, 67.0f, 0.0f, 0.0f, 0.5f);
+    ump.touchContinue(20, 67.0f, 0.0f, 0.0f, 0.5f);
+    ump.touchOn(mec::UMP_Processor::MAX_TOUCHES, 68.0f, 0.0f, 0.0f, 0.5f);
+    ump.flush();
+    assert(ump.count() == 0);
+    // but another note still plays
+    ump.touchOn(20, 69.0f, 0.0f, 0.0f, 0.5f);
+    ump.flush();
+    assert(ump.count() == 2);
+    for (int id = 0; id < 16; id++) {
+        ump.touchOff(id, 67.0f, 0.0f, 0.0f, 0.0f);
+    }
+    ump.touchOff(20, 69.0f, 0.0f, 0.0f, 0.0f);
+    ump.flush();
+    ump.words_.clear();
+
+    // musical input, device touches ignored
+    {
+        TestUmp m;
+        mec::UMP_MusicalInput musical(m);
+        m.setTouchInput(false);
+        m.touchOn(0, 60.0f, 0.0f, 0.0f, 0.5f);
+        m.flush();
+        assert(m.count() == 0);
+        musical.touchOn(mec::MusicalTouch(mec::Touch(0, 0, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f), 60.5f));
+        m.flush();
+        assert(m.count() == 2 && m.status(1) == 0x9);
+        assert((m.data(1) & 0xFFFF) == mec::UMP_Processor::pitch79(60.5f));
+    }
+
+    // controls, full buffer flushes early
+    ump.batches_ = 0;
+    for (int i = 0; i < 1000; i++) {
+        ump.control(1, (i % 100) / 100.0f);
+    }
+    assert(ump.batches_ >= 3);
+    ump.flush();
+    assert(ump.count() == 1000);
+    assert(ump.status(0) == 0xB && ump.note(0) == 1);
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -29,6 +29,150 @@ int main (int argc, char** argv) {
     voices.startVoice(4);
     assert(voices.oldestActiveVoice()->id_ == 2);
 
+    // lookup by key, including keys outside the direct lookup table
+    assert(voices.voiceId(1) == nullptr);
+    assert(voices.voiceId(3)->id_ == 3);
+    assert(voices.voiceId(4)->id_ == 4);
+
+    // stop from the middle keeps start order
+    voices.stopVoice(voices.voiceId(3));
+    assert(voices.voiceId(3) == nullptr);
+    assert(voices.oldestActiveVoice()->id_ == 2);
+    voices.stopVoice(voices.voiceId(3)); // already stopped
+    v = voices.startVoice(1000);
+    assert(v != nullptr);
+    assert(voices.voiceId(1000) == v);
+    assert(voices.startVoice(5) == nullptr);
+
+    // free voices are reused in the order they were stopped
+    int i4 = voices.voiceId(4)->i_;
+    int i2 = voices.voiceId(2)->i_;
+    voices.stopVoice(voices.voiceId(4));
+    voices.stopVoice(voices.voiceId(2));
+    assert(voices.startVoice(6)->i_ == i4);
+    assert(voices.startVoice(7)->i_ == i2);
+    assert(voices.oldestActiveVoice()->id_ == 1000);
+    voices.stopVoice(voices.voiceId(1000));
+    assert(voices.oldestActiveVoice()->id_ == 6);
+    assert(voices.voiceId(1000) == nullptr);
+    voices.stopVoice(voices.voiceId(6));
+    voices.stopVoice(voices.voiceId(7));
+    assert(voices.oldestActiveVoice() == nullptr);
+
+    // stress, random start/stop compared with a brute force model
+    mec::Voices big(15, 2, 128);
+    unsigned active[200] = {0};
+    unsigned seed = 1;
+    for (int n = 0; n < 100000; n++) {
+        seed = seed * 1103515245 + 12345;
+        unsigned key = (seed >> 16) % 200;
+        mec::Voices::Voice *bv = big.voiceId(key);
+        assert((bv != nullptr) == (active[key] != 0));
+        if (bv) {
+            assert(bv->id_ == (int) key);
+            big.stopVoice(bv);
+            active[key] = 0;
+        } else {
+            bv = big.startVoice(key);
+            if (bv) active[key] = 1;
+        }
+    }
+
+    // steal policies
+    mec::Voices sv(3, 2);
+    float notes[3] = {60.0f, 72.0f, 48.0f};
+    float zs[3] = {0.5f, 0.2f, 0.9f};
+    // only pending voices, oldest
+    for (unsigned k = 0; k < 3; k++) {
+        v = sv.startVoice(k);
+        v->note_ = notes[k];
+        v->z_ = zs[k];
+    }
+    sv.setStealPolicy(mec::Voices::stealPolicy("quietest"));
+    assert(sv.voiceToSteal(0.0f)->id_ == 0);
+    sv.setStealPolicy(mec::Voices::STEAL_OLDEST);
+    for (unsigned k = 0; k < 3; k++) {
+        v = sv.voiceId(k);
+        sv.addPressure(v, zs[k]);
+        sv.addPressure(v, zs[k]);
+        assert(v->state_ == mec::Voices::Voice::ACTIVE);
+        v->z_ = zs[k];
+    }
+    assert(sv.voiceToSteal(0.0f)->id_ == 0);
+    sv.setStealPolicy(mec::Voices::stealPolicy("quietest"));
+    assert(sv.voiceToSteal(0.0f)->id_ == 1);
+    sv.setStealPolicy(mec::Voices::stealPolicy("highest"));
+    assert(sv.voiceToSteal(0.0f)->id_ == 1);
+    sv.setStealPolicy(mec::Voices::stealPolicy("lowest"));
+    assert(sv.voiceToSteal(0.0f)->id_ == 2);
+    sv.setStealPolicy(mec::Voices::stealPolicy("nearest"));
+    assert(sv.voiceToSteal(50.0f)->id_ == 2);
+    assert(sv.voiceToSteal(62.0f)->id_ == 0);
+
+    // pending voices (no touch on yet) are not stolen, even if quietest
+    {
+        mec::Voices pv(3, 2);
+        for (unsigned k = 0; k < 2; k++) {
+            v = pv.startVoice(k);
+            pv.addPressure(v, 0.5f);
+            pv.addPressure(v, 0.5f);
+            v->z_ = 0.5f;
+        }
+        v = pv.startVoice(2);
+        v->z_ = 0.0f;
+        assert(v->state_ == mec::Voices::Voice::PENDING);
+        pv.setStealPolicy(mec::Voices::stealPolicy("quietest"));
+        assert(pv.voiceToSteal(0.0f)->id_ != 2);
+        pv.setStealPolicy(mec::Voices::STEAL_OLDEST);
+        assert(pv.voiceToSteal(0.0f)->id_ == 0);
+    }
+
+    // stolen keys stay stolen until released
+    sv.stealVoice(sv.voiceId(0));
+    assert(sv.voiceId(0) == nullptr);
+    assert(sv.isStolen(0));
+    assert(!sv.isStolen(1));
+    sv.clearStolen(0);
+    assert(!sv.isStolen(0));
+    assert(!sv.isStolen(1000));
+
+    // velocity, least squares slope with 2 implicit zero samples
+    mec::Voices vv(2, 3);
+    v = vv.startVoice(1);
+    vv.addPressure(v, 0.1f);
+    vv.addPressure(v, 0.2f);
+    assert(v->state_ == mec::Voices::Voice::PENDING);
+    vv.addPressure(v, 0.3f);
+    assert(v->state_ == mec::Voices::Voice::ACTIVE);
+    // x = 0..4, y = 0, 0, 0.1, 0.2, 0.3, slope = 0.08, scale 4
+    assert(fabsf(v->vel_.raw_ - 0.32f) < 0.0001f);
+    assert(fabsf(v->v_ - 0.32f) < 0.0001f);
+
+    // curve from table, compared to pow
+    vv.setVelocityCurve(4.0f, 2.0f);
+    v = vv.startVoice(2);
+    vv.addPressure(v, 0.1f);
+    vv.addPressure(v, 0.2f);
+    vv.addPressure(v, 0.3f);
+    assert(fabsf(v->v_ - (1.0f - powf(1.0f - 0.32f, 2.0f))) < 0.001f);
+
+    // early velocity, active after first sample, velocity from that sample only
+    mec::Voices ev(1, 3);
+    ev.setEarlyVelocity(1);
+    v = ev.startVoice(1);
+    ev.addPressure(v, 0.1f);
+    assert(v->state_ == mec::Voices::Voice::ACTIVE);
+    float early = v->vel_.raw_;
+    ev.addPressure(v, 0.9f); // ignored once active
+    assert(v->vel_.raw_ == early);
+
+    mec::VelocityEstimator est(4);
+    est.addSample(2, 0.1f);
+    est.addSample(2, 0.2f);
+    est.addSample(2, 0.3f);
+    assert(est.velocity(0) == 0.01f);
+    assert(fabsf(est.raw(2) - 0.32f) < 0.0001f);
+
     LOG_0("test completed");
     return 0;
 }
\ No newline at end of file
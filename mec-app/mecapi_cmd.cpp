@@ -17,16 +17,21 @@ inline void pthread_exit(void *value_ptr)
 
 #endif
 #include <string.h>
+#include <algorithm>
 
 #include <osc/OscOutboundPacketStream.h>
 #include <ip/UdpSocket.h>
 
 #include "mec_app.h"
 #include "midi_output.h"
+#include "udp_output.h"
 
 #include <mec_api.h>
 #include <mec_prefs.h>
+#include <mec_shmring.h>
+#include <mec_stats.h>
 #include <processors/mec_mpe_processor.h>
+#include <processors/mec_t3d_processor.h>
 
 #define OUTPUT_BUFFER_SIZE 1024
 
@@ -35,20 +40,24 @@ inline void pthread_exit(void *value_ptr)
 //#define PB_RANGE 2.0f
 //#define MPE_PB_RANGE 48.0f
 
+static void mec_command(int cmd) {
+    switch (cmd) {
+        case mec::ICallback::SHUTDOWN: {
+            LOG_0("mec requesting shutdown");
+            keepRunning = 0;
+            mec_notifyAll();
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
 class MecCmdCallback : public mec::ICallback {
 public:
     virtual void mec_control(int cmd, void *other) {
-        switch (cmd) {
-            case mec::ICallback::SHUTDOWN: {
-                LOG_0("mec requesting shutdown");
-                keepRunning = 0;
-                mec_notifyAll();
-                break;
-            }
-            default: {
-                break;
-            }
-        }
+        mec_command(cmd);
     }
 };
 
@@ -110,67 +119,175 @@ private:
 };
 
 
-// this is basically T3D, but doesnt have the framemessages (/t3d/frm)
-class MecOSCCallback : public MecCmdCallback {
+// T3D, one bundle per dispatch cycle, sent to "host"/"port" and any "destinations" [ { host, port } ]
+class MecOSCCallback : public mec::T3D_Processor {
 public:
     MecOSCCallback(mec::Preferences &p)
             : prefs_(p),
-              transmitSocket_(IpEndpointName(p.getString("host", "127.0.0.1").c_str(), p.getInt("port", 9001))),
               valid_(true) {
+        output_.addDestination(p.getString("host", "127.0.0.1"), static_cast<unsigned>(p.getInt("port", 9001)));
+        if (p.exists("destinations")) {
+            mec::Preferences::Array dests(p.getArray("destinations"));
+            for (int i = 0; i < dests.getSize(); i++) {
+                mec::Preferences dest(dests.getObject(i));
+                output_.addDestination(dest.getString("host", "127.0.0.1"),
+                                       static_cast<unsigned>(dest.getInt("port", 9001)));
+            }
+        }
+        valid_ = output_.destinations() > 0;
         if (valid_) {
-            LOG_0("mecapi_proc enabling for osc");
+            LOG_0("mecapi_proc enabling for osc, destinations : " << output_.destinations());
         }
     }
 
     bool isValid() { return valid_; }
 
+    void process(const char *data, unsigned size) {
+        output_.send(data, size);
+    }
+
+    void mec_control(int cmd, void *other) {
+        mec_command(cmd);
+    }
+
+private:
+    mec::Preferences prefs_;
+    UdpOutput output_;
+    bool valid_;
+};
+
+// touches to co-located consumers thru shared memory, "name" and "capacity" (records)
+// readers are woken once per dispatch cycle
+class MecShmCallback : public mec::ICallback {
+public:
+    MecShmCallback(mec::Preferences &p) : prefs_(p), pending_(false) {
+        std::string name = p.getString("name", mec::ShmRing::DEFAULT_NAME);
+        if (ring_.create(name, static_cast<unsigned>(p.getInt("capacity", mec::ShmRing::DEFAULT_CAPACITY)))) {
+            LOG_0("mecapi_proc enabling for shared memory : " << name);
+        }
+    }
+
+    bool isValid() { return ring_.isOpen(); }
+
     void touchOn(int touchId, float note, float x, float y, float z) {
-        std::string topic = "/t3d/tch" + std::to_string(touchId);
-        sendMsg(topic, touchId, note, x, y, z);
+        touchOn(mec::microtime(), touchId, note, x, y, z);
     }
 
     void touchContinue(int touchId, float note, float x, float y, float z) {
-        std::string topic = "/t3d/tch" + std::to_string(touchId);
-        sendMsg(topic, touchId, note, x, y, z);
+        touchContinue(mec::microtime(), touchId, note, x, y, z);
     }
 
     void touchOff(int touchId, float note, float x, float y, float z) {
-        std::string topic = "/t3d/tch" + std::to_string(touchId);
-        sendMsg(topic, touchId, note, x, y, 0);
-
+        touchOff(mec::microtime(), touchId, note, x, y, z);
     }
 
     void control(int ctrlId, float v) {
-        osc::OutboundPacketStream op(buffer_, OUTPUT_BUFFER_SIZE);
-        op << osc::BeginBundleImmediate
-           << osc::BeginMessage("/t3d/control")
-           << ctrlId << v
-           << osc::EndMessage
-           << osc::EndBundle;
-        transmitSocket_.Send(op.Data(), op.Size());
+        control(mec::microtime(), ctrlId, v);
+    }
+
+    void touchOn(unsigned long long t, int touchId, float note, float x, float y, float z) {
+        write(t, mec::ShmTouch::T_ON, touchId, note, x, y, z);
+    }
+
+    void touchContinue(unsigned long long t, int touchId, float note, float x, float y, float z) {
+        write(t, mec::ShmTouch::T_CONTINUE, touchId, note, x, y, z);
+    }
+
+    void touchOff(unsigned long long t, int touchId, float note, float x, float y, float z) {
+        write(t, mec::ShmTouch::T_OFF, touchId, note, x, y, z);
+    }
+
+    void control(unsigned long long t, int ctrlId, float v) {
+        write(t, mec::ShmTouch::T_CONTROL, ctrlId, 0.0f, 0.0f, 0.0f, v);
     }
 
-    void sendMsg(std::string topic, int touchId, float note, float x, float y, float z) {
+    void mec_control(int cmd, void *other) {
+        mec_command(cmd);
+    }
+
+    void flush() {
+        if (pending_) ring_.notify();
+        pending_ = false;
+    }
+
+private:
+    void write(unsigned long long t, mec::ShmTouch::Type type, int id, float note, float x, float y, float z) {
+        mec::ShmTouch touch;
+        touch.time_ = t;
+        touch.type_ = type;
+        touch.id_ = id;
+        touch.note_ = note;
+        touch.x_ = x;
+        touch.y_ = y;
+        touch.z_ = z;
+        ring_.write(touch);
+        pending_ = true;
+    }
+
+    mec::Preferences prefs_;
+    mec::ShmRing ring_;
+    bool pending_;
+};
+
+// periodically sends mec::Stats as /mec/stats messages
+// stage : name count mean p50 p99 max (uS), counter : name value
+class MecStatsReporter {
+public:
+    MecStatsReporter(mec::Preferences &p)
+            : transmitSocket_(IpEndpointName(p.getString("host", "127.0.0.1").c_str(), p.getInt("port", 9002))),
+              interval_(static_cast<unsigned long long>(p.getInt("interval", 1000)) * 1000),
+              lastSent_(0) {
+        LOG_0("mecapi_proc enabling stats, interval (ms) : " << interval_ / 1000);
+        if (!mec::Stats::enabled()) LOG_0("mec-api built with DISABLE_STATS, stats will be empty");
+    }
+
+    void poll() {
+        unsigned long long now = mec::microtime();
+        if (now - lastSent_ < interval_) return;
+        lastSent_ = now;
+
         osc::OutboundPacketStream op(buffer_, OUTPUT_BUFFER_SIZE);
-        op << osc::BeginBundleImmediate
-           << osc::BeginMessage(topic.c_str())
-           << x << y << z << note
-           << osc::EndMessage
-           << osc::EndBundle;
+        op << osc::BeginBundleImmediate;
+        for (unsigned i = 0; i < mec::Stats::S_MAX; i++) {
+            mec::Stats::Stage stage = static_cast<mec::Stats::Stage>(i);
+            mec::Stats::Histogram h;
+            mec::Stats::histogram(stage, h);
+            op << osc::BeginMessage("/mec/stats")
+               << mec::Stats::stageName(stage)
+               << static_cast<osc::int32>(h.count_)
+               << static_cast<osc::int32>(h.mean())
+               << static_cast<osc::int32>(h.percentile(0.5f))
+               << static_cast<osc::int32>(h.percentile(0.99f))
+               << static_cast<osc::int32>(h.max_)
+               << osc::EndMessage;
+        }
+        for (unsigned i = 0; i < mec::Stats::C_MAX; i++) {
+            mec::Stats::Counter counter = static_cast<mec::Stats::Counter>(i);
+            op << osc::BeginMessage("/mec/stats")
+               << mec::Stats::counterName(counter)
+               << static_cast<osc::int32>(mec::Stats::counter(counter))
+               << osc::EndMessage;
+        }
+        op << osc::EndBundle;
         transmitSocket_.Send(op.Data(), op.Size());
     }
 
+    unsigned waitTime() { return static_cast<unsigned>(interval_ / 1000); }
+
 private:
-    mec::Preferences prefs_;
     UdpTransmitSocket transmitSocket_;
+    unsigned long long interval_;
+    unsigned long long lastSent_;
     char buffer_[OUTPUT_BUFFER_SIZE];
-    bool valid_;
 };
 
 class MecMidiProcessor : public mec::Midi_Processor {
 public:
     MecMidiProcessor(mec::Preferences &p) : prefs_(p) {
         setPitchbendRange(static_cast<float>(p.getDouble("pitchbend range", 48.0f)));
+        if (p.exists("controls")) controls().load(mec::Preferences(p.getSubTree("controls")));
+        // send once per dispatch cycle
+        setBuffered(p.getBool("buffered", true));
         std::string device = prefs_.getString("device");
         int virt = prefs_.getInt("virtual", 0);
         if (output_.create(device, virt > 0)) {
@@ -184,14 +301,11 @@ public:
     bool isValid() { return output_.isOpen(); }
 
     void process(mec::Midi_Processor::MidiMsg &m) {
-        if (output_.isOpen()) {
-            std::vector<unsigned char> msg;
+        output_.sendMsg(reinterpret_cast<unsigned char *>(m.data), m.size);
+    }
 
-            for (int i = 0; i < m.size; i++) {
-                msg.push_back((unsigned char) m.data[i]);
-            }
-            output_.sendMsg(msg);
-        }
+    void processBatch(const unsigned char *data, unsigned size) {
+        output_.sendBatch(data, size);
     }
 
 private:
@@ -204,14 +318,20 @@ private:
 class MecMpeProcessor : public mec::MPE_Processor {
 public:
     MecMpeProcessor(mec::Preferences &p) : prefs_(p) {
-        // p.getInt("voices", 15);
         setPitchbendRange(static_cast<float>(p.getDouble("pitchbend range", 48.0f)));
+        setZone(p.getString("zone", "lower") == "upper" ? Z_UPPER : Z_LOWER,
+                static_cast<unsigned>(p.getInt("voices", 15)));
+        if (p.exists("governor")) governor().load(mec::Preferences(p.getSubTree("governor")));
+        if (p.exists("controls")) controls().load(mec::Preferences(p.getSubTree("controls")));
+        // send once per dispatch cycle
+        setBuffered(p.getBool("buffered", true));
         std::string device = prefs_.getString("device");
         int virt = prefs_.getInt("virtual", 0);
         if (output_.create(device, virt > 0)) {
             LOG_1("MecMpeProcessor enabling for midi to " << device);
-            LOG_1("TODO (MecMpeProcessor) :");
-            LOG_1("- MPE init, including PB range");
+            // zone and pitchbend range
+            configure();
+            flush();
         }
         if (!output_.isOpen()) {
             LOG_0("MecMpeProcessor not open, so invalid for" << device);
@@ -221,14 +341,11 @@ public:
     bool isValid() { return output_.isOpen(); }
 
     void process(mec::MPE_Processor::MidiMsg &m) {
-        if (output_.isOpen()) {
-            std::vector<unsigned char> msg;
+        output_.sendMsg(reinterpret_cast<unsigned char *>(m.data), m.size);
+    }
 
-            for (int i = 0; i < m.size; i++) {
-                msg.push_back((unsigned char) m.data[i]);
-            }
-            output_.sendMsg(msg);
-        }
+    void processBatch(const unsigned char *data, unsigned size) {
+        output_.sendBatch(data, size);
     }
 
 private:
@@ -261,6 +378,12 @@ void *mecapi_proc(void *arg) {
         if(cbprefs.getBool("mpe",true)) {
             MecMpeProcessor *pCb = new MecMpeProcessor(cbprefs);
             if (pCb->isValid()) {
+                // musical touches, are surface touches mapped (and tuned) by the scaler,
+                // played instead of device touches, controls still come thru the processor
+                if (cbprefs.getBool("musical", false)) {
+                    pCb->setTouchInput(false);
+                    mecApi->subscribe(new mec::MPE_MusicalInput(*pCb));
+                }
                 mecApi->subscribe(pCb);
             } else {
                 delete pCb;
@@ -283,6 +406,15 @@ void *mecapi_proc(void *arg) {
             delete pCb;
         }
     }
+    if (outprefs.exists("shm")) {
+        mec::Preferences cbprefs(outprefs.getSubTree("shm"));
+        MecShmCallback *pCb = new MecShmCallback(cbprefs);
+        if (pCb->isValid()) {
+            mecApi->subscribe(pCb);
+        } else {
+            delete pCb;
+        }
+    }
     if (outprefs.exists("console")) {
         mec::Preferences cbprefs(outprefs.getSubTree("console"));
         MecConsoleCallback *pCb = new MecConsoleCallback(cbprefs);
@@ -295,13 +427,27 @@ void *mecapi_proc(void *arg) {
 
     mecApi->init();
 
+    std::unique_ptr<MecStatsReporter> stats;
+    if (app_prefs.exists("stats")) {
+        mec::Preferences statprefs(app_prefs.getSubTree("stats"));
+        stats.reset(new MecStatsReporter(statprefs));
+    }
+
+    // dispatch thread calls back as soon as devices have data, otherwise we poll
+    bool dispatch = app_prefs.getBool("dispatch thread", true) && mecApi->start();
     {
         mecAppLock lock;
         while (keepRunning) {
-            mecApi->process();
-            mec_waitFor(lock,5);
+            if (stats) stats->poll();
+            if (dispatch) {
+                mec_waitFor(lock, stats ? std::min(stats->waitTime(), 1000U) : 1000);
+            } else {
+                mecApi->process();
+                mec_waitFor(lock, 5);
+            }
         }
     }
+    mecApi->stop();
 
     // delete the api, so that it can clean up
     LOG_0("mecapi_proc stopping");
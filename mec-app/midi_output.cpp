@@ -68,3 +68,39 @@ bool MidiOutput::sendMsg(std::vector<unsigned char> &msg) {
     return true;
 }
 
+
+bool MidiOutput::sendMsg(const unsigned char *msg, size_t size) {
+    if (!isOpen()) return false;
+
+    try {
+        output_->sendMessage(msg, size);
+    } catch (RtMidiError &error) {
+        LOG_0("Midi output write error:" << error.what());
+        return false;
+    }
+    return true;
+}
+
+// rtmidi only takes complete messages, each message is passed straight from the batch, without copying
+bool MidiOutput::sendBatch(const unsigned char *data, size_t size) {
+    if (!isOpen()) return false;
+
+    try {
+        size_t i = 0;
+        while (i < size) {
+            unsigned char status = data[i];
+            if ((status & 0x80) == 0) {
+                i++; // data without status
+                continue;
+            }
+            size_t len = 1 + ((status & 0xE0) == 0xC0 ? 1 : (status < 0xF0 ? 2 : 0));
+            if (i + len > size) break;
+            output_->sendMessage(data + i, len);
+            i += len;
+        }
+    } catch (RtMidiError &error) {
+        LOG_0("Midi output write error:" << error.what());
+        return false;
+    }
+    return true;
+}
@@ -15,6 +15,9 @@ public:
     bool isOpen() { return (output_ && (virtualOpen_ || output_->isPortOpen())); }
 
     bool sendMsg(std::vector<unsigned char> &msg);
+    bool sendMsg(const unsigned char *msg, size_t size);
+    // a stream of complete messages (no running status), sent without copying
+    bool sendBatch(const unsigned char *data, size_t size);
 private:
     std::unique_ptr<RtMidiOut> output_;
     bool virtualOpen_;
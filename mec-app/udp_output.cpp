@@ -0,0 +1,99 @@
+#include "udp_output.h"
+
+#include "mec_app.h"
+
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <string.h>
+#include <unistd.h>
+
+UdpOutput::UdpOutput() : count_(0) {
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_ < 0) LOG_0("UdpOutput unable to create socket");
+    iov_.iov_base = nullptr;
+    iov_.iov_len = 0;
+}
+
+UdpOutput::~UdpOutput() {
+    if (socket_ >= 0) close(socket_);
+}
+
+bool UdpOutput::addDestination(const std::string &host, unsigned port) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || res == nullptr) {
+        LOG_0("UdpOutput unable to resolve " << host);
+        return false;
+    }
+    sockaddr_in addr = *reinterpret_cast<sockaddr_in *>(res->ai_addr);
+    freeaddrinfo(res);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addresses_.push_back(addr);
+    count_ = addresses_.size();
+
+    // message headers only change by payload, which is shared
+    msgs_.resize(count_);
+    for (size_t i = 0; i < count_; i++) {
+        memset(&msgs_[i], 0, sizeof(mmsghdr));
+        msgs_[i].msg_hdr.msg_name = &addresses_[i];
+        msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msgs_[i].msg_hdr.msg_iov = &iov_;
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+    return true;
+}
+
+bool UdpOutput::send(const char *data, size_t size) {
+    if (socket_ < 0 || count_ == 0) return false;
+    iov_.iov_base = const_cast<char *>(data);
+    iov_.iov_len = size;
+    size_t sent = 0;
+    while (sent < count_) {
+        int n = sendmmsg(socket_, &msgs_[sent], static_cast<unsigned>(count_ - sent), 0);
+        if (n <= 0) {
+            // skip destination which failed, e.g. unreachable
+            sent++;
+            continue;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#else
+
+#include <ip/UdpSocket.h>
+
+UdpOutput::UdpOutput() : count_(0) {
+    ;
+}
+
+UdpOutput::~UdpOutput() {
+    ;
+}
+
+bool UdpOutput::addDestination(const std::string &host, unsigned port) {
+    try {
+        sockets_.push_back(std::unique_ptr<UdpTransmitSocket>(
+                new UdpTransmitSocket(IpEndpointName(host.c_str(), static_cast<int>(port)))));
+    } catch (std::runtime_error &e) {
+        LOG_0("UdpOutput unable to send to " << host << " : " << e.what());
+        return false;
+    }
+    count_ = sockets_.size();
+    return true;
+}
+
+bool UdpOutput::send(const char *data, size_t size) {
+    for (auto i = sockets_.begin(); i != sockets_.end(); i++) {
+        (*i)->Send(data, size);
+    }
+    return count_ > 0;
+}
+
+#endif
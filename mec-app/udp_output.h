@@ -0,0 +1,39 @@
+#ifndef MEC_UDP_OUTPUT_H
+#define MEC_UDP_OUTPUT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <sys/socket.h>
+#else
+class UdpTransmitSocket;
+#endif
+
+// sends each packet to one or more destinations
+// on linux, a single sendmmsg sends the packet to all destinations, otherwise one send per destination
+class UdpOutput {
+public:
+    UdpOutput();
+    virtual ~UdpOutput();
+
+    bool addDestination(const std::string &host, unsigned port);
+    unsigned destinations() const { return static_cast<unsigned>(count_); }
+
+    bool send(const char *data, size_t size);
+
+private:
+    size_t count_;
+#ifdef __linux__
+    int socket_;
+    std::vector<sockaddr_in> addresses_;
+    std::vector<mmsghdr> msgs_;
+    iovec iov_;
+#else
+    std::vector<std::unique_ptr<UdpTransmitSocket>> sockets_;
+#endif
+};
+
+#endif //MEC_UDP_OUTPUT_H
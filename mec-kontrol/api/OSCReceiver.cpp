@@ -8,31 +8,18 @@
 
 namespace Kontrol {
 
-class KontrolPacketListener : public PacketListener {
+class KontrolPacketListener : public mec::UdpReceiver::Listener {
 public:
-    KontrolPacketListener(moodycamel::ReaderWriterQueue<OSCReceiver::OscMsg>& queue) : queue_(queue) {
+    KontrolPacketListener(OSCReceiver &recv) : receiver_(recv) {
     }
 
-    virtual void ProcessPacket(const char *data, int size,
-                               const IpEndpointName &remoteEndpoint) {
-
-//        {
-//            static unsigned maxsize = 0;
-//            if(size>maxsize) {
-//                maxsize = size;
-//                LOG_0("KontrolPacketListener MAXSIZE " << maxsize);
-//            }
-//        }
-        OSCReceiver::OscMsg msg;
-        msg.origin_ = remoteEndpoint;
-        msg.size_ = (size > OSCReceiver::OscMsg::MAX_OSC_MESSAGE_SIZE ? OSCReceiver::OscMsg::MAX_OSC_MESSAGE_SIZE
-                                                                      : size);
-        memcpy(msg.buffer_, data, (size_t) msg.size_);
-        queue_.enqueue(msg);
+    // queued by reference, released once processed by poll()
+    virtual void receive(mec::UdpReceiver::Packet *packet) {
+        receiver_.queues_[packet->shard_]->enqueue(packet);
     }
 
 private:
-    moodycamel::ReaderWriterQueue<OSCReceiver::OscMsg>& queue_;
+    OSCReceiver &receiver_;
 };
 
 
@@ -203,8 +190,8 @@ private:
 };
 
 OSCReceiver::OSCReceiver(const std::shared_ptr<KontrolModel> &param)
-        : model_(param), port_(0), messageQueue_(OscMsg::MAX_N_OSC_MSGS) {
-    packetListener_ = std::make_shared<KontrolPacketListener>(messageQueue_);
+        : model_(param), port_(0) {
+    packetListener_ = std::make_shared<KontrolPacketListener>(*this);
     oscListener_ = std::make_shared<KontrolOSCListener>(*this);
 }
 
@@ -212,42 +199,38 @@ OSCReceiver::~OSCReceiver() {
     stop();
 }
 
-void *osc_receiver_read_thread_func(void *pReceiver) {
-    OSCReceiver *pThis = static_cast<OSCReceiver *>(pReceiver);
-    pThis->socket()->Run();
-    return nullptr;
-}
-
-bool OSCReceiver::listen(unsigned port) {
+bool OSCReceiver::listen(unsigned port, unsigned threads) {
     stop();
     port_ = port;
-    try {
-        socket_ = std::make_shared<UdpListeningReceiveSocket>(
-                IpEndpointName(IpEndpointName::ANY_ADDRESS, port_),
-                packetListener_.get());
-
-        receive_thread_ = std::thread(osc_receiver_read_thread_func, this);
-    } catch (const std::runtime_error &e) {
+    for (unsigned i = 0; i < threads; i++) {
+        queues_.push_back(std::unique_ptr<PacketQueue>(new PacketQueue(mec::UdpReceiver::DEFAULT_POOL_SIZE)));
+    }
+    if (!receiver_.start(port_, packetListener_.get(), threads)) {
+        queues_.clear();
+        port_ = 0;
         return false;
     }
     return true;
 }
 
 void OSCReceiver::stop() {
-    if (socket_) {
-        socket_->AsynchronousBreak();
-        receive_thread_.join();
-        OscMsg msg;
-        while(messageQueue_.try_dequeue(msg));
+    receiver_.stop();
+    mec::UdpReceiver::Packet *packet;
+    for (auto i = queues_.begin(); i != queues_.end(); i++) {
+        while ((*i)->try_dequeue(packet));
     }
+    queues_.clear();
     port_ = 0;
-    socket_.reset();
 }
 
 void OSCReceiver::poll() {
-    OscMsg msg;
-    while (messageQueue_.try_dequeue(msg)) {
-        oscListener_->ProcessPacket(msg.buffer_, msg.size_, msg.origin_);
+    mec::UdpReceiver::Packet *packet;
+    for (auto i = queues_.begin(); i != queues_.end(); i++) {
+        while ((*i)->try_dequeue(packet)) {
+            oscListener_->ProcessPacket(packet->data_, static_cast<int>(packet->size_),
+                                        IpEndpointName(packet->address_, static_cast<int>(packet->port_)));
+            packet->release();
+        }
     }
 }
 
@@ -6,6 +6,7 @@
 
 #include <ip/UdpSocket.h>
 #include <readerwriterqueue.h>
+#include <mec_udpreceiver.h>
 
 namespace Kontrol {
 
@@ -19,7 +20,8 @@ class OSCReceiver {
 public:
     OSCReceiver(const std::shared_ptr<KontrolModel> &param);
     ~OSCReceiver();
-    bool listen(unsigned port = 9000);
+    // threads > 1 shares the port between threads (SO_REUSEPORT), for many senders
+    bool listen(unsigned port = 9000, unsigned threads = 1);
     void poll();
 
     void stop();
@@ -113,26 +115,18 @@ public:
 
     unsigned int port() { return port_; }
 
-    std::shared_ptr<UdpListeningReceiveSocket> socket() { return socket_; }
-
 private:
     friend class KontrolPacketListener;
 
-    struct OscMsg {
-        static const int MAX_N_OSC_MSGS = 128;
-        static const int MAX_OSC_MESSAGE_SIZE = 512;
-        IpEndpointName origin_;
-        int size_;
-        char buffer_[MAX_OSC_MESSAGE_SIZE];
-    };
+    // packets are passed by reference, from the receivers buffer pool, one queue per receive thread
+    typedef moodycamel::ReaderWriterQueue<mec::UdpReceiver::Packet *> PacketQueue;
 
     std::shared_ptr<KontrolModel> model_;
     unsigned int port_;
-    std::thread receive_thread_;
-    std::shared_ptr<UdpListeningReceiveSocket> socket_;
-    std::shared_ptr<PacketListener> packetListener_;
+    mec::UdpReceiver receiver_;
+    std::vector<std::unique_ptr<PacketQueue>> queues_;
+    std::shared_ptr<KontrolPacketListener> packetListener_;
     std::shared_ptr<KontrolOSCListener> oscListener_;
-    moodycamel::ReaderWriterQueue<OscMsg> messageQueue_;
 };
 
 } //namespace
\ No newline at end of file
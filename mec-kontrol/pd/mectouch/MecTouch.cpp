@@ -0,0 +1,104 @@
+#include "../m_pd.h"
+
+#include <mec_shmring.h>
+
+#include <string>
+
+// reads touches from mec-app's shared memory output
+// outputs touchOn/touchContinue/touchOff id note x y z, and control id value
+// pd messages are only delivered on scheduler ticks, so the ring is polled each tick, rather than waiting
+
+static t_class *MecTouch_class;
+
+static const double POLL_MS = 1.0;
+// reopen attempts, when mec-app is not running
+static const double REOPEN_MS = 1000.0;
+
+typedef struct _MecTouch {
+    t_object x_obj;
+    t_outlet *x_out;
+    t_clock *x_clock;
+    t_symbol *x_name;
+    mec::ShmRing *x_ring;
+    double x_reopen;
+} t_MecTouch;
+
+
+//define pure data methods
+extern "C" {
+void MecTouch_free(t_MecTouch *);
+void *MecTouch_new(t_symbol *name);
+EXTERN void MecTouch_setup(void);
+void MecTouch_tick(t_MecTouch *x);
+void MecTouch_open(t_MecTouch *x, t_symbol *name);
+}
+// puredata methods implementation - start
+
+void MecTouch_free(t_MecTouch *x) {
+    clock_free(x->x_clock);
+    delete x->x_ring;
+}
+
+void *MecTouch_new(t_symbol *name) {
+    t_MecTouch *x = (t_MecTouch *) pd_new(MecTouch_class);
+    x->x_out = outlet_new(&x->x_obj, 0);
+    x->x_clock = clock_new(x, (t_method) MecTouch_tick);
+    x->x_ring = new mec::ShmRing();
+    x->x_name = (name && name->s_name && *name->s_name) ? name : gensym(mec::ShmRing::DEFAULT_NAME);
+    x->x_reopen = 0.0;
+    clock_delay(x->x_clock, 0);
+    return (void *) x;
+}
+
+void MecTouch_setup(void) {
+    MecTouch_class = class_new(gensym("MecTouch"),
+                               (t_newmethod) MecTouch_new,
+                               (t_method) MecTouch_free,
+                               sizeof(t_MecTouch),
+                               CLASS_DEFAULT,
+                               A_DEFSYMBOL, A_NULL);
+
+    class_addmethod(MecTouch_class,
+                    (t_method) MecTouch_open, gensym("open"),
+                    A_DEFSYMBOL, A_NULL);
+}
+
+void MecTouch_open(t_MecTouch *x, t_symbol *name) {
+    if (name && name->s_name && *name->s_name) x->x_name = name;
+    x->x_ring->close();
+    x->x_reopen = 0.0;
+}
+
+void MecTouch_tick(t_MecTouch *x) {
+    mec::ShmRing &ring = *x->x_ring;
+    if (!ring.isOpen() || ring.closed()) {
+        x->x_reopen -= POLL_MS;
+        if (x->x_reopen <= 0.0) {
+            x->x_reopen = REOPEN_MS;
+            if (ring.open(x->x_name->s_name)) post("MecTouch : reading %s", x->x_name->s_name);
+        }
+    }
+
+    static t_symbol *selectors[] = {
+            gensym("touchOn"), gensym("touchContinue"), gensym("touchOff"), gensym("control")
+    };
+    mec::ShmTouch t;
+    t_atom args[5];
+    while (ring.read(t)) {
+        if (t.type_ > mec::ShmTouch::T_CONTROL) continue;
+        SETFLOAT(&args[0], (t_float) t.id_);
+        if (t.type_ == mec::ShmTouch::T_CONTROL) {
+            SETFLOAT(&args[1], t.z_);
+            outlet_anything(x->x_out, selectors[t.type_], 2, args);
+        } else {
+            SETFLOAT(&args[1], t.note_);
+            SETFLOAT(&args[2], t.x_);
+            SETFLOAT(&args[3], t.y_);
+            SETFLOAT(&args[4], t.z_);
+            outlet_anything(x->x_out, selectors[t.type_], 5, args);
+        }
+    }
+    clock_delay(x->x_clock, POLL_MS);
+}
+
+// puredata methods implementation - end
@@ -0,0 +1,51 @@
+#include "mec_oscmatch.h"
+
+namespace mec {
+
+OscAddressMatcher::OscAddressMatcher() {
+    Node root = {0, -1, -1, NO_MATCH, NO_MATCH};
+    nodes_.push_back(root);
+}
+
+bool OscAddressMatcher::add(const char *address, int id, bool suffix) {
+    if (address == nullptr || id < 0) return false;
+    int node = 0;
+    for (const char *p = address; *p; p++) {
+        int n = child(node, *p);
+        if (n < 0) {
+            Node c = {*p, -1, nodes_[node].child_, NO_MATCH, NO_MATCH};
+            n = static_cast<int>(nodes_.size());
+            nodes_.push_back(c);
+            nodes_[node].child_ = n;
+        }
+        node = n;
+    }
+    int &target = suffix ? nodes_[node].suffix_ : nodes_[node].id_;
+    if (target != NO_MATCH) return false;
+    target = id;
+    return true;
+}
+
+int OscAddressMatcher::match(const char *address, unsigned &index) const {
+    index = 0;
+    if (address == nullptr) return NO_MATCH;
+    int node = 0;
+    for (const char *p = address;; p++) {
+        const Node &n = nodes_[node];
+        if (*p == 0) return n.id_;
+        if (n.suffix_ != NO_MATCH && *p >= '0' && *p <= '9') {
+            unsigned v = 0;
+            for (; *p >= '0' && *p <= '9'; p++) {
+                if (v > 99999999) return NO_MATCH; // too long
+                v = v * 10 + (*p - '0');
+            }
+            if (*p != 0) return NO_MATCH;
+            index = v;
+            return n.suffix_;
+        }
+        node = child(node, *p);
+        if (node < 0) return NO_MATCH;
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+namespace mec {
+
+//
+// matches incoming osc addresses against a fixed vocabulary, compiled once into a trie
+// an address may take an integer suffix (e.g. /t3d/tch12), which is parsed directly from the address
+// matching walks the address bytes once, with no allocation, so can be used on the receive path
+// osc pattern characters (*?[]{}) in incoming addresses are not supported, they simply do not match
+//
+class OscAddressMatcher {
+public:
+    static const int NO_MATCH = -1;
+
+    OscAddressMatcher();
+
+    // id >= 0, false if address is already added
+    bool add(const char *address, int id, bool suffix = false);
+
+    // id of matching address, or NO_MATCH. index is the integer suffix (or 0)
+    int match(const char *address, unsigned &index) const;
+
+    int match(const char *address) const {
+        unsigned index;
+        return match(address, index);
+    }
+
+private:
+    struct Node {
+        char c_;
+        int child_;   // first child, -1 none
+        int sibling_; // next sibling, -1 none
+        int id_;      // exact match
+        int suffix_;  // match followed by integer
+    };
+
+    int child(int node, char c) const {
+        for (int n = nodes_[node].child_; n >= 0; n = nodes_[n].sibling_) {
+            if (nodes_[n].c_ == c) return n;
+        }
+        return -1;
+    }
+
+    std::vector<Node> nodes_;
+};
+
+}
@@ -0,0 +1,263 @@
+#include "mec_shmring.h"
+
+#include "mec_log.h"
+
+#include <new>
+#include <string.h>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   ifdef __linux__
+#       include <climits>
+#       include <linux/futex.h>
+#       include <sys/syscall.h>
+#       include <time.h>
+#   else
+#       include <chrono>
+#       include <thread>
+#   endif
+#endif
+
+namespace mec {
+
+static const uint32_t SHM_MAGIC = 0x4D454353; // MECS
+static const uint32_t SHM_VERSION = 1;
+
+// poll interval for wait(), where there is no futex
+static const unsigned POLL_US = 50;
+
+static_assert(sizeof(ShmTouch) == 32, "ShmTouch layout must not change");
+
+struct ShmRing::Header {
+    uint32_t magic_;
+    uint32_t version_;
+    uint32_t capacity_;
+    uint32_t recordSize_;
+    std::atomic<uint32_t> closed_; // writer has gone, readers should reopen
+
+    // on their own cache lines, as they are written by different processes
+    alignas(64) std::atomic<uint64_t> write_;   // records written
+    alignas(64) std::atomic<uint32_t> doorbell_; // futex word, bumped on notify
+    std::atomic<uint32_t> waiters_;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
+const char *const ShmRing::DEFAULT_NAME = "/mec-touches";
+
+// posix shm names start with a slash
+static std::string shmName(const std::string &name) {
+    return name.size() > 0 && name[0] == '/' ? name : "/" + name;
+}
+
+// marks an existing region closed and wakes its readers, so they reopen
+static void retireExisting(const std::string &name) {
+    ShmRing old;
+    if (old.open(name)) old.retire();
+}
+
+ShmRing::ShmRing() :
+        header_(nullptr), records_(nullptr), size_(0), mask_(0), writer_(false), read_(0), dropped_(0) {
+}
+
+ShmRing::~ShmRing() {
+    close();
+}
+
+bool ShmRing::create(const std::string &name, unsigned capacity) {
+    close();
+#ifdef _WIN32
+    LOG_0("ShmRing : shared memory not supported on this platform");
+    return false;
+#else
+    unsigned cap = 1;
+    while (cap < capacity) cap <<= 1;
+    name_ = shmName(name);
+
+    // replace any previous region, readers still mapped to it will see it closed
+    // (the writer may have crashed, without closing it)
+    retireExisting(name_);
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+    if (fd < 0) {
+        LOG_0("ShmRing : unable to create " << name_);
+        return false;
+    }
+    size_t size = sizeof(Header) + cap * sizeof(ShmTouch);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        LOG_0("ShmRing : unable to size " << name_);
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        LOG_0("ShmRing : unable to map " << name_);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    header_ = new(p) Header;
+    header_->magic_ = SHM_MAGIC;
+    header_->version_ = SHM_VERSION;
+    header_->capacity_ = cap;
+    header_->recordSize_ = sizeof(ShmTouch);
+    header_->closed_.store(0);
+    header_->write_.store(0);
+    header_->doorbell_.store(0);
+    header_->waiters_.store(0);
+    records_ = reinterpret_cast<ShmTouch *>(reinterpret_cast<char *>(p) + sizeof(Header));
+    size_ = size;
+    mask_ = cap - 1;
+    writer_ = true;
+    read_ = 0;
+    dropped_ = 0;
+    LOG_1("ShmRing : created " << name_ << " capacity " << cap);
+    return true;
+#endif
+}
+
+bool ShmRing::open(const std::string &name) {
+    close();
+#ifdef _WIN32
+    LOG_0("ShmRing : shared memory not supported on this platform");
+    return false;
+#else
+    name_ = shmName(name);
+    // read/write, as readers use the waiters count
+    int fd = shm_open(name_.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        LOG_1("ShmRing : unable to open " << name_);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        LOG_0("ShmRing : invalid region " << name_);
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        LOG_0("ShmRing : unable to map " << name_);
+        return false;
+    }
+
+    Header *header = reinterpret_cast<Header *>(p);
+    unsigned cap = header->capacity_;
+    if (header->magic_ != SHM_MAGIC || header->version_ != SHM_VERSION
+        || header->recordSize_ != sizeof(ShmTouch)
+        || cap == 0 || (cap & (cap - 1)) != 0
+        || size < sizeof(Header) + cap * sizeof(ShmTouch)) {
+        LOG_0("ShmRing : incompatible region " << name_);
+        munmap(p, size);
+        return false;
+    }
+
+    header_ = header;
+    records_ = reinterpret_cast<ShmTouch *>(reinterpret_cast<char *>(p) + sizeof(Header));
+    size_ = size;
+    mask_ = cap - 1;
+    writer_ = false;
+    read_ = header_->write_.load(std::memory_order_acquire);
+    dropped_ = 0;
+    return true;
+#endif
+}
+
+void ShmRing::close() {
+#ifndef _WIN32
+    if (header_ == nullptr) return;
+    if (writer_) retire();
+    munmap(header_, size_);
+    if (writer_) shm_unlink(name_.c_str());
+#endif
+    header_ = nullptr;
+    records_ = nullptr;
+    size_ = 0;
+    writer_ = false;
+}
+
+void ShmRing::retire() {
+    if (header_ == nullptr) return;
+    header_->closed_.store(1);
+    notify();
+}
+
+bool ShmRing::closed() const {
+    return header_ == nullptr || header_->closed_.load(std::memory_order_relaxed) != 0;
+}
+
+void ShmRing::write(const ShmTouch &touch) {
+    if (header_ == nullptr) return;
+    uint64_t w = header_->write_.load(std::memory_order_relaxed);
+    // readers check the write position after copying, so it must be seen no later than the record
+    std::atomic_thread_fence(std::memory_order_release);
+    records_[w & mask_] = touch;
+    header_->write_.store(w + 1, std::memory_order_release);
+}
+
+void ShmRing::notify() {
+    if (header_ == nullptr) return;
+    header_->doorbell_.fetch_add(1);
+#ifdef __linux__
+    if (header_->waiters_.load() > 0) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&header_->doorbell_), FUTEX_WAKE, INT_MAX,
+                nullptr, nullptr, 0);
+    }
+#endif
+}
+
+bool ShmRing::read(ShmTouch &touch) {
+    if (header_ == nullptr) return false;
+    uint64_t cap = mask_ + 1;
+    for (;;) {
+        uint64_t w = header_->write_.load(std::memory_order_acquire);
+        if (read_ == w) return false;
+        if (w - read_ >= cap) {
+            // fallen behind, oldest records have been overwritten
+            // (the oldest slot is also the one the writer fills next, so is skipped too)
+            dropped_ += w - read_ - cap + 1;
+            read_ = w - cap + 1;
+        }
+        touch = records_[read_ & mask_];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // writer may have lapped us while copying
+        if (header_->write_.load(std::memory_order_relaxed) - read_ >= cap) {
+            dropped_++;
+            read_++;
+            continue;
+        }
+        read_++;
+        return true;
+    }
+}
+
+bool ShmRing::wait(unsigned timeoutUs) {
+    if (header_ == nullptr) return false;
+    if (header_->write_.load(std::memory_order_acquire) != read_) return true;
+    if (closed()) return false;
+#ifdef __linux__
+    uint32_t bell = header_->doorbell_.load();
+    if (header_->write_.load(std::memory_order_acquire) != read_) return true;
+    header_->waiters_.fetch_add(1);
+    timespec ts;
+    ts.tv_sec = timeoutUs / 1000000;
+    ts.tv_nsec = static_cast<long>(timeoutUs % 1000000) * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&header_->doorbell_), FUTEX_WAIT, bell, &ts, nullptr, 0);
+    header_->waiters_.fetch_sub(1);
+#elif !defined(_WIN32)
+    for (unsigned waited = 0; waited < timeoutUs && !closed(); waited += POLL_US) {
+        if (header_->write_.load(std::memory_order_acquire) != read_) return true;
+        std::this_thread::sleep_for(std::chrono::microseconds(POLL_US));
+    }
+#endif
+    return header_->write_.load(std::memory_order_acquire) != read_;
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+namespace mec {
+
+//
+// local transport, touches passed to co-located consumers (pd, synths) thru posix shared memory
+// the region is a header and a ring of fixed layout records, written by a single writer (mec-app)
+// and read by any number of readers, each with its own read position.
+// the writer never blocks, if a reader falls behind by more than the ring, it skips ahead (counted as dropped)
+// the doorbell is a futex on a word in the header (linux), so one wake reaches all waiting readers,
+// without readers needing anything but the region name. elsewhere wait() polls.
+//
+
+// 32 bytes, same layout in all processes
+struct ShmTouch {
+    enum Type {
+        T_ON,
+        T_CONTINUE,
+        T_OFF,
+        T_CONTROL
+    };
+
+    uint64_t time_;   // mec::microtime(), uS
+    uint32_t type_;
+    int32_t id_;      // touch id, or control id
+    float note_;
+    float x_;
+    float y_;
+    float z_;         // value, for controls
+};
+
+class ShmRing {
+public:
+    static const unsigned DEFAULT_CAPACITY = 4096; // records, rounded up to a power of 2
+    static const char *const DEFAULT_NAME;
+
+    ShmRing();
+    ~ShmRing();
+
+    // writer, creates (or replaces) the region
+    bool create(const std::string &name = DEFAULT_NAME, unsigned capacity = DEFAULT_CAPACITY);
+    // reader, starts at the current write position
+    bool open(const std::string &name = DEFAULT_NAME);
+    void close();
+
+    bool isOpen() const { return header_ != nullptr; }
+
+    // reader, the writer has closed (or replaced) the region, reopen to continue
+    bool closed() const;
+
+    unsigned capacity() const { return mask_ + 1; }
+
+    // writer, single thread only, never blocks
+    void write(const ShmTouch &touch);
+    // wake waiting readers, once per batch of writes
+    void notify();
+
+    // reader, false if nothing new
+    bool read(ShmTouch &touch);
+    // true if there is something to read, blocks up to timeout
+    bool wait(unsigned timeoutUs);
+
+    // records the reader skipped, as it fell behind
+    unsigned long long dropped() const { return dropped_; }
+
+    // marks the region closed and wakes readers, e.g. an orphaned region before it is replaced
+    void retire();
+
+private:
+    struct Header;
+
+    Header *header_;
+    ShmTouch *records_;
+    size_t size_;
+    unsigned mask_;
+    bool writer_;
+    std::string name_;
+    uint64_t read_;
+    unsigned long long dropped_;
+};
+
+}
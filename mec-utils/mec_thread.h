@@ -0,0 +1,44 @@
+#pragma once
+
+#include <thread>
+
+#include "mec_log.h"
+
+#ifndef _WIN32
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+namespace mec {
+
+// priority > 0 uses SCHED_FIFO, cpu >= 0 pins thread to that cpu (linux only)
+// returns false if either could not be set
+inline bool setThreadPriority(std::thread &thread, int priority, int cpu, const char *name) {
+    bool ret = true;
+#ifndef _WIN32
+    if (priority > 0) {
+        sched_param param;
+        param.sched_priority = priority;
+        int rc = pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            LOG_0(name << " - unable to set SCHED_FIFO priority " << priority << " error " << rc);
+            ret = false;
+        }
+    }
+#endif
+#ifdef __linux__
+    if (cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        int rc = pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuset);
+        if (rc != 0) {
+            LOG_0(name << " - unable to set cpu affinity " << cpu << " error " << rc);
+            ret = false;
+        }
+    }
+#endif
+    return ret;
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <chrono>
+
+namespace mec {
+
+// monotonic time in uS, used for all timestamps passed thru mec-api
+inline unsigned long long microtime() {
+    return static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}
@@ -0,0 +1,204 @@
+#include "mec_udpreceiver.h"
+
+#include "mec_log.h"
+#include "mec_time.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+typedef int socklen_t;
+#   define closesocket_ closesocket
+static const long long INVALID_SOCKET_ = static_cast<long long>(INVALID_SOCKET);
+#else
+#   include <arpa/inet.h>
+#   include <netinet/in.h>
+#   include <sys/socket.h>
+#   include <unistd.h>
+#   define closesocket_ close
+static const long long INVALID_SOCKET_ = -1;
+#endif
+
+namespace mec {
+
+// longest a thread blocks, so stop() is timely
+static const unsigned MAX_WAIT_MS = 100;
+
+UdpReceiver::UdpReceiver() :
+        listener_(nullptr), port_(0), batch_(DEFAULT_BATCH), poolSize_(DEFAULT_POOL_SIZE),
+        bufferSize_(DEFAULT_BUFFER_SIZE), timerPeriod_(0), running_(false) {
+}
+
+UdpReceiver::~UdpReceiver() {
+    stop();
+}
+
+bool UdpReceiver::open(Shard &shard, bool reuse) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    shard.socket_ = static_cast<long long>(socket(AF_INET, SOCK_DGRAM, 0));
+    if (shard.socket_ == INVALID_SOCKET_) {
+        LOG_0("UdpReceiver : unable to create socket");
+        return false;
+    }
+    int s = static_cast<int>(shard.socket_);
+    if (reuse) {
+#ifdef SO_REUSEPORT
+        int on = 1;
+        if (setsockopt(s, SOL_SOCKET, SO_REUSEPORT, (const char *) &on, sizeof(on)) != 0) {
+            LOG_0("UdpReceiver : unable to set SO_REUSEPORT");
+            return false;
+        }
+#else
+        LOG_0("UdpReceiver : SO_REUSEPORT not supported");
+        return false;
+#endif
+    }
+
+    // wake periodically, for timer and stop
+    unsigned ms = timerPeriod_ > 0 && timerPeriod_ < MAX_WAIT_MS ? timerPeriod_ : MAX_WAIT_MS;
+#ifdef _WIN32
+    DWORD tv = ms;
+#else
+    timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = static_cast<long>(ms) * 1000;
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char *) &tv, sizeof(tv));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<unsigned short>(port_));
+    if (bind(s, (sockaddr *) &addr, sizeof(addr)) != 0) {
+        LOG_0("UdpReceiver : unable to bind port " << port_);
+        return false;
+    }
+
+    // pool, one arena for all buffers
+    shard.arena_.resize(static_cast<size_t>(poolSize_) * bufferSize_);
+    shard.packets_.reset(new Packet[poolSize_]);
+    for (unsigned i = 0; i < poolSize_; i++) {
+        shard.packets_[i].data_ = &shard.arena_[static_cast<size_t>(i) * bufferSize_];
+        shard.packets_[i].shard_ = shard.index_;
+    }
+    shard.next_ = 0;
+    return true;
+}
+
+bool UdpReceiver::start(unsigned port, Listener *listener, unsigned threads,
+                        unsigned batch, unsigned poolSize, unsigned bufferSize) {
+    stop();
+    if (listener == nullptr || threads == 0 || batch == 0 || poolSize < batch || bufferSize == 0) return false;
+    listener_ = listener;
+    port_ = port;
+    batch_ = batch;
+    poolSize_ = poolSize;
+    bufferSize_ = bufferSize;
+
+    for (unsigned i = 0; i < threads; i++) {
+        std::unique_ptr<Shard> shard(new Shard);
+        shard->index_ = i;
+        shard->socket_ = INVALID_SOCKET_;
+        bool ok = open(*shard, threads > 1);
+        shards_.push_back(std::move(shard));
+        if (!ok) {
+            stop();
+            return false;
+        }
+    }
+
+    running_ = true;
+    for (auto i = shards_.begin(); i != shards_.end(); i++) {
+        (*i)->thread_ = std::thread(&UdpReceiver::run, this, i->get());
+    }
+    return true;
+}
+
+void UdpReceiver::stop() {
+    running_ = false;
+    for (auto i = shards_.begin(); i != shards_.end(); i++) {
+        if ((*i)->thread_.joinable()) (*i)->thread_.join();
+        if ((*i)->socket_ != INVALID_SOCKET_) closesocket_(static_cast<int>((*i)->socket_));
+    }
+    shards_.clear();
+}
+
+unsigned UdpReceiver::freeSlots(Shard &shard, unsigned *slots, unsigned max) {
+    unsigned n = 0;
+    for (unsigned i = 0; i < poolSize_ && n < max; i++) {
+        unsigned slot = (shard.next_ + i) % poolSize_;
+        if (!shard.packets_[slot].used_.load(std::memory_order_acquire)) slots[n++] = slot;
+    }
+    return n;
+}
+
+void UdpReceiver::run(Shard *shard) {
+    int s = static_cast<int>(shard->socket_);
+    std::vector<unsigned> slots(batch_);
+    std::vector<sockaddr_in> from(batch_);
+#ifdef __linux__
+    std::vector<mmsghdr> msgs(batch_);
+    std::vector<iovec> iovs(batch_);
+#endif
+    unsigned long long timerUs = static_cast<unsigned long long>(timerPeriod_) * 1000;
+    unsigned long long lastTimer = microtime();
+
+    while (running_) {
+        unsigned n = freeSlots(*shard, slots.data(), batch_);
+        int received = 0;
+        if (n == 0) {
+            // all buffers held by listener
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else {
+#ifdef __linux__
+            for (unsigned i = 0; i < n; i++) {
+                iovs[i].iov_base = shard->packets_[slots[i]].data_;
+                iovs[i].iov_len = bufferSize_;
+                memset(&msgs[i], 0, sizeof(mmsghdr));
+                msgs[i].msg_hdr.msg_name = &from[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            // blocks for first (upto timeout), then takes whatever else is waiting
+            received = recvmmsg(s, msgs.data(), n, MSG_WAITFORONE, nullptr);
+            for (int i = 0; i < received; i++) {
+                Packet &p = shard->packets_[slots[i]];
+                p.size_ = msgs[i].msg_len;
+                p.address_ = ntohl(from[i].sin_addr.s_addr);
+                p.port_ = ntohs(from[i].sin_port);
+                p.used_.store(true, std::memory_order_relaxed);
+                listener_->receive(&p);
+            }
+#else
+            socklen_t len = sizeof(sockaddr_in);
+            Packet &p = shard->packets_[slots[0]];
+            int size = static_cast<int>(recvfrom(s, p.data_, bufferSize_, 0, (sockaddr *) &from[0], &len));
+            if (size >= 0) {
+                p.size_ = static_cast<unsigned>(size);
+                p.address_ = ntohl(from[0].sin_addr.s_addr);
+                p.port_ = ntohs(from[0].sin_port);
+                p.used_.store(true, std::memory_order_relaxed);
+                listener_->receive(&p);
+                received = 1;
+            }
+#endif
+            if (received > 0) shard->next_ = (slots[received - 1] + 1) % poolSize_;
+        }
+
+        if (timerUs > 0) {
+            unsigned long long t = microtime();
+            if (t - lastTimer >= timerUs) {
+                lastTimer = t;
+                listener_->timer(shard->index_);
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mec {
+
+//
+// udp ingest, shared by the osc inputs
+// datagrams are read in batches (recvmmsg on linux) straight into a pool of fixed size buffers,
+// listeners are passed the buffer, and release it when done (from any thread),
+// so packets can be queued to another thread without copying.
+// with several threads, each has its own socket on the port (SO_REUSEPORT), and the kernel spreads senders
+// over them. packets carry their shard (thread), so listeners can keep per shard state or queues.
+// if a shards pool is all in use (listener not releasing), reading pauses, and the os buffers or drops
+//
+class UdpReceiver {
+public:
+    static const unsigned DEFAULT_BATCH = 16;
+    static const unsigned DEFAULT_POOL_SIZE = 256;   // per shard
+    static const unsigned DEFAULT_BUFFER_SIZE = 2048;
+
+    class Packet {
+    public:
+        Packet() : data_(nullptr), size_(0), address_(0), port_(0), shard_(0), used_(false) { ; }
+
+        // buffer can be reused once released
+        void release() { used_.store(false, std::memory_order_release); }
+
+        char *data_;
+        unsigned size_;
+        unsigned long address_; // ipv4, host order
+        unsigned port_;
+        unsigned shard_;
+
+    private:
+        friend class UdpReceiver;
+        std::atomic<bool> used_;
+    };
+
+    class Listener {
+    public:
+        virtual ~Listener() { ; }
+
+        // called on the shards thread, packet must be released when done with
+        virtual void receive(Packet *packet) = 0;
+
+        // called on each shards thread, at least every timer period (if set)
+        virtual void timer(unsigned shard) { ; }
+    };
+
+    UdpReceiver();
+    ~UdpReceiver();
+
+    // 0 = no timer calls, set before start
+    void setTimer(unsigned ms) { timerPeriod_ = ms; }
+    bool start(unsigned port, Listener *listener, unsigned threads = 1,
+               unsigned batch = DEFAULT_BATCH, unsigned poolSize = DEFAULT_POOL_SIZE,
+               unsigned bufferSize = DEFAULT_BUFFER_SIZE);
+    void stop();
+
+    bool isRunning() const { return running_; }
+
+    unsigned port() const { return port_; }
+
+    unsigned threads() const { return static_cast<unsigned>(shards_.size()); }
+
+private:
+    struct Shard {
+        unsigned index_;
+        long long socket_;
+        std::thread thread_;
+        std::unique_ptr<Packet[]> packets_;
+        std::vector<char> arena_;
+        unsigned next_; // next pool slot to try
+    };
+
+    bool open(Shard &shard, bool reuse);
+    void run(Shard *shard);
+    // up to max free slots, in pool order
+    unsigned freeSlots(Shard &shard, unsigned *slots, unsigned max);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    Listener *listener_;
+    unsigned port_;
+    unsigned batch_;
+    unsigned poolSize_;
+    unsigned bufferSize_;
+    unsigned timerPeriod_;
+    std::atomic<bool> running_;
+};
+
+}